@@ -0,0 +1,22 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+// Keeps the compiler from discarding a result that is otherwise unused.
+template <typename T>
+inline void doNotOptimize(const T &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Runs fn a tenth of `iterations` times to warm up, then `iterations` times timed, and
+// prints the mean time per call.
+template <typename F>
+void runBenchmark(const std::string &name, size_t iterations, F &&fn) {
+    for (size_t i = 0; i < iterations / 10; ++i) fn();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) fn();
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%-48s %12.1f ns/op\n", name.c_str(), elapsed / iterations);
+}
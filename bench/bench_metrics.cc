@@ -0,0 +1,22 @@
+#include <string>
+#include "Bench.h"
+#include "utils/Metrics.h"
+
+int main() {
+    const size_t iterations = 10000000;
+    auto &registry = MetricsRegistry::instance();
+    auto id = registry.latencySeries("bench_duration_seconds", metricLabel("route", "/persons/{1}"));
+    uint64_t micros = 0;
+    runBenchmark("MetricsRegistry::record", iterations, [&] {
+        registry.record(id, ++micros & 0xffff);
+    });
+
+    for (int i = 0; i < 200; ++i) {
+        registry.latencySeries("bench_route_seconds", metricLabel("route", "/route/" + std::to_string(i)));
+    }
+    runBenchmark("MetricsRegistry::render, 200 series", 200, [&] {
+        auto text = registry.render();
+        doNotOptimize(text);
+    });
+    return 0;
+}
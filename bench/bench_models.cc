@@ -0,0 +1,96 @@
+#include <json/json.h>
+#include <string>
+#include <vector>
+#include "Bench.h"
+#include "controllers/PersonsController.h"
+#include "test/FakeResult.h"
+
+using namespace drogon_model::org_chart;
+
+namespace {
+    const size_t kRows = 1000;
+
+    // Rows shaped like `select * from person` and `select * from person_details`.
+    drogon::orm::Result personRows() {
+        std::vector<FakeRow> rows;
+        for (size_t i = 1; i <= kRows; ++i) {
+            rows.push_back({std::to_string(i), "2", "1", std::to_string(i / 8 + 1), "Tayler", "Shantee",
+                            "2018-04-07", "3"});
+        }
+        return makeFakeResult({"id", "job_id", "department_id", "manager_id", "first_name", "last_name",
+                               "hire_date", "version"},
+                              std::move(rows));
+    }
+
+    drogon::orm::Result personInfoRows() {
+        std::vector<FakeRow> rows;
+        for (size_t i = 1; i <= kRows; ++i) {
+            rows.push_back({std::to_string(i), "2", "1", std::to_string(i / 8 + 1), "Tayler", "Shantee",
+                            "2018-04-07", "Senior Engineer", "Infrastructure", "Gary Reed", "3"});
+        }
+        return makeFakeResult({"id", "job_id", "department_id", "manager_id", "first_name", "last_name",
+                               "hire_date", "job_title", "department_name", "manager_full_name", "version"},
+                              std::move(rows));
+    }
+}  // namespace
+
+int main() {
+    const size_t iterations = 1000000;
+    auto persons = personRows();
+    auto personInfos = personInfoRows();
+    size_t row = 0;
+
+    runBenchmark("Person(const Row &)", iterations, [&] {
+        Person person{persons[row++ % kRows]};
+        doNotOptimize(person);
+    });
+    runBenchmark("Person(const Row &, -1)", iterations, [&] {
+        Person person{persons[row++ % kRows], -1};
+        doNotOptimize(person);
+    });
+    runBenchmark("PersonInfo(const Row &)", iterations, [&] {
+        PersonInfo personInfo{personInfos[row++ % kRows]};
+        doNotOptimize(personInfo);
+    });
+
+    Json::Value json;
+    json["first_name"] = "Tayler";
+    json["last_name"] = "Shantee";
+    json["hire_date"] = "2018-04-07";
+    json["job_id"] = 2;
+    json["department_id"] = 1;
+    json["manager_id"] = 1;
+    runBenchmark("Person(const Json::Value &)", iterations, [&] {
+        Person person{json};
+        doNotOptimize(person);
+    });
+    runBenchmark("Person::validateJsonForCreation", iterations, [&] {
+        std::string err;
+        auto valid = Person::validateJsonForCreation(json, err);
+        doNotOptimize(valid);
+    });
+
+    Person person{persons[0]};
+    runBenchmark("Person::toJson", iterations, [&] {
+        auto out = person.toJson();
+        doNotOptimize(out);
+    });
+    const std::vector<std::string> masquerade{"id", "jobId", "departmentId", "managerId", "firstName", "lastName",
+                                              "hireDate"};
+    runBenchmark("Person::toMasqueradedJson", iterations, [&] {
+        auto out = person.toMasqueradedJson(masquerade);
+        doNotOptimize(out);
+    });
+
+    PersonInfo personInfo{personInfos[0]};
+    runBenchmark("PersonDetails(const PersonInfo &)", iterations, [&] {
+        PersonsController::PersonDetails details{personInfo};
+        doNotOptimize(details);
+    });
+    PersonsController::PersonDetails details{personInfo};
+    runBenchmark("PersonDetails::toJson", iterations, [&] {
+        auto out = details.toJson();
+        doNotOptimize(out);
+    });
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include <drogon/drogon.h>
+#include <cstdio>
+#include <future>
+#include <string>
+#include <thread>
+#include "Bench.h"
+#include "test/InProcessServer.h"
+
+using namespace drogon;
+
+// Round trips through the real filters, controllers and models against FakeDbClient, so the
+// numbers are the service's own cost (plus loopback HTTP) without PostgreSQL.
+int main() {
+    configureInProcessServer();
+    auto &db = inProcessDb();
+    auto department = db.addDepartment("Bench Department");
+    auto job = db.addJob("Bench Job");
+    auto boss = db.addPerson("Bench", "Boss", "2015-01-01", department, job);
+    for (int i = 0; i < 100; ++i) {
+        db.addPerson("Bench", "Report " + std::to_string(i), "2018-04-07", department, job, boss);
+    }
+
+    std::promise<void> started;
+    std::thread server([&started]() {
+        app().getLoop()->queueInLoop([&started]() { started.set_value(); });
+        app().run();
+    });
+    started.get_future().wait();
+
+    auto client = HttpClient::newHttpClient(kInProcessUrl);
+    auto get = [&client](const std::string &path) {
+        auto req = HttpRequest::newHttpRequest();
+        req->setPath(path);
+        auto resp = client->sendRequest(req, 10);
+        doNotOptimize(resp);
+        return resp.second;
+    };
+    // Allocation tracking builds also print the allocations of one more request per endpoint.
+    auto allocations = [&get](const std::string &name, const std::string &path) {
+        auto resp = get(path);
+        if (!resp || resp->getHeader("X-Alloc-Count").empty()) return;
+        std::printf("%-48s %12s allocs, %s bytes\n", name.c_str(), resp->getHeader("X-Alloc-Count").c_str(),
+                    resp->getHeader("X-Alloc-Bytes").c_str());
+    };
+
+    const size_t iterations = 20000;
+    auto one = "/persons/" + std::to_string(boss + 1);
+    auto reports = "/persons/" + std::to_string(boss) + "/reports";
+    runBenchmark("GET /persons/{id}", iterations, [&] { get(one); });
+    runBenchmark("GET /persons/{id}/reports, 101 rows", iterations / 10, [&] { get(reports); });
+    runBenchmark("GET /persons?limit=25", iterations, [&] { get("/persons?limit=25"); });
+    allocations("GET /persons/{id}", one);
+    allocations("GET /persons/{id}/reports, 101 rows", reports);
+    allocations("GET /persons?limit=25", "/persons?limit=25");
+
+    app().getLoop()->queueInLoop([]() { app().quit(); });
+    server.join();
+    return 0;
+}
@@ -0,0 +1,340 @@
+// Synthetic organization generator for benchmarks and load tests.
+//
+//   datagen [--persons 100000] [--depth 8] [--span 6] [--departments 50] [--jobs 40]
+//           [--seed 1] [--out .] [--format copy|csv]
+//
+// The org is built breadth first from a single CEO (their own manager). Every manager above the
+// bottom level gets between 1 and 2 * span - 1 reports until --persons exist; when the bottom
+// level is reached first, the remaining persons are spread round robin over the managers one level
+// up, so spans grow instead of the tree getting deeper. Persons below the first level with at
+// least --departments members stay in their manager's department, managers hold level dependent
+// job titles and are hired earlier than their reports. The same --seed always gives the same org.
+//
+// --format copy (default) writes job.copy, department.copy and person.copy in COPY text format
+// with explicit ids (every manager has a smaller id than their reports), plus load.sql, which
+// loads them into a freshly migrated, empty database with psql:
+//
+//   psql -d org_chart -f load.sql
+//
+// --format csv writes departments.csv, jobs.csv and persons.csv for `org_chart import`; it goes
+// through validation and name lookups and is much slower past a million persons.
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+    const char *const kFirstNames[] = {
+        "Aaliyah", "Adrian",  "Aisha",   "Alba",    "Amara",  "Andre",   "Anika",   "Arjun",   "Beatriz", "Bram",
+        "Camila",  "Chen",    "Dalia",   "Daniel",  "Dmitri", "Elena",   "Emeka",   "Fatima",  "Felix",   "Gabriel",
+        "Grace",   "Hana",    "Hugo",    "Ines",    "Isaac",  "Jamal",   "Jana",    "Javier",  "Kai",     "Kamala",
+        "Kenji",   "Lara",    "Liam",    "Lucia",   "Mateo",  "Maya",    "Mei",     "Nadia",   "Noah",    "Olga",
+        "Omar",    "Priya",   "Rafael",  "Rosa",    "Sabryna", "Samir",  "Sofia",   "Tayler",  "Tomas",   "Uma",
+        "Valeria", "Viktor",  "Wei",     "Yara",    "Yusuf",  "Zara",    "Gary",    "Nora",    "Oscar",   "Ruth",
+    };
+    const char *const kLastNames[] = {
+        "Abebe",   "Alvarez", "Andersen", "Bakker",  "Banerjee", "Becker",  "Costa",   "Dubois",  "Eriksson", "Fischer",
+        "Garcia",  "Haddad",  "Hansen",   "Ito",     "Ivanova",  "Jensen",  "Kaur",    "Kim",     "Kowalski", "Laine",
+        "Li",      "Lopez",   "Mensah",   "Moreau",  "Murphy",   "Nakamura", "Nguyen", "Novak",   "Okafor",   "Olsen",
+        "Park",    "Peers",   "Petrov",   "Quinn",   "Reed",     "Rossi",   "Sato",    "Schmidt", "Shantee",  "Silva",
+        "Singh",   "Suzuki",  "Tanaka",   "Torres",  "Umar",     "Varga",   "Wagner",  "Walsh",   "Xu",       "Yilmaz",
+    };
+    const char *const kDepartments[] = {
+        "Engineering", "Sales",     "Marketing", "Finance",    "Legal",      "Support",   "Operations",
+        "Research",    "Design",    "Security",  "Facilities", "Procurement", "Analytics", "Infrastructure",
+        "Recruiting",  "Training",  "Quality",   "Logistics",  "Compliance", "Partnerships",
+    };
+    // Roughly by seniority; job ids past the end of the list get numbered copies.
+    const char *const kJobs[] = {
+        "Associate", "Specialist", "Engineer", "Analyst",  "Consultant", "Senior Engineer", "Senior Analyst",
+        "Lead",      "Architect",  "Manager",  "Senior Manager", "Director", "Senior Director", "Vice President",
+    };
+
+    template <typename T, size_t N>
+    constexpr size_t countOf(const T (&)[N]) {
+        return N;
+    }
+
+    struct Options {
+        size_t persons = 100000;
+        size_t depth = 8;
+        size_t span = 6;
+        size_t departments = 50;
+        size_t jobs = 40;
+        uint64_t seed = 1;
+        std::string out = ".";
+        std::string format = "copy";
+    };
+
+    struct Org {
+        // Index 0 is unused so that indexes are the generated ids.
+        std::vector<uint32_t> manager;
+        std::vector<uint32_t> department;
+        std::vector<uint32_t> job;
+        std::vector<uint32_t> hireDay;
+        size_t levels = 0;
+        size_t maxSpan = 0;
+    };
+
+    void usage() {
+        std::fprintf(stderr,
+                     "usage: datagen [--persons N] [--depth N] [--span N] [--departments N] [--jobs N]\n"
+                     "               [--seed N] [--out DIR] [--format copy|csv]\n");
+    }
+
+    bool parseOptions(int argc, char *argv[], Options &options) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (i + 1 >= argc) return false;
+            std::string value = argv[++i];
+            try {
+                if (arg == "--persons") options.persons = std::stoul(value);
+                else if (arg == "--depth") options.depth = std::stoul(value);
+                else if (arg == "--span") options.span = std::stoul(value);
+                else if (arg == "--departments") options.departments = std::stoul(value);
+                else if (arg == "--jobs") options.jobs = std::stoul(value);
+                else if (arg == "--seed") options.seed = std::stoull(value);
+                else if (arg == "--out") options.out = value;
+                else if (arg == "--format") options.format = value;
+                else return false;
+            } catch (const std::exception &) {
+                return false;
+            }
+        }
+        // ids and the generated names must fit the schema's int and varchar(50) columns
+        return options.persons > 0 && options.persons < 2000000000 && options.depth > 1 && options.span > 0 &&
+               options.departments > 0 && options.jobs > 0 && (options.format == "copy" || options.format == "csv");
+    }
+
+    // Unique names from a pool: the plain pool entries first, then numbered ones.
+    auto poolName(const char *const *pool, size_t poolSize, size_t index) -> std::string {
+        std::string name = pool[index % poolSize];
+        if (index >= poolSize) name += " " + std::to_string(index / poolSize + 1);
+        return name;
+    }
+
+    void personName(size_t id, std::string &first, std::string &last) {
+        const size_t firstCount = countOf(kFirstNames);
+        const size_t lastCount = countOf(kLastNames);
+        auto index = id - 1;
+        first = kFirstNames[index % firstCount];
+        last = poolName(kLastNames, lastCount, index / firstCount);
+    }
+
+    // Days since 1970-01-01 to YYYY-MM-DD (Howard Hinnant's civil_from_days).
+    auto isoDate(int64_t days) -> std::string {
+        days += 719468;
+        auto era = days / 146097;
+        auto dayOfEra = days - era * 146097;
+        auto yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+        auto dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+        auto shiftedMonth = (5 * dayOfYear + 2) / 153;
+        auto day = dayOfYear - (153 * shiftedMonth + 2) / 5 + 1;
+        auto month = shiftedMonth < 10 ? shiftedMonth + 3 : shiftedMonth - 9;
+        auto year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+        char buf[40];
+        std::snprintf(buf, sizeof(buf), "%04d-%02d-%02d", static_cast<int>(year), static_cast<int>(month),
+                      static_cast<int>(day));
+        return buf;
+    }
+
+    auto generate(const Options &options) -> Org {
+        std::mt19937_64 random{options.seed};
+        const size_t n = options.persons;
+        Org org;
+        org.manager.resize(n + 1);
+        org.department.resize(n + 1);
+        org.job.resize(n + 1);
+        org.hireDay.resize(n + 1);
+        std::vector<uint32_t> level(n + 1);
+        std::vector<uint32_t> reports(n + 1);
+
+        org.manager[1] = 1;
+        std::uniform_int_distribution<size_t> spanOf(1, 2 * options.span - 1);
+        // levelStart[l]: smallest id on level l; ids are handed out level by level.
+        std::vector<size_t> levelStart{1};
+        size_t next = 2;
+        for (size_t head = 1; next <= n && level[head] + 1 < options.depth; ++head) {
+            auto count = std::min(spanOf(random), n + 1 - next);
+            for (size_t i = 0; i < count; ++i, ++next) {
+                org.manager[next] = static_cast<uint32_t>(head);
+                level[next] = level[head] + 1;
+                if (level[next] == levelStart.size()) levelStart.push_back(next);
+            }
+            reports[head] += static_cast<uint32_t>(count);
+        }
+        // The bottom level is reached: spread whoever is left over the level above it.
+        if (next <= n) {
+            auto first = levelStart[options.depth - 2];
+            auto last = levelStart[options.depth - 1];
+            for (auto head = first; next <= n; head = head + 1 == last ? first : head + 1, ++next) {
+                org.manager[next] = static_cast<uint32_t>(head);
+                level[next] = level[head] + 1;
+                ++reports[head];
+            }
+        }
+
+        // Departments are drawn on the shallowest level that has at least as many persons as there
+        // are departments (or the bottom one) and inherited below it.
+        std::vector<size_t> perLevel;
+        for (size_t id = 1; id <= n; ++id) {
+            if (level[id] >= perLevel.size()) perLevel.resize(level[id] + 1);
+            ++perLevel[level[id]];
+            org.maxSpan = std::max(org.maxSpan, static_cast<size_t>(reports[id]));
+        }
+        org.levels = perLevel.size();
+        size_t departmentLevel = 0;
+        while (departmentLevel + 1 < perLevel.size() && perLevel[departmentLevel] < options.departments) {
+            ++departmentLevel;
+        }
+
+        std::uniform_int_distribution<uint32_t> departmentOf(1, static_cast<uint32_t>(options.departments));
+        std::uniform_int_distribution<uint32_t> jobOf(1, static_cast<uint32_t>(options.jobs));
+        // Managers are hired in their first ten years, everybody else any time in thirty.
+        const int64_t firstDay = 7305;  // 1990-01-01
+        for (size_t id = 1; id <= n; ++id) {
+            org.department[id] = level[id] <= departmentLevel ? departmentOf(random) : org.department[org.manager[id]];
+            if (reports[id] == 0) {
+                // individual contributors share the lower half of the job ladder
+                org.job[id] = 1 + jobOf(random) % static_cast<uint32_t>(std::max<size_t>(1, options.jobs / 2));
+            } else {
+                // the CEO holds the highest job id, each level below the next one down to the middle
+                auto floor = options.jobs / 2 + 1;
+                org.job[id] = static_cast<uint32_t>(std::max(floor, options.jobs - std::min<size_t>(options.jobs, level[id])));
+            }
+            auto start = reports[id] == 0 ? firstDay : firstDay + static_cast<int64_t>(level[id]) * 365;
+            auto span = reports[id] == 0 ? 30 * 365 : 10 * 365;
+            org.hireDay[id] = static_cast<uint32_t>(start + static_cast<int64_t>(random() % span));
+            // nobody is hired before their manager
+            if (id > 1) org.hireDay[id] = std::max(org.hireDay[id], org.hireDay[org.manager[id]]);
+        }
+        return org;
+    }
+
+    using File = std::unique_ptr<std::FILE, int (*)(std::FILE *)>;
+
+    auto create(const std::string &path) -> File {
+        File file{std::fopen(path.c_str(), "w"), &std::fclose};
+        if (!file) {
+            std::perror(path.c_str());
+            std::exit(1);
+        }
+        std::setvbuf(file.get(), nullptr, _IOFBF, 1 << 20);
+        return file;
+    }
+
+    void writeNames(const std::string &path, const char *header, const char *const *pool, size_t poolSize,
+                    size_t count, bool withIds) {
+        auto file = create(path);
+        if (header) std::fprintf(file.get(), "%s\n", header);
+        for (size_t i = 0; i < count; ++i) {
+            auto name = poolName(pool, poolSize, i);
+            if (withIds) {
+                std::fprintf(file.get(), "%zu\t%s\n", i + 1, name.c_str());
+            } else {
+                std::fprintf(file.get(), "%s\n", name.c_str());
+            }
+        }
+    }
+
+    void writeCopy(const Options &options, const Org &org) {
+        writeNames(options.out + "/job.copy", nullptr, kJobs, countOf(kJobs), options.jobs, true);
+        writeNames(options.out + "/department.copy", nullptr, kDepartments, countOf(kDepartments),
+                   options.departments, true);
+
+        auto persons = create(options.out + "/person.copy");
+        std::string first;
+        std::string last;
+        for (size_t id = 1; id <= options.persons; ++id) {
+            personName(id, first, last);
+            std::fprintf(persons.get(), "%zu\t%u\t%u\t%u\t%s\t%s\t%s\n", id, org.job[id], org.department[id],
+                         org.manager[id], first.c_str(), last.c_str(), isoDate(org.hireDay[id]).c_str());
+        }
+
+        // The person_details, person_path, person_closure and change notification triggers
+        // would run once per row; the notifications are pointless for a bulk load and the
+        // derived tables are filled in one pass each by the functions of migration 9.
+        auto load = create(options.out + "/load.sql");
+        std::fputs(R"sql(\set ON_ERROR_STOP on
+begin;
+alter table job disable trigger user;
+alter table department disable trigger user;
+alter table person disable trigger user;
+\copy job (id, title) from 'job.copy'
+\copy department (id, name) from 'department.copy'
+\copy person (id, job_id, department_id, manager_id, first_name, last_name, hire_date) from 'person.copy'
+alter table job enable trigger user;
+alter table department enable trigger user;
+alter table person enable trigger user;
+select person_details_backfill();
+select person_path_backfill();
+select person_closure_backfill();
+select setval(pg_get_serial_sequence('job', 'id'), (select max(id) from job));
+select setval(pg_get_serial_sequence('department', 'id'), (select max(id) from department));
+select setval(pg_get_serial_sequence('person', 'id'), (select max(id) from person));
+commit;
+analyze job;
+analyze department;
+analyze person;
+analyze person_details;
+analyze person_path;
+analyze person_closure;
+analyze person_org_size;
+)sql",
+                   load.get());
+    }
+
+    void writeCsv(const Options &options, const Org &org) {
+        writeNames(options.out + "/jobs.csv", "title", kJobs, countOf(kJobs), options.jobs, false);
+        writeNames(options.out + "/departments.csv", "name", kDepartments, countOf(kDepartments),
+                   options.departments, false);
+
+        auto persons = create(options.out + "/persons.csv");
+        std::fputs("first_name,last_name,hire_date,department,job,manager_first_name,manager_last_name\n",
+                   persons.get());
+        std::string first;
+        std::string last;
+        std::string managerFirst;
+        std::string managerLast;
+        for (size_t id = 1; id <= options.persons; ++id) {
+            personName(id, first, last);
+            if (id == 1) {
+                managerFirst.clear();
+                managerLast.clear();
+            } else {
+                personName(org.manager[id], managerFirst, managerLast);
+            }
+            std::fprintf(persons.get(), "%s,%s,%s,%s,%s,%s,%s\n", first.c_str(), last.c_str(),
+                         isoDate(org.hireDay[id]).c_str(),
+                         poolName(kDepartments, countOf(kDepartments), org.department[id] - 1).c_str(),
+                         poolName(kJobs, countOf(kJobs), org.job[id] - 1).c_str(), managerFirst.c_str(),
+                         managerLast.c_str());
+        }
+    }
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage();
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto org = generate(options);
+    if (options.format == "copy") {
+        writeCopy(options, org);
+    } else {
+        writeCsv(options, org);
+    }
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("{\"persons\":%zu,\"levels\":%zu,\"max_span\":%zu,\"departments\":%zu,\"jobs\":%zu,"
+                "\"seconds\":%.3f}\n",
+                options.persons, org.levels, org.maxSpan, options.departments, options.jobs, seconds);
+    return 0;
+}
@@ -0,0 +1,402 @@
+// Open loop HTTP load generator for a running org_chart server.
+//
+//   load_generator [--url http://localhost:3000] [--rate 500] [--duration 30] [--warmup 5]
+//                  [--connections 64] [--threads 4] [--max-in-flight 4096] [--timeout 10]
+//                  [--mix list:25,get_one:50,reports:25]
+//                  [--username admin1 --password password] [--min-id 1 --max-id 1000]
+//                  [--department-id 1 --job-id 1]
+//
+// Requests are issued on a fixed schedule at --rate per second, whether or not earlier ones have
+// answered, and latency is measured from the scheduled send time so a stalled server shows up in
+// the percentiles instead of silently lowering the rate. Operations in --mix:
+//
+//   list     GET  /persons?limit=25&offset=<random>
+//   get_one  GET  /persons/<random id>
+//   reports  GET  /persons/<random id>/reports
+//   create   POST /persons
+//   update   PUT  /persons/<random id>
+//   login    POST /auth/login
+//
+// create and update write to the database and login needs --username, so none of them are in the
+// default mix. The summary is printed to stdout as JSON.
+#include <drogon/HttpClient.h>
+#include <json/json.h>
+#include <trantor/net/EventLoopThread.h>
+#include <trantor/net/EventLoopThreadPool.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "utils/Metrics.h"
+
+using namespace drogon;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    enum class Op { List, GetOne, Reports, Create, Update, Login };
+
+    struct OpInfo {
+        Op op;
+        const char *name;
+    };
+    const OpInfo kOps[] = {
+        {Op::List, "list"},     {Op::GetOne, "get_one"}, {Op::Reports, "reports"},
+        {Op::Create, "create"}, {Op::Update, "update"},  {Op::Login, "login"},
+    };
+    constexpr size_t kOpCount = sizeof(kOps) / sizeof(kOps[0]);
+
+    struct Options {
+        std::string url = "http://localhost:3000";
+        double rate = 500;
+        double duration = 30;
+        double warmup = 5;
+        size_t connections = 64;
+        size_t threads = 4;
+        size_t maxInFlight = 4096;
+        double timeout = 10;
+        std::string mix = "list:25,get_one:50,reports:25";
+        std::string username;
+        std::string password;
+        int minId = 1;
+        int maxId = 1000;
+        int departmentId = 1;
+        int jobId = 1;
+    };
+
+    // Results of one operation as seen by one client loop; only that loop writes to it.
+    struct OpStats {
+        LatencyHistogram latency;
+        std::atomic<uint64_t> ok{0};
+        std::atomic<uint64_t> non2xx{0};
+        std::atomic<uint64_t> failed{0};
+    };
+
+    struct LoopStats {
+        OpStats ops[kOpCount];
+    };
+
+    void usage() {
+        std::fprintf(stderr,
+                     "usage: load_generator [--url URL] [--rate N] [--duration S] [--warmup S] [--connections N]\n"
+                     "                      [--threads N] [--max-in-flight N] [--timeout S] [--mix op:weight,...]\n"
+                     "                      [--username U --password P] [--min-id N] [--max-id N]\n"
+                     "                      [--department-id N] [--job-id N]\n");
+    }
+
+    bool parseOptions(int argc, char *argv[], Options &options) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (i + 1 >= argc) return false;
+            std::string value = argv[++i];
+            try {
+                if (arg == "--url") options.url = value;
+                else if (arg == "--rate") options.rate = std::stod(value);
+                else if (arg == "--duration") options.duration = std::stod(value);
+                else if (arg == "--warmup") options.warmup = std::stod(value);
+                else if (arg == "--connections") options.connections = std::stoul(value);
+                else if (arg == "--threads") options.threads = std::stoul(value);
+                else if (arg == "--max-in-flight") options.maxInFlight = std::stoul(value);
+                else if (arg == "--timeout") options.timeout = std::stod(value);
+                else if (arg == "--mix") options.mix = value;
+                else if (arg == "--username") options.username = value;
+                else if (arg == "--password") options.password = value;
+                else if (arg == "--min-id") options.minId = std::stoi(value);
+                else if (arg == "--max-id") options.maxId = std::stoi(value);
+                else if (arg == "--department-id") options.departmentId = std::stoi(value);
+                else if (arg == "--job-id") options.jobId = std::stoi(value);
+                else return false;
+            } catch (const std::exception &) {
+                return false;
+            }
+        }
+        return options.rate > 0 && options.duration > 0 && options.warmup >= 0 && options.connections > 0 &&
+               options.threads > 0 && options.maxInFlight > 0 && options.minId <= options.maxId;
+    }
+
+    // "list:25,get_one:50" -> cumulative weights indexed like kOps.
+    bool parseMix(const std::string &mix, std::vector<double> &cumulative) {
+        std::vector<double> weights(kOpCount, 0);
+        size_t pos = 0;
+        while (pos < mix.size()) {
+            auto end = mix.find(',', pos);
+            if (end == std::string::npos) end = mix.size();
+            auto entry = mix.substr(pos, end - pos);
+            pos = end + 1;
+            auto colon = entry.find(':');
+            auto name = entry.substr(0, colon);
+            auto op = std::find_if(std::begin(kOps), std::end(kOps), [&](const OpInfo &info) { return name == info.name; });
+            if (op == std::end(kOps)) return false;
+            try {
+                weights[op - std::begin(kOps)] = colon == std::string::npos ? 1 : std::stod(entry.substr(colon + 1));
+            } catch (const std::exception &) {
+                return false;
+            }
+        }
+        cumulative.clear();
+        double total = 0;
+        for (auto weight : weights) {
+            if (weight < 0) return false;
+            total += weight;
+            cumulative.push_back(total);
+        }
+        return total > 0;
+    }
+
+    auto quantileOf(const std::vector<uint64_t> &counts, uint64_t total, double quantile) -> double {
+        auto rank = static_cast<uint64_t>(quantile * total);
+        uint64_t seen = 0;
+        for (int bucket = 0; bucket < LatencyHistogram::kBuckets && total > 0; ++bucket) {
+            seen += counts[bucket];
+            if (seen > rank) return LatencyHistogram::upperBoundOf(bucket) / 1000.0;
+        }
+        return 0;
+    }
+
+    auto login(const HttpClientPtr &client, const Options &options) -> std::string {
+        Json::Value body;
+        body["username"] = options.username;
+        body["password"] = options.password;
+        auto req = HttpRequest::newHttpJsonRequest(body);
+        req->setMethod(Post);
+        req->setPath("/auth/login");
+        auto [result, resp] = client->sendRequest(req, options.timeout);
+        if (result != ReqResult::Ok || resp->getStatusCode() != k200OK || !resp->getJsonObject()) {
+            std::fprintf(stderr, "login as %s failed\n", options.username.c_str());
+            return "";
+        }
+        return (*resp->getJsonObject())["token"].asString();
+    }
+
+    auto makeRequest(Op op, const Options &options, const std::string &token, std::mt19937 &random) -> HttpRequestPtr {
+        std::uniform_int_distribution<int> ids(options.minId, options.maxId);
+        HttpRequestPtr req;
+        switch (op) {
+            case Op::List:
+                req = HttpRequest::newHttpRequest();
+                req->setPath("/persons");
+                req->setParameter("limit", "25");
+                req->setParameter("offset", std::to_string(ids(random) - options.minId));
+                break;
+            case Op::GetOne:
+                req = HttpRequest::newHttpRequest();
+                req->setPath("/persons/" + std::to_string(ids(random)));
+                break;
+            case Op::Reports:
+                req = HttpRequest::newHttpRequest();
+                req->setPath("/persons/" + std::to_string(ids(random)) + "/reports");
+                break;
+            case Op::Create: {
+                Json::Value body;
+                body["first_name"] = "Load";
+                body["last_name"] = "Test" + std::to_string(random());
+                body["hire_date"] = "2020-01-01";
+                body["department_id"] = options.departmentId;
+                body["job_id"] = options.jobId;
+                body["manager_id"] = ids(random);
+                req = HttpRequest::newHttpJsonRequest(body);
+                req->setMethod(Post);
+                req->setPath("/persons");
+                break;
+            }
+            case Op::Update: {
+                Json::Value body;
+                body["last_name"] = "Test" + std::to_string(random());
+                req = HttpRequest::newHttpJsonRequest(body);
+                req->setMethod(Put);
+                req->setPath("/persons/" + std::to_string(ids(random)));
+                break;
+            }
+            case Op::Login: {
+                Json::Value body;
+                body["username"] = options.username;
+                body["password"] = options.password;
+                req = HttpRequest::newHttpJsonRequest(body);
+                req->setMethod(Post);
+                req->setPath("/auth/login");
+                return req;
+            }
+        }
+        if (!token.empty()) req->addHeader("Authorization", "Bearer " + token);
+        return req;
+    }
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    Options options;
+    std::vector<double> mix;
+    if (!parseOptions(argc, argv, options) || !parseMix(options.mix, mix)) {
+        usage();
+        return 1;
+    }
+    auto loginIndex = static_cast<size_t>(Op::Login);
+    if (options.username.empty() && mix[loginIndex] > mix[loginIndex - 1]) {
+        std::fprintf(stderr, "the login operation needs --username and --password\n");
+        return 1;
+    }
+
+    trantor::EventLoopThreadPool loops(options.threads, "load_generator");
+    loops.start();
+    std::vector<HttpClientPtr> clients;
+    std::vector<size_t> loopOfClient;
+    for (size_t i = 0; i < options.connections; ++i) {
+        auto loopIndex = i % options.threads;
+        clients.push_back(HttpClient::newHttpClient(options.url, loops.getLoop(loopIndex)));
+        loopOfClient.push_back(loopIndex);
+    }
+
+    std::string token;
+    if (!options.username.empty()) {
+        token = login(clients.front(), options);
+        if (token.empty()) return 1;
+    }
+
+    std::vector<LoopStats> stats(options.threads);
+    std::atomic<uint64_t> inFlight{0};
+    std::atomic<uint64_t> dropped{0};
+
+    // The scheduler sends every request whose slot has come and then sleeps until the next one;
+    // HttpClient hands each request over to the loop that owns its connection.
+    trantor::EventLoopThread schedulerThread("load_scheduler");
+    schedulerThread.run();
+    auto *scheduler = schedulerThread.getLoop();
+    std::promise<void> done;
+    auto start = Clock::now();
+    auto warmupEnd = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.warmup));
+    auto end = warmupEnd + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.duration));
+    auto interval = std::chrono::duration<double>(1.0 / options.rate);
+
+    scheduler->queueInLoop([&]() {
+        auto random = std::make_shared<std::mt19937>(std::random_device{}());
+        auto sent = std::make_shared<uint64_t>(0);
+        auto nextClient = std::make_shared<size_t>(0);
+        auto tick = std::make_shared<std::function<void()>>();
+        // Each pending timer owns the tick; once the last one has run there is nothing to free.
+        *tick = [&, random, sent, nextClient, weakTick = std::weak_ptr<std::function<void()>>(tick)]() {
+            auto now = Clock::now();
+            for (;;) {
+                auto due = start + std::chrono::duration_cast<Clock::duration>(interval * static_cast<double>(*sent));
+                if (due > now) {
+                    if (due >= end) {
+                        done.set_value();
+                        return;
+                    }
+                    scheduler->runAfter(std::chrono::duration<double>(due - now).count(),
+                                        [tick = weakTick.lock()]() { (*tick)(); });
+                    return;
+                }
+                ++*sent;
+                if (inFlight.load(std::memory_order_relaxed) >= options.maxInFlight) {
+                    if (due >= warmupEnd) dropped.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+
+                std::uniform_real_distribution<double> pick(0, mix.back());
+                auto opIndex = static_cast<size_t>(std::upper_bound(mix.begin(), mix.end(), pick(*random)) - mix.begin());
+                opIndex = std::min(opIndex, kOpCount - 1);
+                auto req = makeRequest(kOps[opIndex].op, options, token, *random);
+                auto clientIndex = (*nextClient)++ % clients.size();
+                bool measured = due >= warmupEnd;
+                auto *opStats = &stats[loopOfClient[clientIndex]].ops[opIndex];
+                inFlight.fetch_add(1, std::memory_order_relaxed);
+                clients[clientIndex]->sendRequest(
+                    req,
+                    [&inFlight, opStats, due, measured](ReqResult result, const HttpResponsePtr &resp) {
+                        inFlight.fetch_sub(1, std::memory_order_relaxed);
+                        if (!measured) return;
+                        if (result != ReqResult::Ok) {
+                            opStats->failed.fetch_add(1, std::memory_order_relaxed);
+                            return;
+                        }
+                        auto micros = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - due).count();
+                        opStats->latency.record(static_cast<uint64_t>(micros));
+                        auto status = resp->getStatusCode();
+                        auto &counter = status >= 200 && status < 300 ? opStats->ok : opStats->non2xx;
+                        counter.fetch_add(1, std::memory_order_relaxed);
+                    },
+                    options.timeout);
+            }
+        };
+        (*tick)();
+    });
+    done.get_future().wait();
+
+    // Give the last requests until the timeout to come back before reading the results.
+    auto drainDeadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.timeout));
+    while (inFlight.load() > 0 && Clock::now() < drainDeadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    auto unfinished = inFlight.load();
+    std::promise<void> drained;
+    auto barrier = std::make_shared<std::atomic<size_t>>(options.threads);
+    for (size_t i = 0; i < options.threads; ++i) {
+        loops.getLoop(i)->queueInLoop([&drained, barrier]() {
+            if (--*barrier == 0) drained.set_value();
+        });
+    }
+    drained.get_future().wait();
+
+    Json::Value report;
+    report["url"] = options.url;
+    report["target_rate"] = options.rate;
+    report["duration_seconds"] = options.duration;
+    report["connections"] = static_cast<Json::UInt64>(options.connections);
+    report["dropped"] = static_cast<Json::UInt64>(dropped.load());
+    report["unfinished"] = static_cast<Json::UInt64>(unfinished);
+
+    std::vector<uint64_t> allCounts(LatencyHistogram::kBuckets, 0);
+    uint64_t allTotal = 0;
+    uint64_t allOk = 0;
+    for (size_t opIndex = 0; opIndex < kOpCount; ++opIndex) {
+        std::vector<uint64_t> counts(LatencyHistogram::kBuckets, 0);
+        uint64_t total = 0;
+        uint64_t ok = 0, non2xx = 0, failed = 0;
+        for (const auto &loopStats : stats) {
+            const auto &opStats = loopStats.ops[opIndex];
+            for (int bucket = 0; bucket < LatencyHistogram::kBuckets; ++bucket) {
+                auto count = opStats.latency.counts[bucket].load(std::memory_order_relaxed);
+                counts[bucket] += count;
+                allCounts[bucket] += count;
+                total += count;
+            }
+            ok += opStats.ok.load();
+            non2xx += opStats.non2xx.load();
+            failed += opStats.failed.load();
+        }
+        allTotal += total;
+        allOk += ok;
+        if (total == 0 && failed == 0) continue;
+
+        Json::Value op;
+        op["requests"] = static_cast<Json::UInt64>(total + failed);
+        op["ok"] = static_cast<Json::UInt64>(ok);
+        op["non_2xx"] = static_cast<Json::UInt64>(non2xx);
+        op["failed"] = static_cast<Json::UInt64>(failed);
+        op["throughput"] = total / options.duration;
+        op["latency_ms"]["p50"] = quantileOf(counts, total, 0.5);
+        op["latency_ms"]["p90"] = quantileOf(counts, total, 0.9);
+        op["latency_ms"]["p99"] = quantileOf(counts, total, 0.99);
+        op["latency_ms"]["p999"] = quantileOf(counts, total, 0.999);
+        report["operations"][kOps[opIndex].name] = op;
+    }
+    report["throughput"] = allTotal / options.duration;
+    report["ok_throughput"] = allOk / options.duration;
+    report["latency_ms"]["p50"] = quantileOf(allCounts, allTotal, 0.5);
+    report["latency_ms"]["p90"] = quantileOf(allCounts, allTotal, 0.9);
+    report["latency_ms"]["p99"] = quantileOf(allCounts, allTotal, 0.99);
+    report["latency_ms"]["p999"] = quantileOf(allCounts, allTotal, 0.999);
+
+    Json::StreamWriterBuilder writer;
+    writer["indentation"] = "  ";
+    std::cout << Json::writeString(writer, report) << std::endl;
+    // Connections still waiting on a stuck server would otherwise keep the loops from exiting.
+    std::_Exit(unfinished > 0 ? 2 : 0);
+}
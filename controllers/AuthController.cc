@@ -1,6 +1,9 @@
 #include <third_party/libbcrypt/include/bcrypt/BCrypt.hpp>
 #include "AuthController.h"
 #include "../plugins/JwtPlugin.h"
+#include "../utils/RequestParser.h"
+#include "../utils/TimedQuery.h"
+#include "../utils/utils.h"
 
 using namespace drogon::orm;
 using namespace drogon_model::org_chart;
@@ -8,17 +11,14 @@ using namespace drogon_model::org_chart;
 namespace drogon {
     template<>
     inline User fromRequest(const HttpRequest &req) {
-        auto jsonPtr = req.getJsonObject();
-        auto json = *jsonPtr;
-        auto user = User(json);
-        return user;
+        return parseUser(req.body());
     }
 }
 
 void AuthController::registerUser(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, User &&pUser) const {
     LOG_DEBUG << "registerUser";
     try {
-        auto dbClientPtr = drogon::app().getDbClient();
+        auto dbClientPtr = dbClient();
         Mapper<User> mp(dbClientPtr);
 
         if (!areFieldsValid(pUser)) {
@@ -41,7 +41,7 @@ void AuthController::registerUser(const HttpRequestPtr &req, std::function<void(
 
         auto newUser = pUser;
         newUser.setPassword(BCrypt::generateHash(newUser.getValueOfPassword()));
-        mp.insertFuture(newUser).get();
+        TimedQuery(req, "users.insert").get(mp.insertFuture(newUser));
 
         auto userWithToken = AuthController::UserWithToken(newUser);
         Json::Value ret = userWithToken.toJson();
@@ -61,7 +61,7 @@ void AuthController::registerUser(const HttpRequestPtr &req, std::function<void(
 void AuthController::loginUser(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, User &&pUser) const {
     LOG_DEBUG << "loginUser";
     try {
-        auto dbClientPtr = drogon::app().getDbClient();
+        auto dbClientPtr = dbClient();
         Mapper<User> mp(dbClientPtr);
 
         if (!areFieldsValid(pUser)) {
@@ -73,7 +73,8 @@ void AuthController::loginUser(const HttpRequestPtr &req, std::function<void(con
             return;
         }
 
-        auto user = mp.findFutureBy(Criteria(User::Cols::_username, CompareOperator::EQ, pUser.getValueOfUsername())).get();
+        auto user = TimedQuery(req, "users.find_by_username")
+                        .get(mp.findFutureBy(Criteria(User::Cols::_username, CompareOperator::EQ, pUser.getValueOfUsername())));
         if (user.empty()) {
             Json::Value ret{};
             ret["error"] = "user not found";
@@ -112,7 +113,7 @@ bool AuthController::areFieldsValid(const User &user) const {
 
 bool AuthController::isUserAvailable(const User &user, Mapper<User> &mp) const {
     auto criteria = Criteria(User::Cols::_username, CompareOperator::EQ, user.getValueOfUsername());
-    return mp.findFutureBy(criteria).get().empty();
+    return TimedQuery(nullptr, "users.find_by_username").get(mp.findFutureBy(criteria)).empty();
 }
 
 bool AuthController::isPasswordValid(const std::string &text, const std::string &hash) const {
@@ -1,8 +1,15 @@
 #include "DepartmentsController.h"
 #include "../utils/utils.h"
-#include "../models/Person.h"
+#include "../utils/ModelEncoding.h"
+#include "../utils/RequestParser.h"
+#include "../utils/TimedQuery.h"
+#include "../utils/Versioning.h"
+#include "../plugins/PersonCachePlugin.h"
+#include "../models/PersonInfo.h"
+#include "PersonsController.h"
 #include <string>
 #include <memory>
+#include <optional>
 #include <utility>
 #include <vector>
 
@@ -12,10 +19,7 @@ using namespace drogon_model::org_chart;
 namespace drogon {
     template<>
     inline Department fromRequest(const HttpRequest &req) {
-        auto jsonPtr = req.getJsonObject();
-        auto json = *jsonPtr;
-        auto department = Department(json);
-        return department;
+        return parseDepartment(req.body());
     }
 }  // namespace drogon
 
@@ -26,12 +30,19 @@ void DepartmentsController::get(const HttpRequestPtr &req, std::function<void(co
     auto sortField = req->getOptionalParameter<std::string>("sort_field").value_or("id");
     auto sortOrder = req->getOptionalParameter<std::string>("sort_order").value_or("asc");
     auto sortOrderEnum = sortOrder == "asc" ? SortOrder::ASC : SortOrder::DESC;
+    auto format = negotiateFormat(req);
+    callback = varyOnAccept(std::move(callback));
 
     auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr &)>>(std::move(callback));
-    auto dbClientPtr = drogon::app().getDbClient();
+    auto dbClientPtr = dbClient();
     Mapper<Department> mp(dbClientPtr);
+    TimedQuery timed(req, "department.list");
     mp.orderBy(sortField, sortOrderEnum).offset(offset).limit(limit).findAll(
-        [callbackPtr](const std::vector<Department> &departments) {
+        timed.wrap([callbackPtr, format](const std::vector<Department> &departments) {
+            if (format != ResponseFormat::Json) {
+                (*callbackPtr)(newBinaryResponse(format, departments));
+                return;
+            }
             Json::Value ret{};
             for (auto d : departments) {
                 ret.append(d.toJson());
@@ -39,171 +50,199 @@ void DepartmentsController::get(const HttpRequestPtr &req, std::function<void(co
             auto resp = HttpResponse::newHttpJsonResponse(ret);
             resp->setStatusCode(HttpStatusCode::k200OK);
             (*callbackPtr)(resp);
-        },
-        [callbackPtr](const DrogonDbException &e) {
+        }),
+        timed.wrap([callbackPtr](const DrogonDbException &e) {
             LOG_ERROR << e.base().what();
             auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("database error"));
             resp->setStatusCode(HttpStatusCode::k500InternalServerError);
             (*callbackPtr)(resp);
-    });
+    }));
 }
 
 void DepartmentsController::getOne(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, int departmentId) const {
     LOG_DEBUG << "getOne departmentId: "<< departmentId;
+    auto format = negotiateFormat(req);
+    callback = varyOnAccept(std::move(callback));
     auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr &)>>(std::move(callback));
-    auto dbClientPtr = drogon::app().getDbClient();
-
-    Mapper<Department> mp(dbClientPtr);
-    mp.findByPrimaryKey(
-        departmentId,
-        [callbackPtr](const Department &department) {
-            Json::Value ret{};
-            ret = department.toJson();
-            auto resp = HttpResponse::newHttpJsonResponse(ret);
-            resp->setStatusCode(HttpStatusCode::k201Created);
-            (*callbackPtr)(resp);
-        },
-        [callbackPtr](const DrogonDbException &e) {
-            const drogon::orm::UnexpectedRows *s = dynamic_cast<const drogon::orm::UnexpectedRows *>(&e.base());
-            if(s) {
-                auto resp = HttpResponse::newHttpResponse();
-                resp->setStatusCode(k404NotFound);
-                (*callbackPtr)(resp);
-                return;
-            }
-            LOG_ERROR << e.base().what();
-            auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("database error"));
-            resp->setStatusCode(HttpStatusCode::k500InternalServerError);
-            (*callbackPtr)(resp);
-    });
+    auto dbClientPtr = dbClient();
+
+    // read through SQL rather than Mapper so the row version is available for the ETag
+    TimedQuery timed(req, "department.get_one");
+    *dbClientPtr << "select * from department where id = $1"
+                 << departmentId
+                 >> timed.onResult([callbackPtr, format](const Result &result)
+                   {
+                      if (result.empty()) {
+                          auto resp = HttpResponse::newHttpResponse();
+                          resp->setStatusCode(k404NotFound);
+                          (*callbackPtr)(resp);
+                          return;
+                      }
+                      Department department{result[0]};
+                      auto etag = versionETag(result[0]["version"].as<int32_t>());
+                      if (format != ResponseFormat::Json) {
+                          auto resp = newBinaryResponse(format, department);
+                          resp->addHeader("ETag", etag);
+                          (*callbackPtr)(resp);
+                          return;
+                      }
+                      Json::Value ret{};
+                      ret = department.toJson();
+                      auto resp = HttpResponse::newHttpJsonResponse(ret);
+                      resp->setStatusCode(HttpStatusCode::k200OK);
+                      resp->addHeader("ETag", etag);
+                      (*callbackPtr)(resp);
+                   })
+                 >> timed.onError([callbackPtr](const DrogonDbException &e)
+                   {
+                      LOG_ERROR << e.base().what();
+                      auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("database error"));
+                      resp->setStatusCode(HttpStatusCode::k500InternalServerError);
+                      (*callbackPtr)(resp);
+                   });
 }
 
 void DepartmentsController::createOne(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, Department &&pDepartment) const {
     LOG_DEBUG << "createOne";
+    auto format = negotiateFormat(req);
+    callback = varyOnAccept(std::move(callback));
     auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr &)>>(std::move(callback));
-    auto dbClientPtr = drogon::app().getDbClient();
+    auto dbClientPtr = dbClient();
 
     Mapper<Department> mp(dbClientPtr);
+    TimedQuery timed(req, "department.insert");
     mp.insert(
         pDepartment,
-        [callbackPtr](const Department &department) {
+        timed.wrap([callbackPtr, format](const Department &department) {
+            if (format != ResponseFormat::Json) {
+                auto resp = newBinaryResponse(format, department);
+                resp->setStatusCode(HttpStatusCode::k201Created);
+                (*callbackPtr)(resp);
+                return;
+            }
             Json::Value ret{};
             ret = department.toJson();
             auto resp = HttpResponse::newHttpJsonResponse(ret);
             resp->setStatusCode(HttpStatusCode::k201Created);
             (*callbackPtr)(resp);
-        },
-        [callbackPtr](const DrogonDbException &e) {
+        }),
+        timed.wrap([callbackPtr](const DrogonDbException &e) {
             LOG_ERROR << e.base().what();
             auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("database error"));
             resp->setStatusCode(HttpStatusCode::k500InternalServerError);
             (*callbackPtr)(resp);
-    });
+    }));
 }
 
 void DepartmentsController::updateOne(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, int departmentId, Department &&pDepartmentDetails) const {
     LOG_DEBUG << "updateOne departmentId: " << departmentId;
-    auto dbClientPtr = drogon::app().getDbClient();
-
-    // blocking IO
-    Mapper<Department> mp(dbClientPtr);
-    Department department;
-    try {
-        department = mp.findFutureByPrimaryKey(departmentId).get();
-    } catch (const DrogonDbException & e) {
-        Json::Value ret{};
-        ret["error"] = "resource not found";
-        auto resp = HttpResponse::newHttpJsonResponse(ret);
-        resp->setStatusCode(HttpStatusCode::k404NotFound);
-        callback(resp);
-    }
-
-    if (pDepartmentDetails.getName() != nullptr) {
-        department.setName(pDepartmentDetails.getValueOfName());
+    std::optional<int32_t> expectedVersion;
+    if (!parseIfMatch(req, expectedVersion)) {
+        badRequest(std::move(callback), "If-Match must be an ETag returned by this API");
+        return;
     }
 
     auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr &)>>(std::move(callback));
-    mp.update(
-        department,
-        [callbackPtr](const std::size_t count)
-        {
-            auto resp = HttpResponse::newHttpResponse();
-            resp->setStatusCode(HttpStatusCode::k204NoContent);
-            (*callbackPtr)(resp);
-        },
-        [callbackPtr](const DrogonDbException &e)
-        {
-            LOG_ERROR << e.base().what();
-            auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("database error"));
-            resp->setStatusCode(HttpStatusCode::k500InternalServerError);
-            (*callbackPtr)(resp);
-        }
-    );
+    auto dbClientPtr = dbClient();
+    const std::string sql = "update department set name = coalesce($2, name), version = version + 1 \n\
+                where id = $1 and ($3::int is null or version = $3) \n\
+                returning *";
+
+    TimedQuery timed(req, "department.update");
+    *dbClientPtr << sql
+                 << departmentId
+                 << optionalOf(pDepartmentDetails.getName())
+                 << expectedVersion
+                 >> timed.onResult([callbackPtr, dbClientPtr, departmentId, expectedVersion](const Result &result)
+                   {
+                      if (!result.empty()) {
+                          // cached persons embed the department; other instances hear from ChangeListenerPlugin
+                          if (auto *cachePtr = drogon::app().getPlugin<PersonCachePlugin>()) {
+                              cachePtr->invalidate("department", departmentId);
+                          }
+                      }
+                      respondToVersionedUpdate(result, dbClientPtr, "department", departmentId,
+                                               expectedVersion.has_value(), callbackPtr);
+                   })
+                 >> timed.onError([callbackPtr](const DrogonDbException &e)
+                   {
+                      LOG_ERROR << e.base().what();
+                      auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("database error"));
+                      resp->setStatusCode(HttpStatusCode::k500InternalServerError);
+                      (*callbackPtr)(resp);
+                   });
 }
 
 void DepartmentsController::deleteOne(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, int departmentId) const {
     LOG_DEBUG << "deleteOne departmentId: ";
     auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr &)>>(std::move(callback));
-    auto dbClientPtr = drogon::app().getDbClient();
+    auto dbClientPtr = dbClient();
 
     Mapper<Department> mp(dbClientPtr);
+    TimedQuery timed(req, "department.delete");
     mp.deleteBy(
         Criteria(Department::Cols::_id, CompareOperator::EQ, departmentId),
-        [callbackPtr](const std::size_t count) {
+        timed.wrap([callbackPtr, departmentId](const std::size_t count) {
+            if (auto *cachePtr = drogon::app().getPlugin<PersonCachePlugin>()) {
+                cachePtr->invalidate("department", departmentId);
+            }
             auto resp = HttpResponse::newHttpResponse();
             resp->setStatusCode(HttpStatusCode::k204NoContent);
             (*callbackPtr)(resp);
-        },
-        [callbackPtr](const DrogonDbException &e) {
+        }),
+        timed.wrap([callbackPtr](const DrogonDbException &e) {
             LOG_ERROR << e.base().what();
             auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("database error"));
             resp->setStatusCode(HttpStatusCode::k500InternalServerError);
             (*callbackPtr)(resp);
-    });
+    }));
 }
 
 void DepartmentsController::getDepartmentPersons(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, int departmentId) const {
     LOG_DEBUG << "getDepartmentPersons departmentId: "<< departmentId;
-    auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr &)>>(std::move(callback));
-    auto dbClientPtr = drogon::app().getDbClient();
-
-    // blocking IO
-    Mapper<Department> mp(dbClientPtr);
-    Department department;
-    try {
-        department = mp.findFutureByPrimaryKey(departmentId).get();
-    } catch (const DrogonDbException & e) {
-        Json::Value ret{};
-        ret["error"] = "resource not found";
-        auto resp = HttpResponse::newHttpJsonResponse(ret);
-        resp->setStatusCode(HttpStatusCode::k404NotFound);
-        callback(resp);
-    }
+    auto limit = req->getOptionalParameter<int>("limit").value_or(25);
+    auto offset = req->getOptionalParameter<int>("offset").value_or(0);
+    auto format = negotiateFormat(req);
+    callback = varyOnAccept(std::move(callback));
 
-    department.getPersons(dbClientPtr,
-      [callbackPtr](const std::vector<Person> persons) {
-          if (persons.empty()) {
-              Json::Value ret{};
-              ret["error"] = "resource not found";
-              auto resp = HttpResponse::newHttpJsonResponse(ret);
-              resp->setStatusCode(HttpStatusCode::k404NotFound);
-              (*callbackPtr)(resp);
-          } else {
-              Json::Value ret{};
-              for (auto p : persons) {
-                  ret.append(p.toJson());
-              }
-              auto resp = HttpResponse::newHttpJsonResponse(ret);
-              resp->setStatusCode(HttpStatusCode::k200OK);
-              (*callbackPtr)(resp);
-          }
-      },
-      [callbackPtr](const DrogonDbException &e) {
-          LOG_ERROR << e.base().what();
-          Json::Value ret{};
-          ret["error"] = "database error";
-          auto resp = HttpResponse::newHttpJsonResponse(ret);
-          resp->setStatusCode(HttpStatusCode::k500InternalServerError);
-          (*callbackPtr)(resp);
-      });
+    auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr &)>>(std::move(callback));
+    auto dbClientPtr = dbClient();
+    auto sql = PersonInfo::sqlForSelecting() + " where department_id = $1 order by id limit $2 offset $3";
+
+    TimedQuery timed(req, "department.members");
+    *dbClientPtr << sql
+                 << departmentId
+                 << std::to_string(limit)
+                 << std::to_string(offset)
+                 >> timed.onResult([callbackPtr, dbClientPtr, format, departmentId](const Result &result)
+                   {
+                      // an empty page is only a 404 when there is no such department
+                      if (result.empty()) {
+                          respondToEmptyPage(dbClientPtr, "department", departmentId, format, callbackPtr);
+                          return;
+                      }
+
+                      if (format != ResponseFormat::Json) {
+                          (*callbackPtr)(newPersonDetailsResponse(format, result));
+                          return;
+                      }
+
+                      Json::Value ret{};
+                      for (auto row : result) {
+                          PersonInfo personInfo{row};
+                          PersonsController::PersonDetails personDetails{personInfo};
+                          ret.append(personDetails.toJson());
+                      }
+
+                      auto resp = HttpResponse::newHttpJsonResponse(ret);
+                      resp->setStatusCode(HttpStatusCode::k200OK);
+                      (*callbackPtr)(resp);
+                   })
+                 >> timed.onError([callbackPtr](const DrogonDbException &e)
+                   {
+                      LOG_ERROR << e.base().what();
+                      auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("database error"));
+                      resp->setStatusCode(HttpStatusCode::k500InternalServerError);
+                      (*callbackPtr)(resp);
+                   });
 }
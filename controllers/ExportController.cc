@@ -0,0 +1,56 @@
+#include "ExportController.h"
+#include "PersonsController.h"
+#include "../models/Department.h"
+#include "../models/Job.h"
+#include "../models/PersonInfo.h"
+#include "../utils/CursorStream.h"
+#include "../utils/utils.h"
+#include <memory>
+#include <sstream>
+#include <string>
+
+using namespace drogon::orm;
+using namespace drogon_model::org_chart;
+
+namespace {
+    // One writer per stream; jsoncpp writers are not thread safe but each stream renders its
+    // batches on one DB callback at a time.
+    CursorStream::RowWriter jsonLines(std::function<Json::Value(const Row &)> toJson) {
+        Json::StreamWriterBuilder builder;
+        builder["indentation"] = "";
+        std::shared_ptr<Json::StreamWriter> jsonWriter(builder.newStreamWriter());
+        return [jsonWriter, toJson = std::move(toJson)](const Row &row, std::string &out) {
+            std::ostringstream line;
+            jsonWriter->write(toJson(row), &line);
+            out += line.str();
+            out += '\n';
+        };
+    }
+
+    HttpResponsePtr newNdjsonResponse(const HttpRequestPtr &req, const std::string &query, CursorStream::RowWriter writer) {
+        return CursorStream::newResponse(req, exportDbClient(), query, std::move(writer), "application/x-ndjson");
+    }
+}  // namespace
+
+void ExportController::exportPersons(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback) const {
+    LOG_DEBUG << "exportPersons";
+    callback(newNdjsonResponse(req, PersonInfo::sqlForSelecting() + " order by id", jsonLines([](const Row &row) {
+        PersonInfo personInfo{row};
+        PersonsController::PersonDetails personDetails{personInfo};
+        return personDetails.toJson();
+    })));
+}
+
+void ExportController::exportDepartments(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback) const {
+    LOG_DEBUG << "exportDepartments";
+    callback(newNdjsonResponse(req, "select * from department order by id", jsonLines([](const Row &row) {
+        return Department(row).toJson();
+    })));
+}
+
+void ExportController::exportJobs(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback) const {
+    LOG_DEBUG << "exportJobs";
+    callback(newNdjsonResponse(req, "select * from job order by id", jsonLines([](const Row &row) {
+        return Job(row).toJson();
+    })));
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <drogon/HttpController.h>
+
+using namespace drogon;
+
+// Whole-table dumps as newline delimited JSON, streamed from a server-side cursor.
+class ExportController : public drogon::HttpController<ExportController> {
+ public:
+    METHOD_LIST_BEGIN
+      ADD_METHOD_TO(ExportController::exportPersons, "/export/persons.ndjson", Get, "LoginFilter");
+      ADD_METHOD_TO(ExportController::exportDepartments, "/export/departments.ndjson", Get, "LoginFilter");
+      ADD_METHOD_TO(ExportController::exportJobs, "/export/jobs.ndjson", Get, "LoginFilter");
+    METHOD_LIST_END
+
+    void exportPersons(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback) const;
+    void exportDepartments(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback) const;
+    void exportJobs(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback) const;
+};
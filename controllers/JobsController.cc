@@ -1,8 +1,15 @@
 #include "JobsController.h"
 #include "../utils/utils.h"
-#include "../models/Person.h"
+#include "../utils/ModelEncoding.h"
+#include "../utils/RequestParser.h"
+#include "../utils/TimedQuery.h"
+#include "../utils/Versioning.h"
+#include "../plugins/PersonCachePlugin.h"
+#include "../models/PersonInfo.h"
+#include "PersonsController.h"
 #include <string>
 #include <memory>
+#include <optional>
 #include <utility>
 #include <vector>
 
@@ -12,9 +19,7 @@ using namespace drogon_model::org_chart;
 namespace drogon {
     template<>
     inline Job fromRequest(const HttpRequest &req) {
-        auto json = req.getJsonObject();
-        auto job = Job(*json);
-        return job;
+        return parseJob(req.body());
     }
 }
 
@@ -25,12 +30,19 @@ void JobsController::get(const HttpRequestPtr &req, std::function<void(const Htt
     auto sortField = req->getOptionalParameter<std::string>("sort_field").value_or("id");
     auto sortOrder = req->getOptionalParameter<std::string>("sort_order").value_or("asc");
     auto sortOrderEnum = sortOrder == "asc" ? SortOrder::ASC : SortOrder::DESC;
+    auto format = negotiateFormat(req);
+    callback = varyOnAccept(std::move(callback));
 
     auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr &)>>(std::move(callback));
-    auto dbClientPtr = drogon::app().getDbClient();
+    auto dbClientPtr = dbClient();
     Mapper<Job> mp(dbClientPtr);
+    TimedQuery timed(req, "job.list");
     mp.orderBy(sortField, sortOrderEnum).offset(offset).limit(limit).findAll(
-        [callbackPtr](const std::vector<Job> &jobs) {
+        timed.wrap([callbackPtr, format](const std::vector<Job> &jobs) {
+            if (format != ResponseFormat::Json) {
+                (*callbackPtr)(newBinaryResponse(format, jobs));
+                return;
+            }
             Json::Value ret{};
             for (auto j : jobs) {
                 ret.append(j.toJson());
@@ -38,181 +50,199 @@ void JobsController::get(const HttpRequestPtr &req, std::function<void(const Htt
             auto resp = HttpResponse::newHttpJsonResponse(ret);
             resp->setStatusCode(HttpStatusCode::k200OK);
             (*callbackPtr)(resp);
-        },
-        [callbackPtr](const DrogonDbException &e) {
+        }),
+        timed.wrap([callbackPtr](const DrogonDbException &e) {
             LOG_ERROR << e.base().what();
             auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("database error"));
             resp->setStatusCode(HttpStatusCode::k500InternalServerError);
             (*callbackPtr)(resp);
-    });
+    }));
 }
 
 void JobsController::getOne(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, int jobId) const {
     LOG_DEBUG << "getOne jobId: "<< jobId;
+    auto format = negotiateFormat(req);
+    callback = varyOnAccept(std::move(callback));
     auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr &)>>(std::move(callback));
-    auto dbClientPtr = drogon::app().getDbClient();
-
-    Mapper<Job> mp(dbClientPtr);
-    mp.findByPrimaryKey(
-        jobId,
-        [callbackPtr](const Job &job) {
-            Json::Value ret{};
-            ret = job.toJson();
-            auto resp = HttpResponse::newHttpJsonResponse(ret);
-            resp->setStatusCode(HttpStatusCode::k201Created);
-            (*callbackPtr)(resp);
-        },
-        [callbackPtr](const DrogonDbException &e) {
-            const drogon::orm::UnexpectedRows *s = dynamic_cast<const drogon::orm::UnexpectedRows *>(&e.base());
-            if(s) {
-                auto resp = HttpResponse::newHttpResponse();
-                resp->setStatusCode(k404NotFound);
-                (*callbackPtr)(resp);
-                return;
-            }
-            LOG_ERROR << e.base().what();
-            auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("database error"));
-            resp->setStatusCode(HttpStatusCode::k500InternalServerError);
-            (*callbackPtr)(resp);
-    });
+    auto dbClientPtr = dbClient();
+
+    // read through SQL rather than Mapper so the row version is available for the ETag
+    TimedQuery timed(req, "job.get_one");
+    *dbClientPtr << "select * from job where id = $1"
+                 << jobId
+                 >> timed.onResult([callbackPtr, format](const Result &result)
+                   {
+                      if (result.empty()) {
+                          auto resp = HttpResponse::newHttpResponse();
+                          resp->setStatusCode(k404NotFound);
+                          (*callbackPtr)(resp);
+                          return;
+                      }
+                      Job job{result[0]};
+                      auto etag = versionETag(result[0]["version"].as<int32_t>());
+                      if (format != ResponseFormat::Json) {
+                          auto resp = newBinaryResponse(format, job);
+                          resp->addHeader("ETag", etag);
+                          (*callbackPtr)(resp);
+                          return;
+                      }
+                      Json::Value ret{};
+                      ret = job.toJson();
+                      auto resp = HttpResponse::newHttpJsonResponse(ret);
+                      resp->setStatusCode(HttpStatusCode::k200OK);
+                      resp->addHeader("ETag", etag);
+                      (*callbackPtr)(resp);
+                   })
+                 >> timed.onError([callbackPtr](const DrogonDbException &e)
+                   {
+                      LOG_ERROR << e.base().what();
+                      auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("database error"));
+                      resp->setStatusCode(HttpStatusCode::k500InternalServerError);
+                      (*callbackPtr)(resp);
+                   });
 }
 
 void JobsController::createOne(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, Job &&pJob) const {
     LOG_DEBUG << "createOne";
+    auto format = negotiateFormat(req);
+    callback = varyOnAccept(std::move(callback));
     auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr &)>>(std::move(callback));
-    auto dbClientPtr = drogon::app().getDbClient();
+    auto dbClientPtr = dbClient();
 
     Mapper<Job> mp(dbClientPtr);
+    TimedQuery timed(req, "job.insert");
     mp.insert(
         pJob,
-        [callbackPtr](const Job &job) {
+        timed.wrap([callbackPtr, format](const Job &job) {
+            if (format != ResponseFormat::Json) {
+                auto resp = newBinaryResponse(format, job);
+                resp->setStatusCode(HttpStatusCode::k201Created);
+                (*callbackPtr)(resp);
+                return;
+            }
             Json::Value ret{};
             ret = job.toJson();
             auto resp = HttpResponse::newHttpJsonResponse(ret);
             resp->setStatusCode(HttpStatusCode::k201Created);
             (*callbackPtr)(resp);
-        },
-        [callbackPtr](const DrogonDbException &e) {
+        }),
+        timed.wrap([callbackPtr](const DrogonDbException &e) {
             LOG_ERROR << e.base().what();
             auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("database error"));
             resp->setStatusCode(HttpStatusCode::k500InternalServerError);
             (*callbackPtr)(resp);
-    });
+    }));
 }
 
 void JobsController::updateOne(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, int jobId, Job &&pJobDetails) const {
     LOG_DEBUG << "updateOne jobId: " << jobId;
-    auto jsonPtr = req->jsonObject();
-    if (!jsonPtr) {
-      Json::Value ret{};
-      ret["error"]="No json object is found in the request";
-      auto resp = HttpResponse::newHttpResponse();
-      resp->setStatusCode(HttpStatusCode::k400BadRequest);
-      callback(resp);
-      return;
-    }
-
-    auto dbClientPtr = drogon::app().getDbClient();
-
-    // blocking IO
-    Mapper<Job> mp(dbClientPtr);
-    Job job;
-    try {
-        job = mp.findFutureByPrimaryKey(jobId).get();
-    } catch (const DrogonDbException & e) {
-        Json::Value ret{};
-        ret["error"] = "resource not found";
-        auto resp = HttpResponse::newHttpJsonResponse(ret);
-        resp->setStatusCode(HttpStatusCode::k404NotFound);
-        callback(resp);
-    }
-
-    if (pJobDetails.getTitle() != nullptr) {
-        job.setTitle(pJobDetails.getValueOfTitle());
+    std::optional<int32_t> expectedVersion;
+    if (!parseIfMatch(req, expectedVersion)) {
+        badRequest(std::move(callback), "If-Match must be an ETag returned by this API");
+        return;
     }
 
     auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr &)>>(std::move(callback));
-    mp.update(
-        job,
-        [callbackPtr](const std::size_t count)
-        {
-            auto resp = HttpResponse::newHttpResponse();
-            resp->setStatusCode(HttpStatusCode::k204NoContent);
-            (*callbackPtr)(resp);
-        },
-        [callbackPtr](const DrogonDbException &e)
-        {
-            LOG_ERROR << e.base().what();
-            auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("database error"));
-            resp->setStatusCode(HttpStatusCode::k500InternalServerError);
-            (*callbackPtr)(resp);
-        }
-    );
+    auto dbClientPtr = dbClient();
+    const std::string sql = "update job set title = coalesce($2, title), version = version + 1 \n\
+                where id = $1 and ($3::int is null or version = $3) \n\
+                returning *";
+
+    TimedQuery timed(req, "job.update");
+    *dbClientPtr << sql
+                 << jobId
+                 << optionalOf(pJobDetails.getTitle())
+                 << expectedVersion
+                 >> timed.onResult([callbackPtr, dbClientPtr, jobId, expectedVersion](const Result &result)
+                   {
+                      if (!result.empty()) {
+                          // cached persons embed the job; other instances hear from ChangeListenerPlugin
+                          if (auto *cachePtr = drogon::app().getPlugin<PersonCachePlugin>()) {
+                              cachePtr->invalidate("job", jobId);
+                          }
+                      }
+                      respondToVersionedUpdate(result, dbClientPtr, "job", jobId,
+                                               expectedVersion.has_value(), callbackPtr);
+                   })
+                 >> timed.onError([callbackPtr](const DrogonDbException &e)
+                   {
+                      LOG_ERROR << e.base().what();
+                      auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("database error"));
+                      resp->setStatusCode(HttpStatusCode::k500InternalServerError);
+                      (*callbackPtr)(resp);
+                   });
 }
 
 void JobsController::deleteOne(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, int jobId) const {
     LOG_DEBUG << "deleteOne jobId: ";
     auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr &)>>(std::move(callback));
-    auto dbClientPtr = drogon::app().getDbClient();
+    auto dbClientPtr = dbClient();
 
     Mapper<Job> mp(dbClientPtr);
+    TimedQuery timed(req, "job.delete");
     mp.deleteBy(
         Criteria(Job::Cols::_id, CompareOperator::EQ, jobId),
-        [callbackPtr](const std::size_t count) {
+        timed.wrap([callbackPtr, jobId](const std::size_t count) {
+            if (auto *cachePtr = drogon::app().getPlugin<PersonCachePlugin>()) {
+                cachePtr->invalidate("job", jobId);
+            }
             auto resp = HttpResponse::newHttpResponse();
             resp->setStatusCode(HttpStatusCode::k204NoContent);
             (*callbackPtr)(resp);
-        },
-        [callbackPtr](const DrogonDbException &e) {
+        }),
+        timed.wrap([callbackPtr](const DrogonDbException &e) {
             LOG_ERROR << e.base().what();
             auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("database error"));
             resp->setStatusCode(HttpStatusCode::k500InternalServerError);
             (*callbackPtr)(resp);
-    });
+    }));
 }
 
 void JobsController::getJobPersons(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, int jobId) const {
     LOG_DEBUG << "getJobPersons jobId: "<< jobId;
-    auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr &)>>(std::move(callback));
-    auto dbClientPtr = drogon::app().getDbClient();
-
-    // blocking IO
-    Mapper<Job> mp(dbClientPtr);
-    Job job;
-    try {
-        job = mp.findFutureByPrimaryKey(jobId).get();
-    } catch (const DrogonDbException & e) {
-        Json::Value ret{};
-        ret["error"] = "resource not found";
-        auto resp = HttpResponse::newHttpJsonResponse(ret);
-        resp->setStatusCode(HttpStatusCode::k404NotFound);
-        callback(resp);
-    }
+    auto limit = req->getOptionalParameter<int>("limit").value_or(25);
+    auto offset = req->getOptionalParameter<int>("offset").value_or(0);
+    auto format = negotiateFormat(req);
+    callback = varyOnAccept(std::move(callback));
 
-    job.getPersons(dbClientPtr,
-        [callbackPtr](const std::vector<Person> persons) {
-           if (persons.empty()) {
-              Json::Value ret{};
-              ret["error"] = "resource not found";
-              auto resp = HttpResponse::newHttpJsonResponse(ret);
-              resp->setStatusCode(HttpStatusCode::k404NotFound);
-              (*callbackPtr)(resp);
-          } else {
-              Json::Value ret{};
-              for (auto p : persons) {
-                  ret.append(p.toJson());
-              }
-              auto resp = HttpResponse::newHttpJsonResponse(ret);
-              resp->setStatusCode(HttpStatusCode::k200OK);
-              (*callbackPtr)(resp);
-          }
-        },
-        [callbackPtr](const DrogonDbException &e) {
-          LOG_ERROR << e.base().what();
-          Json::Value ret{};
-          ret["error"] = "database error";
-          auto resp = HttpResponse::newHttpJsonResponse(ret);
-          resp->setStatusCode(HttpStatusCode::k500InternalServerError);
-          (*callbackPtr)(resp);
-        });
+    auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr &)>>(std::move(callback));
+    auto dbClientPtr = dbClient();
+    auto sql = PersonInfo::sqlForSelecting() + " where job_id = $1 order by id limit $2 offset $3";
+
+    TimedQuery timed(req, "job.members");
+    *dbClientPtr << sql
+                 << jobId
+                 << std::to_string(limit)
+                 << std::to_string(offset)
+                 >> timed.onResult([callbackPtr, dbClientPtr, format, jobId](const Result &result)
+                   {
+                      // an empty page is only a 404 when there is no such job
+                      if (result.empty()) {
+                          respondToEmptyPage(dbClientPtr, "job", jobId, format, callbackPtr);
+                          return;
+                      }
+
+                      if (format != ResponseFormat::Json) {
+                          (*callbackPtr)(newPersonDetailsResponse(format, result));
+                          return;
+                      }
+
+                      Json::Value ret{};
+                      for (auto row : result) {
+                          PersonInfo personInfo{row};
+                          PersonsController::PersonDetails personDetails{personInfo};
+                          ret.append(personDetails.toJson());
+                      }
+
+                      auto resp = HttpResponse::newHttpJsonResponse(ret);
+                      resp->setStatusCode(HttpStatusCode::k200OK);
+                      (*callbackPtr)(resp);
+                   })
+                 >> timed.onError([callbackPtr](const DrogonDbException &e)
+                   {
+                      LOG_ERROR << e.base().what();
+                      auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("database error"));
+                      resp->setStatusCode(HttpStatusCode::k500InternalServerError);
+                      (*callbackPtr)(resp);
+                   });
 }
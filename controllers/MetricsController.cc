@@ -0,0 +1,10 @@
+#include "MetricsController.h"
+#include "../utils/Metrics.h"
+
+void MetricsController::get(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback) const {
+    auto resp = HttpResponse::newHttpResponse();
+    resp->setStatusCode(HttpStatusCode::k200OK);
+    resp->setContentTypeCodeAndCustomString(CT_TEXT_PLAIN, "text/plain; version=0.0.4; charset=utf-8");
+    resp->setBody(MetricsRegistry::instance().render());
+    callback(resp);
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <drogon/HttpController.h>
+
+using namespace drogon;
+
+class MetricsController : public drogon::HttpController<MetricsController> {
+ public:
+    METHOD_LIST_BEGIN
+      ADD_METHOD_TO(MetricsController::get, "/metrics", Get);
+    METHOD_LIST_END
+
+    void get(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback) const;
+};
@@ -1,6 +1,18 @@
 #include "PersonsController.h"
 #include "../utils/utils.h"
+#include "../utils/ModelEncoding.h"
+#include "../utils/PersonFields.h"
+#include "../utils/RequestParser.h"
+#include "../utils/TimedQuery.h"
+#include "../utils/Tracing.h"
+#include "../utils/Versioning.h"
+#include "../plugins/OrgTreePlugin.h"
+#include "../plugins/PersonCachePlugin.h"
+#include <algorithm>
+#include <charconv>
 #include <memory>
+#include <optional>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 #include <regex>
@@ -11,48 +23,184 @@ using namespace drogon_model::org_chart;
 namespace drogon {
     template<>
     inline Person fromRequest(const HttpRequest &req) {
-        auto jsonPtr = req.getJsonObject();
-        auto json = *jsonPtr;
-        if (json["department_id"]) json["department_id"] = std::stoi(json["department_id"].asString());
-        if (json["manager_id"]) json["manager_id"] = std::stoi(json["manager_id"].asString());
-        if (json["job_id"]) json["job_id"] = std::stoi(json["job_id"].asString());
-        auto person = Person(json);
-        return person;
+        return parsePerson(req.body());
     }
 }  // namespace drogon
 
+namespace {
+    const std::size_t kMaxLookupIds = 1000;
+
+    // "1,2,3" from ?ids=; false on anything but a non-empty list of integers.
+    bool parseIdList(const std::string &param, std::vector<int> &ids) {
+        std::size_t pos = 0;
+        while (pos <= param.size()) {
+            auto end = std::min(param.find(',', pos), param.size());
+            int id;
+            auto result = std::from_chars(param.data() + pos, param.data() + end, id);
+            if (result.ec != std::errc() || result.ptr != param.data() + end) return false;
+            ids.push_back(id);
+            pos = end + 1;
+        }
+        return !ids.empty();
+    }
+
+    // Answers a multi-get with one entry per requested id, in request order; ids without a
+    // person get {"id": ..., "error": "resource not found"} in their slot.
+    void respondWithPersons(const HttpRequestPtr &req, const std::vector<int> &ids, ResponseFormat format,
+                            std::function<void(const HttpResponsePtr &)> &&callback) {
+        if (ids.size() > kMaxLookupIds) {
+            badRequest(std::move(callback), "at most " + std::to_string(kMaxLookupIds) + " ids per lookup");
+            return;
+        }
+
+        std::string idArray = "{";
+        for (auto id : ids) {
+            if (idArray.size() > 1) idArray += ',';
+            idArray += std::to_string(id);
+        }
+        idArray += '}';
+
+        auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr &)>>(std::move(callback));
+        auto dbClientPtr = dbClient();
+        TimedQuery timed(req, "person.lookup");
+        *dbClientPtr << PersonInfo::sqlForSelecting() + " where id = any($1::int[])"
+                     << idArray
+                     >> timed.onResult([callbackPtr, req, ids, format](const Result &result)
+                       {
+                          TraceSpan span(req, "serialize");
+                          std::unordered_map<int, PersonInfo> found;
+                          for (const auto &row : result) {
+                              PersonInfo personInfo{row};
+                              found.emplace(personInfo.getValueOfId(), std::move(personInfo));
+                          }
+
+                          if (format != ResponseFormat::Json) {
+                              BinaryEncoder encoder(format);
+                              encoder.beginArray(ids.size());
+                              for (auto id : ids) {
+                                  auto it = found.find(id);
+                                  if (it != found.end()) {
+                                      encodePersonDetails(encoder, it->second);
+                                      continue;
+                                  }
+                                  encoder.beginMap(2);
+                                  encoder.add("id");
+                                  encoder.add(static_cast<int64_t>(id));
+                                  encoder.add("error");
+                                  encoder.add("resource not found");
+                              }
+                              auto resp = newBinaryResponse(format, encoder.take());
+                              span.end();
+                              (*callbackPtr)(resp);
+                              return;
+                          }
+
+                          Json::Value ret{Json::arrayValue};
+                          for (auto id : ids) {
+                              auto it = found.find(id);
+                              if (it != found.end()) {
+                                  PersonsController::PersonDetails personDetails{it->second};
+                                  ret.append(personDetails.toJson());
+                                  continue;
+                              }
+                              auto missing = makeErrResp("resource not found");
+                              missing["id"] = id;
+                              ret.append(missing);
+                          }
+                          auto resp = HttpResponse::newHttpJsonResponse(ret);
+                          resp->setStatusCode(HttpStatusCode::k200OK);
+                          span.end();
+                          (*callbackPtr)(resp);
+                       })
+                     >> timed.onError([callbackPtr](const DrogonDbException &e)
+                       {
+                          LOG_ERROR << e.base().what();
+                          auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("database error"));
+                          resp->setStatusCode(HttpStatusCode::k500InternalServerError);
+                          (*callbackPtr)(resp);
+                       });
+    }
+}  // namespace
+
 void PersonsController::get(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback) const {
     LOG_DEBUG << "get";
     auto sort_field = req->getOptionalParameter<std::string>("sort_field").value_or("id");
     auto sort_order = req->getOptionalParameter<std::string>("sort_order").value_or("asc");
     auto limit = req->getOptionalParameter<int>("limit").value_or(25);
     auto offset = req->getOptionalParameter<int>("offset").value_or(0);
+    auto format = negotiateFormat(req);
+    callback = varyOnAccept(std::move(callback));
+    if (auto idsParam = req->getOptionalParameter<std::string>("ids")) {
+        std::vector<int> ids;
+        if (!parseIdList(*idsParam, ids)) {
+            badRequest(std::move(callback), "ids must be a comma separated list of integers");
+            return;
+        }
+        respondWithPersons(req, ids, format, std::move(callback));
+        return;
+    }
+    auto fieldsParam = req->getOptionalParameter<std::string>("fields");
+    PersonFields fields;
+    if (fieldsParam) {
+        std::string err;
+        if (!fields.parse(*fieldsParam, err)) {
+            badRequest(std::move(callback), err);
+            return;
+        }
+    }
+    bool sparse = fieldsParam.has_value();
 
     auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr &)>>(std::move(callback));
-    auto dbClientPtr = drogon::app().getDbClient();
-    const char *sql = "select person.*, \n\
-                       job.title as job_title, \n\
-                       department.name as department_name, \n\
-                       concat(manager.first_name, ' ', manager.last_name) as manager_full_name \n\
-                       from person \n\
-                       join job on person.job_id =job.id \n\
-                       join department on person.department_id=department.id \n\
-                       join person as manager on person.manager_id = manager.id \n\
-                       order by $sort_field $sort_order \n\
-                       limit $1 offset $2;";
+    auto dbClientPtr = dbClient();
+    auto sql = (sparse ? fields.sqlForSelecting() : PersonInfo::sqlForSelecting()) +
+               " order by $sort_field $sort_order limit $1 offset $2";
 
     // hack workaroun
     auto sql_sub = std::regex_replace(sql, std::regex("\\$sort_field"), sort_field);
     sql_sub = std::regex_replace(sql_sub, std::regex("\\$sort_order"), sort_order);
 
+    TimedQuery timed(req, "person.list");
     *dbClientPtr << std::string(sql_sub)
                  << std::to_string(limit)
                  << std::to_string(offset)
-                 >> [callbackPtr](const Result &result)
+                 >> timed.onResult([callbackPtr, req, format, fields, sparse](const Result &result)
                    {
+                      TraceSpan span(req, "serialize");
                       if (result.empty()) {
                           auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("resource not found"));
                           resp->setStatusCode(HttpStatusCode::k404NotFound);
+                          span.end();
+                          (*callbackPtr)(resp);
+                          return;
+                      }
+
+                      if (sparse && format != ResponseFormat::Json) {
+                          BinaryEncoder encoder(format);
+                          encoder.beginArray(result.size());
+                          for (const auto &row : result) {
+                              fields.encode(encoder, row);
+                          }
+                          auto resp = newBinaryResponse(format, encoder.take());
+                          span.end();
+                          (*callbackPtr)(resp);
+                          return;
+                      }
+
+                      if (sparse) {
+                          Json::Value ret{Json::arrayValue};
+                          for (const auto &row : result) {
+                              ret.append(fields.toJson(row));
+                          }
+                          auto resp = HttpResponse::newHttpJsonResponse(ret);
+                          resp->setStatusCode(HttpStatusCode::k200OK);
+                          span.end();
+                          (*callbackPtr)(resp);
+                          return;
+                      }
+
+                      if (format != ResponseFormat::Json) {
+                          auto resp = newPersonDetailsResponse(format, result);
+                          span.end();
                           (*callbackPtr)(resp);
                           return;
                       }
@@ -66,178 +214,311 @@ void PersonsController::get(const HttpRequestPtr &req, std::function<void(const
 
                       auto resp = HttpResponse::newHttpJsonResponse(ret);
                       resp->setStatusCode(HttpStatusCode::k200OK);
+                      span.end();
                       (*callbackPtr)(resp);
-                   }
-                 >> [callbackPtr](const DrogonDbException &e)
+                   })
+                 >> timed.onError([callbackPtr](const DrogonDbException &e)
                    {
                       LOG_ERROR << e.base().what();
                       auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("database error"));
                       resp->setStatusCode(HttpStatusCode::k500InternalServerError);
                       (*callbackPtr)(resp);
-                   };
+                   });
 }
 
 void PersonsController::getOne(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, int personId) const {
     LOG_DEBUG << "getOne personId: "<< personId;
+    auto format = negotiateFormat(req);
+    callback = varyOnAccept(std::move(callback));
+    // only the JSON rendering is cached
+    auto *cachePtr = format == ResponseFormat::Json ? drogon::app().getPlugin<PersonCachePlugin>() : nullptr;
+    uint64_t generation = 0;
+    if (cachePtr) {
+        if (auto cached = cachePtr->get(personId)) {
+            auto resp = HttpResponse::newHttpResponse();
+            resp->setContentTypeCode(CT_APPLICATION_JSON);
+            resp->setBody(cached->body);
+            resp->addHeader("ETag", cached->etag);
+            callback(resp);
+            return;
+        }
+        generation = cachePtr->generation();
+    }
+
     auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr &)>>(std::move(callback));
-    auto dbClientPtr = drogon::app().getDbClient();
-
-    const char *sql = "select person.*, \n\
-                       job.title as job_title, \n\
-                       department.name as department_name, \n\
-                       concat(manager.first_name, ' ', manager.last_name) as manager_full_name \n\
-                       from person \n\
-                       join job on person.job_id =job.id \n\
-                       join department on person.department_id=department.id \n\
-                       join person as manager on person.manager_id = manager.id \n\
-                       where person.id = $1";
-
-    *dbClientPtr << std::string(sql)
+    auto dbClientPtr = dbClient();
+
+    auto sql = PersonInfo::sqlForSelecting() + " where id = $1";
+
+    TimedQuery timed(req, "person.get_one");
+    *dbClientPtr << sql
                  << personId
-                 >> [callbackPtr](const Result &result)
+                 >> timed.onResult([callbackPtr, req, cachePtr, generation, format](const Result &result)
                    {
+                      TraceSpan span(req, "serialize");
                       if (result.empty()) {
                           auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("resource not found"));
                           resp->setStatusCode(HttpStatusCode::k404NotFound);
+                          span.end();
                           (*callbackPtr)(resp);
                           return;
                       }
 
                       auto row = result[0];
                       PersonInfo personInfo{row};
+                      auto etag = versionETag(row["version"].as<int32_t>());
+                      if (format != ResponseFormat::Json) {
+                          BinaryEncoder encoder(format);
+                          encodePersonDetails(encoder, personInfo);
+                          auto resp = newBinaryResponse(format, encoder.take());
+                          resp->addHeader("ETag", etag);
+                          span.end();
+                          (*callbackPtr)(resp);
+                          return;
+                      }
                       PersonDetails personDetails{personInfo};
 
                       Json::Value ret = personDetails.toJson();
                       auto resp = HttpResponse::newHttpJsonResponse(ret);
                       resp->setStatusCode(HttpStatusCode::k200OK);
+                      resp->addHeader("ETag", etag);
+                      if (cachePtr) {
+                          cachePtr->put(personInfo.getValueOfId(), generation,
+                                        personInfo.getValueOfManagerId(),
+                                        personInfo.getValueOfDepartmentId(),
+                                        personInfo.getValueOfJobId(),
+                                        std::string(resp->getBody()), etag);
+                      }
+                      span.end();
                       (*callbackPtr)(resp);
-                   }
-                 >> [callbackPtr](const DrogonDbException &e)
+                   })
+                 >> timed.onError([callbackPtr](const DrogonDbException &e)
                    {
                       LOG_ERROR << e.base().what();
                       auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("database error"));
                       resp->setStatusCode(HttpStatusCode::k500InternalServerError);
                       (*callbackPtr)(resp);
-                   };
+                   });
+}
+
+void PersonsController::getCommonManager(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback) const {
+    LOG_DEBUG << "getCommonManager";
+    std::vector<int> ids;
+    auto idsParam = req->getOptionalParameter<std::string>("ids");
+    if (!idsParam || !parseIdList(*idsParam, ids) || ids.size() < 2) {
+        badRequest(std::move(callback), "ids must be a comma separated list of at least two integers");
+        return;
+    }
+    if (ids.size() > kMaxLookupIds) {
+        badRequest(std::move(callback), "at most " + std::to_string(kMaxLookupIds) + " ids per lookup");
+        return;
+    }
+
+    auto *treePtr = drogon::app().getPlugin<OrgTreePlugin>();
+    int managerId = 0;
+    auto lookup = treePtr ? treePtr->commonManager(ids, managerId) : OrgTreePlugin::Lookup::Loading;
+    if (lookup == OrgTreePlugin::Lookup::Loading) {
+        auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("organization is still loading"));
+        resp->setStatusCode(HttpStatusCode::k503ServiceUnavailable);
+        callback(resp);
+        return;
+    }
+    if (lookup != OrgTreePlugin::Lookup::Found) {
+        auto resp = HttpResponse::newHttpJsonResponse(makeErrResp(
+            lookup == OrgTreePlugin::Lookup::UnknownPerson ? "resource not found" : "no common manager"));
+        resp->setStatusCode(HttpStatusCode::k404NotFound);
+        callback(resp);
+        return;
+    }
+
+    Json::Value ret{};
+    for (auto id : ids) ret["ids"].append(id);
+    ret["manager_id"] = managerId;
+    auto resp = HttpResponse::newHttpJsonResponse(ret);
+    resp->setStatusCode(HttpStatusCode::k200OK);
+    callback(resp);
 }
 
 void PersonsController::createOne(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, Person &&pPerson) const {
     LOG_DEBUG << "createOne";
+    auto format = negotiateFormat(req);
+    callback = varyOnAccept(std::move(callback));
     auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr &)>>(std::move(callback));
-    auto dbClientPtr = drogon::app().getDbClient();
+    auto dbClientPtr = dbClient();
 
     Mapper<Person> mp(dbClientPtr);
+    TimedQuery timed(req, "person.insert");
     mp.insert(
         pPerson,
-        [callbackPtr](const Person &person) {
+        timed.wrap([callbackPtr, format](const Person &person) {
+            if (auto *treePtr = drogon::app().getPlugin<OrgTreePlugin>()) {
+                treePtr->personAdded(person.getValueOfId(), person.getValueOfManagerId());
+            }
+            if (format != ResponseFormat::Json) {
+                auto resp = newBinaryResponse(format, person);
+                resp->setStatusCode(HttpStatusCode::k201Created);
+                (*callbackPtr)(resp);
+                return;
+            }
             Json::Value ret{};
             ret = person.toJson();
             auto resp = HttpResponse::newHttpJsonResponse(ret);
             resp->setStatusCode(HttpStatusCode::k201Created);
             (*callbackPtr)(resp);
-        },
-        [callbackPtr](const DrogonDbException &e) {
+        }),
+        timed.wrap([callbackPtr](const DrogonDbException &e) {
             LOG_ERROR << e.base().what();
             auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("database error"));
             resp->setStatusCode(HttpStatusCode::k500InternalServerError);
             (*callbackPtr)(resp);
-    });
+    }));
+}
+
+void PersonsController::lookup(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback) const {
+    LOG_DEBUG << "lookup";
+    auto jsonPtr = req->getJsonObject();
+    if (!jsonPtr || !(*jsonPtr)["ids"].isArray() || (*jsonPtr)["ids"].empty()) {
+        badRequest(std::move(callback), "body must be {\"ids\": [...]} with at least one id");
+        return;
+    }
+    std::vector<int> ids;
+    for (const auto &id : (*jsonPtr)["ids"]) {
+        if (!id.isInt()) {
+            badRequest(std::move(callback), "ids must be integers");
+            return;
+        }
+        ids.push_back(id.asInt());
+    }
+    respondWithPersons(req, ids, negotiateFormat(req), varyOnAccept(std::move(callback)));
 }
 
 void PersonsController::updateOne(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, int personId, Person &&pPerson) const {
     LOG_DEBUG << "updateOne personId: " << personId;
-    auto dbClientPtr = drogon::app().getDbClient();
-
-    // blocking IO
-    Mapper<Person> mp(dbClientPtr);
-    Person person;
-    try {
-        person = mp.findFutureByPrimaryKey(personId).get();
-    } catch (const DrogonDbException & e) {
-        auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("resource not found"));
-        resp->setStatusCode(HttpStatusCode::k404NotFound);
-        callback(resp);
+    std::optional<int32_t> expectedVersion;
+    if (!parseIfMatch(req, expectedVersion)) {
+        badRequest(std::move(callback), "If-Match must be an ETag returned by this API");
         return;
     }
 
-    if (pPerson.getJobId() != nullptr) {
-      person.setJobId(pPerson.getValueOfJobId());
-    }
-    if (pPerson.getManagerId() != nullptr) {
-      person.setManagerId(pPerson.getValueOfManagerId());
-    }
-    if (pPerson.getDepartmentId() != nullptr) {
-      person.setDepartmentId(pPerson.getValueOfDepartmentId());
-    }
-    if (pPerson.getFirstName() != nullptr) {
-      person.setFirstName(pPerson.getValueOfFirstName());
-    }
-    if (pPerson.getLastName() != nullptr) {
-      person.setLastName(pPerson.getValueOfLastName());
+    // Checked in memory so reorgs don't pay for a recursive query per move. A loop that slips
+    // through concurrent moves, or a tree that is still loading, is rejected by the hierarchy
+    // triggers, which take one lock per write since migration 8.
+    auto *treePtr = drogon::app().getPlugin<OrgTreePlugin>();
+    if (treePtr && pPerson.getManagerId() && treePtr->wouldCreateCycle(personId, *pPerson.getManagerId())) {
+        auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("manager change would create a management cycle"));
+        resp->setStatusCode(HttpStatusCode::k409Conflict);
+        callback(resp);
+        return;
     }
 
     auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr &)>>(std::move(callback));
-    mp.update(
-        person,
-        [callbackPtr](const std::size_t count)
-        {
-            auto resp = HttpResponse::newHttpResponse();
-            resp->setStatusCode(HttpStatusCode::k204NoContent);
-            (*callbackPtr)(resp);
-        },
-        [callbackPtr](const DrogonDbException &e)
-        {
-            LOG_ERROR << e.base().what();
-            auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("database error"));
-            resp->setStatusCode(HttpStatusCode::k500InternalServerError);
-            (*callbackPtr)(resp);
-        }
-    );
+    auto dbClientPtr = dbClient();
+    // unset fields keep their stored value; a stale If-Match matches no row
+    const std::string sql = "update person set job_id = coalesce($2, job_id), \n\
+                                  manager_id = coalesce($3, manager_id), \n\
+                                  department_id = coalesce($4, department_id), \n\
+                                  first_name = coalesce($5, first_name), \n\
+                                  last_name = coalesce($6, last_name), \n\
+                                  version = version + 1 \n\
+                where id = $1 and ($7::int is null or version = $7) \n\
+                returning *";
+
+    TimedQuery timed(req, "person.update");
+    *dbClientPtr << sql
+                 << personId
+                 << optionalOf(pPerson.getJobId())
+                 << optionalOf(pPerson.getManagerId())
+                 << optionalOf(pPerson.getDepartmentId())
+                 << optionalOf(pPerson.getFirstName())
+                 << optionalOf(pPerson.getLastName())
+                 << expectedVersion
+                 >> timed.onResult([callbackPtr, dbClientPtr, personId, expectedVersion](const Result &result)
+                   {
+                      if (!result.empty()) {
+                          // other instances hear about it from ChangeListenerPlugin
+                          if (auto *cachePtr = drogon::app().getPlugin<PersonCachePlugin>()) {
+                              cachePtr->invalidate("person", personId);
+                          }
+                          if (auto *treePtr = drogon::app().getPlugin<OrgTreePlugin>()) {
+                              treePtr->managerChanged(personId, result[0]["manager_id"].as<int32_t>());
+                          }
+                      }
+                      respondToVersionedUpdate(result, dbClientPtr, "person", personId,
+                                               expectedVersion.has_value(), callbackPtr);
+                   })
+                 >> timed.onError([callbackPtr](const DrogonDbException &e)
+                   {
+                      auto *sqlError = dynamic_cast<const SqlError *>(&e.base());
+                      if (sqlError && sqlError->sqlState() == "23514") {
+                          auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("manager change would create a management cycle"));
+                          resp->setStatusCode(HttpStatusCode::k409Conflict);
+                          (*callbackPtr)(resp);
+                          return;
+                      }
+                      LOG_ERROR << e.base().what();
+                      auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("database error"));
+                      resp->setStatusCode(HttpStatusCode::k500InternalServerError);
+                      (*callbackPtr)(resp);
+                   });
 }
 
 void PersonsController::deleteOne(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, int personId) const {
     LOG_DEBUG << "deleteOne personId: ";
     auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr &)>>(std::move(callback));
-    auto dbClientPtr = drogon::app().getDbClient();
+    auto dbClientPtr = dbClient();
 
     Mapper<Person> mp(dbClientPtr);
+    TimedQuery timed(req, "person.delete");
     mp.deleteBy(
         Criteria(Person::Cols::_id, CompareOperator::EQ, personId),
-        [callbackPtr](const std::size_t count) {
+        timed.wrap([callbackPtr, personId](const std::size_t count) {
+            if (auto *cachePtr = drogon::app().getPlugin<PersonCachePlugin>()) {
+                cachePtr->invalidate("person", personId);
+            }
+            if (auto *treePtr = drogon::app().getPlugin<OrgTreePlugin>(); treePtr && count > 0) {
+                treePtr->personRemoved(personId);
+            }
             auto resp = HttpResponse::newHttpResponse();
             resp->setStatusCode(HttpStatusCode::k204NoContent);
             (*callbackPtr)(resp);
-        },
-        [callbackPtr](const DrogonDbException &e) {
+        }),
+        timed.wrap([callbackPtr](const DrogonDbException &e) {
             LOG_ERROR << e.base().what();
             auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("database error"));
             resp->setStatusCode(HttpStatusCode::k500InternalServerError);
             (*callbackPtr)(resp);
-    });
+    }));
 }
 
 void PersonsController::getDirectReports(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, int personId) const {
     LOG_DEBUG << "getDirectReports personId: "<< personId;
+    auto format = negotiateFormat(req);
+    callback = varyOnAccept(std::move(callback));
     auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr &)>>(std::move(callback));
-    auto dbClientPtr = drogon::app().getDbClient();
+    auto dbClientPtr = dbClient();
 
     // blocking IO
     Mapper<Person> mp(dbClientPtr);
     Person department;
     try {
-        department = mp.findFutureByPrimaryKey(personId).get();
+        TimedQuery timed(req, "person.get_by_id");
+        department = timed.get(mp.findFutureByPrimaryKey(personId));
     } catch (const DrogonDbException & e) {
         auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("resource not found"));
         resp->setStatusCode(HttpStatusCode::k404NotFound);
-        callback(resp);
+        (*callbackPtr)(resp);
+        return;
     }
 
+    TimedQuery timed(req, "person.get_reports");
     department.getPersons(dbClientPtr,
-      [callbackPtr](const std::vector<Person> persons) {
+      timed.wrap([callbackPtr, format](const std::vector<Person> persons) {
           if (persons.empty()) {
              auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("resource not found"));
              resp->setStatusCode(HttpStatusCode::k404NotFound);
              (*callbackPtr)(resp);
+          } else if (format != ResponseFormat::Json) {
+             (*callbackPtr)(newBinaryResponse(format, persons));
           } else {
              Json::Value ret{};
              for (auto p : persons) {
@@ -247,13 +528,142 @@ void PersonsController::getDirectReports(const HttpRequestPtr &req, std::functio
              resp->setStatusCode(HttpStatusCode::k200OK);
              (*callbackPtr)(resp);
           }
-      },
-      [callbackPtr](const DrogonDbException &e) {
+      }),
+      timed.wrap([callbackPtr](const DrogonDbException &e) {
           LOG_ERROR << e.base().what();
           auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("database error"));
           resp->setStatusCode(HttpStatusCode::k500InternalServerError);
           (*callbackPtr)(resp);
-      });
+      }));
+}
+
+void PersonsController::getChain(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, int personId) const {
+    LOG_DEBUG << "getChain personId: " << personId;
+    auto format = negotiateFormat(req);
+    callback = varyOnAccept(std::move(callback));
+    auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr &)>>(std::move(callback));
+    auto dbClientPtr = dbClient();
+
+    // person_path holds the managers nearest first (see migration person_path).
+    static const std::string sql =
+        "select person_details.* from person_path "
+        "cross join unnest(array[person_path.id] || person_path.ancestors) with ordinality as chain (id, position) "
+        "join person_details on person_details.id = chain.id "
+        "where person_path.id = $1 order by chain.position";
+    TimedQuery timed(req, "person.get_chain");
+    *dbClientPtr << sql
+                 << personId
+                 >> timed.onResult([callbackPtr, req, format](const Result &result)
+                   {
+                      TraceSpan span(req, "serialize");
+                      if (result.empty()) {
+                          auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("resource not found"));
+                          resp->setStatusCode(HttpStatusCode::k404NotFound);
+                          span.end();
+                          (*callbackPtr)(resp);
+                          return;
+                      }
+
+                      if (format != ResponseFormat::Json) {
+                          auto resp = newPersonDetailsResponse(format, result);
+                          span.end();
+                          (*callbackPtr)(resp);
+                          return;
+                      }
+
+                      Json::Value ret{Json::arrayValue};
+                      for (const auto &row : result) {
+                          PersonInfo personInfo{row};
+                          PersonDetails personDetails{personInfo};
+                          ret.append(personDetails.toJson());
+                      }
+                      auto resp = HttpResponse::newHttpJsonResponse(ret);
+                      resp->setStatusCode(HttpStatusCode::k200OK);
+                      span.end();
+                      (*callbackPtr)(resp);
+                   })
+                 >> timed.onError([callbackPtr](const DrogonDbException &e)
+                   {
+                      LOG_ERROR << e.base().what();
+                      auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("database error"));
+                      resp->setStatusCode(HttpStatusCode::k500InternalServerError);
+                      (*callbackPtr)(resp);
+                   });
+}
+
+void PersonsController::isUnder(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, int personId, int managerId) const {
+    LOG_DEBUG << "isUnder personId: " << personId << " managerId: " << managerId;
+    auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr &)>>(std::move(callback));
+    auto dbClientPtr = dbClient();
+
+    // Both lookups are primary key probes of person_closure; the depth 0 rows tell whether the
+    // two persons exist.
+    static const std::string sql =
+        "select (select depth from person_closure where ancestor = $2 and descendant = $1 and depth > 0) as depth, "
+        "(select count(*) from person_closure where descendant in ($1, $2) and ancestor = descendant) as found";
+    TimedQuery timed(req, "person.is_under");
+    *dbClientPtr << sql
+                 << personId
+                 << managerId
+                 >> timed.onResult([callbackPtr, personId, managerId](const Result &result)
+                   {
+                      auto row = result[0];
+                      if (row["found"].as<int64_t>() < (personId == managerId ? 1 : 2)) {
+                          auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("resource not found"));
+                          resp->setStatusCode(HttpStatusCode::k404NotFound);
+                          (*callbackPtr)(resp);
+                          return;
+                      }
+
+                      Json::Value ret{};
+                      ret["id"] = personId;
+                      ret["manager_id"] = managerId;
+                      ret["is_under"] = !row["depth"].isNull();
+                      if (!row["depth"].isNull()) ret["levels"] = row["depth"].as<int32_t>();
+                      auto resp = HttpResponse::newHttpJsonResponse(ret);
+                      resp->setStatusCode(HttpStatusCode::k200OK);
+                      (*callbackPtr)(resp);
+                   })
+                 >> timed.onError([callbackPtr](const DrogonDbException &e)
+                   {
+                      LOG_ERROR << e.base().what();
+                      auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("database error"));
+                      resp->setStatusCode(HttpStatusCode::k500InternalServerError);
+                      (*callbackPtr)(resp);
+                   });
+}
+
+void PersonsController::getOrgSize(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, int personId) const {
+    LOG_DEBUG << "getOrgSize personId: " << personId;
+    auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr &)>>(std::move(callback));
+    auto dbClientPtr = dbClient();
+
+    TimedQuery timed(req, "person.get_org_size");
+    *dbClientPtr << "select size from person_org_size where id = $1"
+                 << personId
+                 >> timed.onResult([callbackPtr, personId](const Result &result)
+                   {
+                      if (result.empty()) {
+                          auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("resource not found"));
+                          resp->setStatusCode(HttpStatusCode::k404NotFound);
+                          (*callbackPtr)(resp);
+                          return;
+                      }
+
+                      Json::Value ret{};
+                      ret["id"] = personId;
+                      ret["org_size"] = result[0]["size"].as<int32_t>();
+                      auto resp = HttpResponse::newHttpJsonResponse(ret);
+                      resp->setStatusCode(HttpStatusCode::k200OK);
+                      (*callbackPtr)(resp);
+                   })
+                 >> timed.onError([callbackPtr](const DrogonDbException &e)
+                   {
+                      LOG_ERROR << e.base().what();
+                      auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("database error"));
+                      resp->setStatusCode(HttpStatusCode::k500InternalServerError);
+                      (*callbackPtr)(resp);
+                   });
 }
 
 PersonsController::PersonDetails::PersonDetails(const PersonInfo &personInfo) {
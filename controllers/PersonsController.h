@@ -12,21 +12,37 @@ class PersonsController : public drogon::HttpController<PersonsController> {
  public:
     METHOD_LIST_BEGIN
       ADD_METHOD_TO(PersonsController::get, "/persons", Get);
+      // before /persons/{1}, which would take common_manager for an id
+      ADD_METHOD_TO(PersonsController::getCommonManager, "/persons/common_manager", Get);
       ADD_METHOD_TO(PersonsController::getOne, "/persons/{1}", Get);
       ADD_METHOD_TO(PersonsController::createOne, "/persons", Post);
+      ADD_METHOD_TO(PersonsController::lookup, "/persons/lookup", Post);
       ADD_METHOD_TO(PersonsController::updateOne, "/persons/{1}", Put);
       ADD_METHOD_TO(PersonsController::deleteOne, "/persons/{1}", Delete);
       ADD_METHOD_TO(PersonsController::getDirectReports, "/persons/{1}/reports", Get);
+      ADD_METHOD_TO(PersonsController::getChain, "/persons/{1}/chain", Get);
+      ADD_METHOD_TO(PersonsController::isUnder, "/persons/{1}/is_under/{2}", Get);
+      ADD_METHOD_TO(PersonsController::getOrgSize, "/persons/{1}/org_size", Get);
     METHOD_LIST_END
 
     void get(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr &)> &&callback) const;
     void getOne(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr &)> &&callback, int pPersonId) const;
+    // Lowest common manager of ?ids=..., answered from OrgTreePlugin without a query.
+    void getCommonManager(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback) const;
     void createOne(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, Person &&pPerson) const;
+    void lookup(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback) const;
     void updateOne(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, int pPersonId, Person &&pPerson) const;
     void deleteOne(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, int pPersonId) const;
     void getDirectReports(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, int pPersonId) const;
+    // The person followed by each of their managers up to the top of the organization.
+    void getChain(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, int pPersonId) const;
+    // Whether pPersonId is somewhere in pManagerId's organization, and how many levels below.
+    void isUnder(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, int pPersonId, int pManagerId) const;
+    // Number of persons directly or indirectly reporting to pPersonId.
+    void getOrgSize(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, int pPersonId) const;
 
- private:
+    // Response shape for a person with job, department and manager resolved; also used by
+    // the department and job member listings.
     struct PersonDetails {
         int id;
         std::string first_name;
@@ -0,0 +1,263 @@
+#include "ImportRows.h"
+#include "../utils/RequestParser.h"
+#include "../utils/utils.h"
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+    struct Chunk {
+        std::string_view text;
+        std::size_t firstLine;
+    };
+
+    bool endsWith(const std::string &value, const std::string &suffix) {
+        return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    // Reads RFC 4180 style records: comma separated, fields optionally quoted with "" as an
+    // escaped quote, quoted fields may span lines. Blank lines are skipped.
+    class CsvCursor {
+     public:
+        CsvCursor(std::string_view text, std::size_t line) : text{text}, line{line} {}
+
+        bool next(std::vector<std::string> &fields, std::size_t &recordLine, std::string &error) {
+            while (pos < text.size() && (text[pos] == '\n' || text[pos] == '\r')) {
+                if (text[pos++] == '\n') ++line;
+            }
+            if (pos >= text.size()) return false;
+
+            fields.clear();
+            error.clear();
+            recordLine = line;
+            std::string field;
+            bool quoted = false;
+            bool wasQuoted = false;
+            while (pos < text.size()) {
+                auto c = text[pos++];
+                if (quoted) {
+                    if (c == '"') {
+                        if (pos < text.size() && text[pos] == '"') {
+                            field += '"';
+                            ++pos;
+                        } else {
+                            quoted = false;
+                        }
+                    } else {
+                        if (c == '\n') ++line;
+                        field += c;
+                    }
+                } else if (c == '"' && field.empty() && !wasQuoted) {
+                    quoted = wasQuoted = true;
+                } else if (c == ',') {
+                    fields.push_back(std::move(field));
+                    field.clear();
+                    wasQuoted = false;
+                } else if (c == '\n') {
+                    ++line;
+                    break;
+                } else if (c != '\r') {
+                    field += c;
+                }
+            }
+            if (quoted) error = "unterminated quoted field";
+            fields.push_back(std::move(field));
+            return true;
+        }
+
+        auto offset() const -> std::size_t { return pos; }
+        auto currentLine() const -> std::size_t { return line; }
+
+     private:
+        std::string_view text;
+        std::size_t pos = 0;
+        std::size_t line;
+    };
+
+    // Cuts input into pieces of roughly target bytes, each ending on a newline that is not inside
+    // a quoted CSV field so every chunk starts at a record boundary. Quotes follow CsvCursor's
+    // rules: only one at the start of a field opens a quoted field, and a quote elsewhere is text.
+    std::vector<Chunk> splitChunks(std::string_view input, bool csvQuotes, std::size_t firstLine, std::size_t target) {
+        std::vector<Chunk> chunks;
+        std::size_t start = 0;
+        std::size_t startLine = firstLine;
+        std::size_t line = firstLine;
+        bool quoted = false;
+        bool fieldStart = true;
+        for (std::size_t i = 0; i < input.size(); ++i) {
+            auto c = input[i];
+            if (quoted) {
+                if (c == '"') {
+                    if (i + 1 < input.size() && input[i + 1] == '"') {
+                        ++i;
+                    } else {
+                        quoted = false;
+                    }
+                } else if (c == '\n') {
+                    ++line;
+                }
+            } else if (csvQuotes && c == '"' && fieldStart) {
+                quoted = true;
+                fieldStart = false;
+            } else if (c == ',') {
+                fieldStart = true;
+            } else if (c == '\n') {
+                ++line;
+                fieldStart = true;
+                if (i + 1 - start >= target) {
+                    chunks.push_back({input.substr(start, i + 1 - start), startLine});
+                    start = i + 1;
+                    startLine = line;
+                }
+            } else if (c != '\r') {
+                fieldStart = false;
+            }
+        }
+        if (start < input.size()) chunks.push_back({input.substr(start), startLine});
+        return chunks;
+    }
+
+    void parseCsvChunk(const Chunk &chunk, const std::vector<std::ptrdiff_t> &columnOf, std::size_t columnCount,
+                       ParsedRows &out) {
+        CsvCursor cursor(chunk.text, chunk.firstLine);
+        std::vector<std::string> fields;
+        std::size_t line;
+        std::string error;
+        while (cursor.next(fields, line, error)) {
+            if (!error.empty()) {
+                out.errors.push_back({line, error});
+                continue;
+            }
+            ImportRow row{line, std::vector<std::string>(columnCount)};
+            for (std::size_t i = 0; i < fields.size() && i < columnOf.size(); ++i) {
+                if (columnOf[i] >= 0) row.values[columnOf[i]] = std::move(fields[i]);
+            }
+            out.rows.push_back(std::move(row));
+        }
+    }
+
+    void parseNdjsonChunk(const Chunk &chunk, const std::vector<std::string> &columns, ParsedRows &out) {
+        auto line = chunk.firstLine;
+        std::size_t pos = 0;
+        const auto &text = chunk.text;
+        while (pos < text.size()) {
+            auto end = text.find('\n', pos);
+            if (end == std::string_view::npos) end = text.size();
+            auto record = text.substr(pos, end - pos);
+            pos = end + 1;
+            auto recordLine = line++;
+            if (record.find_first_not_of(" \t\r") == std::string_view::npos) continue;
+
+            ImportRow row{recordLine, std::vector<std::string>(columns.size())};
+            try {
+                JsonObjectReader reader(record);
+                std::string_view key;
+                JsonScalar value;
+                while (reader.next(key, value)) {
+                    auto column = std::find(columns.begin(), columns.end(), key);
+                    if (column == columns.end() || value.type == JsonScalar::Type::Null) continue;
+                    auto &target = row.values[column - columns.begin()];
+                    if (value.type == JsonScalar::Type::Number) {
+                        target = std::string(value.raw);
+                    } else {
+                        target = jsonStringValue(key, value);
+                    }
+                }
+            } catch (const BadRequestError &e) {
+                out.errors.push_back({recordLine, e.what()});
+                continue;
+            }
+            out.rows.push_back(std::move(row));
+        }
+    }
+
+    auto trim(const std::string &value) -> std::string {
+        auto begin = value.find_first_not_of(" \t");
+        if (begin == std::string::npos) return "";
+        return value.substr(begin, value.find_last_not_of(" \t") - begin + 1);
+    }
+}  // namespace
+
+auto inputFormatOf(const std::string &path) -> InputFormat {
+    if (endsWith(path, ".csv")) return InputFormat::Csv;
+    if (endsWith(path, ".ndjson") || endsWith(path, ".jsonl")) return InputFormat::Ndjson;
+    throw std::runtime_error(path + ": expected a .csv, .ndjson or .jsonl file");
+}
+
+auto parseRows(std::string_view input, InputFormat format, const std::vector<std::string> &columns,
+               unsigned threads) -> ParsedRows {
+    if (input.compare(0, 3, "\xef\xbb\xbf") == 0) input.remove_prefix(3);
+
+    std::size_t firstLine = 1;
+    std::vector<std::ptrdiff_t> columnOf;
+    if (format == InputFormat::Csv) {
+        CsvCursor header(input, firstLine);
+        std::vector<std::string> names;
+        std::size_t line;
+        std::string error;
+        if (!header.next(names, line, error)) return {};
+        if (!error.empty()) throw std::runtime_error("header: " + error);
+        for (const auto &name : names) {
+            auto column = std::find(columns.begin(), columns.end(), trim(name));
+            columnOf.push_back(column == columns.end() ? -1 : column - columns.begin());
+        }
+        input.remove_prefix(header.offset());
+        firstLine = header.currentLine();
+    }
+
+    threads = std::max(threads, 1u);
+    // A few chunks per worker so one slow chunk does not leave the others idle.
+    auto target = std::max<std::size_t>(input.size() / (threads * 4), 64 * 1024);
+    auto chunks = splitChunks(input, format == InputFormat::Csv, firstLine, target);
+    std::vector<ParsedRows> results(chunks.size());
+    std::atomic<std::size_t> nextChunk{0};
+    auto work = [&]() {
+        for (auto i = nextChunk++; i < chunks.size(); i = nextChunk++) {
+            if (format == InputFormat::Csv) {
+                parseCsvChunk(chunks[i], columnOf, columns.size(), results[i]);
+            } else {
+                parseNdjsonChunk(chunks[i], columns, results[i]);
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < std::min<std::size_t>(threads, chunks.size()); ++i) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto &worker : workers) worker.join();
+
+    ParsedRows parsed;
+    for (auto &result : results) {
+        std::move(result.rows.begin(), result.rows.end(), std::back_inserter(parsed.rows));
+        std::move(result.errors.begin(), result.errors.end(), std::back_inserter(parsed.errors));
+    }
+    return parsed;
+}
+
+auto orderManagersFirst(const std::vector<std::ptrdiff_t> &managerOf, std::vector<std::size_t> &unreachable)
+    -> std::vector<std::size_t> {
+    std::vector<std::vector<std::size_t>> reports(managerOf.size());
+    std::vector<std::size_t> order;
+    order.reserve(managerOf.size());
+    for (std::size_t i = 0; i < managerOf.size(); ++i) {
+        if (managerOf[i] == kRootRow) {
+            order.push_back(i);
+        } else if (managerOf[i] >= 0) {
+            reports[managerOf[i]].push_back(i);
+        }
+    }
+    // Breadth first from the roots; order doubles as the queue.
+    for (std::size_t next = 0; next < order.size(); ++next) {
+        for (auto report : reports[order[next]]) order.push_back(report);
+    }
+
+    std::vector<bool> placed(managerOf.size());
+    for (auto i : order) placed[i] = true;
+    unreachable.clear();
+    for (std::size_t i = 0; i < managerOf.size(); ++i) {
+        if (!placed[i] && managerOf[i] != kRejectedRow) unreachable.push_back(i);
+    }
+    return order;
+}
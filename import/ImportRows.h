@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class InputFormat { Csv, Ndjson };
+
+// Picks the format from the file extension (.csv, .ndjson or .jsonl); throws std::runtime_error otherwise.
+auto inputFormatOf(const std::string &path) -> InputFormat;
+
+struct ImportRow {
+    // 1-based line the record starts on.
+    std::size_t line;
+    // One entry per requested column; empty when the record does not set it.
+    std::vector<std::string> values;
+};
+
+struct RowError {
+    std::size_t line;
+    std::string message;
+};
+
+struct ParsedRows {
+    std::vector<ImportRow> rows;
+    std::vector<RowError> errors;
+};
+
+// Parses a whole CSV (with a header record) or NDJSON input into rows holding the given columns,
+// in input order. The input is cut into chunks on record boundaries which are parsed on up to
+// `threads` workers. Malformed records are reported in errors and left out of rows.
+auto parseRows(std::string_view input, InputFormat format, const std::vector<std::string> &columns,
+               unsigned threads) -> ParsedRows;
+
+// managerOf values for orderManagersFirst besides the index of the manager's own row.
+constexpr std::ptrdiff_t kRootRow = -1;      // manager is not part of the input
+constexpr std::ptrdiff_t kRejectedRow = -2;  // row was rejected and must not be inserted
+
+// Returns row indexes ordered so that every manager comes before their reports. Rows whose
+// manager chain is cyclic or leads to a rejected row are left out and listed in unreachable.
+auto orderManagersFirst(const std::vector<std::ptrdiff_t> &managerOf, std::vector<std::size_t> &unreachable)
+    -> std::vector<std::size_t>;
@@ -0,0 +1,363 @@
+#include "Importer.h"
+#include "../utils/DbConfig.h"
+#include <libpq-fe.h>
+#include <trantor/utils/Logger.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+    const std::size_t kCopyBatchRows = 10000;
+    const std::size_t kMaxNameLength = 50;
+    const std::size_t kErrorsLogged = 20;
+
+    using Result = std::unique_ptr<PGresult, void (*)(PGresult *)>;
+
+    auto readFile(const std::string &path) -> std::string {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) throw std::runtime_error("cannot open " + path);
+        std::ostringstream contents;
+        contents << in.rdbuf();
+        return contents.str();
+    }
+
+    // PostgreSQL counts varchar lengths in characters.
+    auto utf8Length(const std::string &value) -> std::size_t {
+        std::size_t length = 0;
+        for (auto c : value) {
+            if ((static_cast<unsigned char>(c) & 0xc0) != 0x80) ++length;
+        }
+        return length;
+    }
+
+    bool isDate(const std::string &value) {
+        struct tm stm;
+        memset(&stm, 0, sizeof(stm));
+        auto end = strptime(value.c_str(), "%Y-%m-%d", &stm);
+        return end != nullptr && *end == '\0';
+    }
+
+    // COPY text format: tab separated, newline terminated, backslash escapes.
+    void appendCopyField(std::string &out, const std::string &value) {
+        for (auto c : value) {
+            switch (c) {
+                case '\\': out += "\\\\"; break;
+                case '\t': out += "\\t"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                default: out += c;
+            }
+        }
+    }
+
+    auto personKey(const std::string &firstName, const std::string &lastName) -> std::string {
+        return firstName + '\x1f' + lastName;
+    }
+
+    // Maps the first column(s) of a query to the int in its last column. Multi-column keys are
+    // joined the way personKey joins them.
+    auto loadIds(PGconn *conn, const char *sql) -> std::unordered_map<std::string, int> {
+        Result result(PQexec(conn, sql), PQclear);
+        if (PQresultStatus(result.get()) != PGRES_TUPLES_OK) {
+            throw std::runtime_error(PQerrorMessage(conn));
+        }
+        std::unordered_map<std::string, int> ids;
+        auto keyColumns = PQnfields(result.get()) - 1;
+        for (int row = 0; row < PQntuples(result.get()); ++row) {
+            std::string key = PQgetvalue(result.get(), row, 0);
+            for (int column = 1; column < keyColumns; ++column) {
+                key = personKey(key, PQgetvalue(result.get(), row, column));
+            }
+            ids.emplace(std::move(key), std::atoi(PQgetvalue(result.get(), row, keyColumns)));
+        }
+        return ids;
+    }
+
+    auto elapsedMs(std::chrono::steady_clock::time_point start) -> long long {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    auto parseFile(const std::string &path, const std::vector<std::string> &columns, unsigned threads) -> ParsedRows {
+        auto start = std::chrono::steady_clock::now();
+        auto input = readFile(path);
+        auto parsed = parseRows(input, inputFormatOf(path), columns, threads);
+        LOG_INFO << path << ": parsed " << parsed.rows.size() << " rows in " << elapsedMs(start) << " ms, "
+                 << parsed.errors.size() << " malformed";
+        return parsed;
+    }
+}  // namespace
+
+Importer::Importer(const std::string &connInfo, unsigned threads)
+    : conn{PQconnectdb(connInfo.c_str()), PQfinish}, threads{threads} {
+    if (PQstatus(conn.get()) != CONNECTION_OK) {
+        throw std::runtime_error(std::string("cannot connect to database: ") + PQerrorMessage(conn.get()));
+    }
+}
+
+Importer::~Importer() = default;
+
+void Importer::exec(const std::string &sql) {
+    Result result(PQexec(conn.get(), sql.c_str()), PQclear);
+    if (PQresultStatus(result.get()) != PGRES_COMMAND_OK) {
+        throw std::runtime_error(sql + ": " + PQerrorMessage(conn.get()));
+    }
+}
+
+void Importer::copyIn(const std::string &copySql, std::size_t rowCount,
+                      const std::function<void(std::size_t row, std::string &out)> &renderRow) {
+    Result started(PQexec(conn.get(), copySql.c_str()), PQclear);
+    if (PQresultStatus(started.get()) != PGRES_COPY_IN) {
+        throw std::runtime_error(copySql + ": " + PQerrorMessage(conn.get()));
+    }
+
+    std::string buffer;
+    for (std::size_t row = 0; row < rowCount;) {
+        buffer.clear();
+        auto end = std::min(row + kCopyBatchRows, rowCount);
+        for (; row < end; ++row) renderRow(row, buffer);
+        if (PQputCopyData(conn.get(), buffer.data(), static_cast<int>(buffer.size())) != 1) {
+            throw std::runtime_error(std::string("copy failed: ") + PQerrorMessage(conn.get()));
+        }
+        LOG_INFO << "copied " << row << "/" << rowCount << " rows";
+    }
+    if (PQputCopyEnd(conn.get(), nullptr) != 1) {
+        throw std::runtime_error(std::string("copy failed: ") + PQerrorMessage(conn.get()));
+    }
+    Result finished(PQgetResult(conn.get()), PQclear);
+    auto ok = PQresultStatus(finished.get()) == PGRES_COMMAND_OK;
+    while (auto *rest = PQgetResult(conn.get())) PQclear(rest);
+    if (!ok) throw std::runtime_error(std::string("copy failed: ") + PQerrorMessage(conn.get()));
+}
+
+auto Importer::importNames(const std::string &path, const std::string &table, const std::string &column)
+    -> ImportSummary {
+    auto parsed = parseFile(path, {column}, threads);
+    ImportSummary summary;
+    summary.errors = std::move(parsed.errors);
+
+    auto existing = loadIds(conn.get(), ("select " + column + ", id from " + table).c_str());
+    std::vector<const std::string *> names;
+    for (const auto &row : parsed.rows) {
+        const auto &name = row.values[0];
+        if (name.empty()) {
+            summary.errors.push_back({row.line, column + " is required"});
+        } else if (utf8Length(name) > kMaxNameLength) {
+            summary.errors.push_back({row.line, column + " is longer than 50 characters"});
+        } else if (!existing.emplace(name, 0).second) {
+            ++summary.skipped;
+        } else {
+            names.push_back(&name);
+        }
+    }
+
+    exec("begin");
+    try {
+        copyIn("copy " + table + " (" + column + ") from stdin", names.size(), [&](std::size_t i, std::string &out) {
+            appendCopyField(out, *names[i]);
+            out += '\n';
+        });
+        exec("commit");
+    } catch (...) {
+        exec("rollback");
+        throw;
+    }
+    summary.inserted = names.size();
+    return summary;
+}
+
+auto Importer::importDepartments(const std::string &path) -> ImportSummary {
+    return importNames(path, "department", "name");
+}
+
+auto Importer::importJobs(const std::string &path) -> ImportSummary {
+    return importNames(path, "job", "title");
+}
+
+auto Importer::importPersons(const std::string &path) -> ImportSummary {
+    enum { kFirstName, kLastName, kHireDate, kDepartment, kJob, kManagerFirstName, kManagerLastName };
+    auto parsed = parseFile(path, {"first_name", "last_name", "hire_date", "department", "job",
+                                   "manager_first_name", "manager_last_name"}, threads);
+    ImportSummary summary;
+    summary.errors = std::move(parsed.errors);
+
+    auto departments = loadIds(conn.get(), "select name, id from department");
+    auto jobs = loadIds(conn.get(), "select title, id from job");
+    auto existing = loadIds(conn.get(), "select first_name, last_name, id from person");
+
+    struct Pending {
+        const ImportRow *row;
+        int departmentId;
+        int jobId;
+        // Id of a manager already in the database, 0 when the manager is in this file or absent.
+        int existingManagerId = 0;
+    };
+    std::vector<Pending> pending;
+    std::unordered_map<std::string, std::size_t> pendingByName;
+    for (const auto &row : parsed.rows) {
+        const auto &values = row.values;
+        auto reject = [&](const std::string &message) { summary.errors.push_back({row.line, message}); };
+        if (values[kFirstName].empty() || values[kLastName].empty() || values[kHireDate].empty()) {
+            reject("first_name, last_name and hire_date are required");
+            continue;
+        }
+        if (utf8Length(values[kFirstName]) > kMaxNameLength || utf8Length(values[kLastName]) > kMaxNameLength) {
+            reject("names are limited to 50 characters");
+            continue;
+        }
+        if (!isDate(values[kHireDate])) {
+            reject("hire_date must be a date formatted as YYYY-MM-DD");
+            continue;
+        }
+        auto department = departments.find(values[kDepartment]);
+        if (department == departments.end()) {
+            reject("unknown department '" + values[kDepartment] + "'");
+            continue;
+        }
+        auto job = jobs.find(values[kJob]);
+        if (job == jobs.end()) {
+            reject("unknown job '" + values[kJob] + "'");
+            continue;
+        }
+        auto key = personKey(values[kFirstName], values[kLastName]);
+        if (existing.count(key) != 0) {
+            ++summary.skipped;
+            continue;
+        }
+        if (!pendingByName.emplace(key, pending.size()).second) {
+            reject("duplicate person " + values[kFirstName] + " " + values[kLastName]);
+            continue;
+        }
+        pending.push_back({&row, department->second, job->second});
+    }
+
+    std::vector<std::ptrdiff_t> managerOf(pending.size(), kRootRow);
+    for (std::size_t i = 0; i < pending.size(); ++i) {
+        const auto &values = pending[i].row->values;
+        if (values[kManagerFirstName].empty() && values[kManagerLastName].empty()) continue;
+        auto key = personKey(values[kManagerFirstName], values[kManagerLastName]);
+        if (auto inFile = pendingByName.find(key); inFile != pendingByName.end()) {
+            if (inFile->second != i) managerOf[i] = static_cast<std::ptrdiff_t>(inFile->second);
+        } else if (auto inDb = existing.find(key); inDb != existing.end()) {
+            pending[i].existingManagerId = inDb->second;
+        } else {
+            summary.errors.push_back({pending[i].row->line, "unknown manager " + values[kManagerFirstName] + " " +
+                                                                values[kManagerLastName]});
+            managerOf[i] = kRejectedRow;
+        }
+    }
+    std::vector<std::size_t> unreachable;
+    auto order = orderManagersFirst(managerOf, unreachable);
+    for (auto i : unreachable) {
+        summary.errors.push_back({pending[i].row->line, "manager chain is cyclic or includes a rejected row"});
+    }
+
+    std::vector<int> ids(pending.size());
+    if (!order.empty()) {
+        auto count = std::to_string(order.size());
+        const char *params[] = {count.c_str()};
+        Result result(PQexecParams(conn.get(),
+                                   "select nextval(pg_get_serial_sequence('person', 'id')) from generate_series(1, $1::int)",
+                                   1, nullptr, params, nullptr, nullptr, 0),
+                      PQclear);
+        if (PQresultStatus(result.get()) != PGRES_TUPLES_OK) {
+            throw std::runtime_error(std::string("cannot reserve person ids: ") + PQerrorMessage(conn.get()));
+        }
+        for (std::size_t k = 0; k < order.size(); ++k) {
+            ids[order[k]] = std::atoi(PQgetvalue(result.get(), static_cast<int>(k), 0));
+        }
+    }
+
+    exec("begin");
+    try {
+        copyIn("copy person (id, job_id, department_id, manager_id, first_name, last_name, hire_date) from stdin",
+               order.size(), [&](std::size_t k, std::string &out) {
+                   auto i = order[k];
+                   const auto &person = pending[i];
+                   auto managerId = managerOf[i] >= 0 ? ids[managerOf[i]]
+                                    : person.existingManagerId != 0 ? person.existingManagerId
+                                                                    : ids[i];
+                   out += std::to_string(ids[i]) + '\t' + std::to_string(person.jobId) + '\t' +
+                          std::to_string(person.departmentId) + '\t' + std::to_string(managerId) + '\t';
+                   appendCopyField(out, person.row->values[kFirstName]);
+                   out += '\t';
+                   appendCopyField(out, person.row->values[kLastName]);
+                   out += '\t';
+                   appendCopyField(out, person.row->values[kHireDate]);
+                   out += '\n';
+               });
+        exec("commit");
+    } catch (...) {
+        exec("rollback");
+        throw;
+    }
+    summary.inserted = order.size();
+    return summary;
+}
+
+int runImport(int argc, char *argv[]) {
+    std::vector<std::pair<std::string, std::string>> files;
+    unsigned threads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::string errorsPath;
+    for (int i = 0; i < argc; ++i) {
+        std::string option = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "missing value for " << option << std::endl;
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (option == "--departments" || option == "--jobs" || option == "--persons") {
+            files.emplace_back(option.substr(2), value);
+        } else if (option == "--threads") {
+            threads = static_cast<unsigned>(std::max(std::atoi(value.c_str()), 1));
+        } else if (option == "--errors") {
+            errorsPath = value;
+        } else {
+            std::cerr << "unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+    if (files.empty()) {
+        std::cerr << "usage: org_chart import [--departments FILE] [--jobs FILE] [--persons FILE] "
+                     "[--threads N] [--errors FILE]" << std::endl;
+        return 1;
+    }
+    // Persons refer to departments and jobs by name, so those load first whatever the argument order.
+    std::stable_sort(files.begin(), files.end(), [](const auto &a, const auto &b) {
+        return (a.first == "persons") < (b.first == "persons");
+    });
+
+    std::ofstream errorsOut;
+    if (!errorsPath.empty()) errorsOut.open(errorsPath);
+    std::size_t rejected = 0;
+    try {
+        Importer importer(pgConnInfo(), threads);
+        for (const auto &[kind, path] : files) {
+            auto start = std::chrono::steady_clock::now();
+            auto summary = kind == "departments" ? importer.importDepartments(path)
+                           : kind == "jobs"      ? importer.importJobs(path)
+                                                 : importer.importPersons(path);
+            std::sort(summary.errors.begin(), summary.errors.end(),
+                      [](const RowError &a, const RowError &b) { return a.line < b.line; });
+            for (std::size_t i = 0; i < summary.errors.size(); ++i) {
+                const auto &error = summary.errors[i];
+                if (i < kErrorsLogged) LOG_WARN << path << ":" << error.line << ": " << error.message;
+                if (errorsOut) errorsOut << path << ":" << error.line << ": " << error.message << "\n";
+            }
+            LOG_INFO << path << ": " << summary.inserted << " inserted, " << summary.skipped << " already present, "
+                     << summary.errors.size() << " rejected in " << elapsedMs(start) << " ms";
+            rejected += summary.errors.size();
+        }
+    } catch (const std::exception &e) {
+        LOG_ERROR << "import failed: " << e.what();
+        return 1;
+    }
+    return rejected == 0 ? 0 : 2;
+}
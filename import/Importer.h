@@ -0,0 +1,49 @@
+#pragma once
+
+#include "ImportRows.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct pg_conn;
+
+struct ImportSummary {
+    std::size_t inserted = 0;
+    // Rows naming a department, job or person that already exists.
+    std::size_t skipped = 0;
+    std::vector<RowError> errors;
+};
+
+// Bulk loads departments, jobs and persons from CSV or NDJSON files with COPY. Rows that fail
+// validation are reported and left out; the valid rows of a file are loaded in one transaction.
+//
+// departments: name
+// jobs:        title
+// persons:     first_name, last_name, hire_date, department, job,
+//              manager_first_name, manager_last_name (empty manager = reports to themselves)
+//
+// Managers may be in the same file or already in the database.
+class Importer {
+ public:
+    Importer(const std::string &connInfo, unsigned threads);
+    ~Importer();
+
+    auto importDepartments(const std::string &path) -> ImportSummary;
+    auto importJobs(const std::string &path) -> ImportSummary;
+    auto importPersons(const std::string &path) -> ImportSummary;
+
+ private:
+    auto importNames(const std::string &path, const std::string &table, const std::string &column) -> ImportSummary;
+    void exec(const std::string &sql);
+    void copyIn(const std::string &copySql, std::size_t rowCount,
+                const std::function<void(std::size_t row, std::string &out)> &renderRow);
+
+    std::unique_ptr<pg_conn, void (*)(pg_conn *)> conn;
+    unsigned threads;
+};
+
+// Entry point of `org_chart import [--departments FILE] [--jobs FILE] [--persons FILE]
+// [--threads N] [--errors FILE]`. Returns the process exit code: 0 when every row loaded,
+// 2 when some rows were rejected, 1 when an import could not run.
+int runImport(int argc, char *argv[]);
@@ -1,7 +1,35 @@
 #include <drogon/drogon.h>
-int main() {
+#include <stdexcept>
+#include "import/Importer.h"
+#include "migrations/Migrator.h"
+#include "utils/DbConfig.h"
+#include "utils/utils.h"
+
+int main(int argc, char *argv[]) {
+    const std::string configPath = "../config.json";
     LOG_DEBUG << "Load config file";
-    drogon::app().loadConfigFile("../config.json");
+    drogon::app().loadConfigFile(configPath);
+    try {
+        loadDbConfig(configPath);
+    } catch (const std::runtime_error &e) {
+        LOG_FATAL << e.what();
+        return 1;
+    }
+
+    LOG_DEBUG << "Apply schema migrations";
+    try {
+        Migrator migrator(drogon::orm::DbClient::newPgClient(pgConnInfo(), 1));
+        migrator.apply();
+    } catch (const drogon::orm::DrogonDbException &e) {
+        LOG_FATAL << "schema migration failed: " << e.base().what();
+        return 1;
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "import") {
+        return runImport(argc - 2, argv + 2);
+    }
+
+    drogon::app().setExceptionHandler(respondToException);
 
     LOG_DEBUG << "running on localhost:3000";
     drogon::app().run();
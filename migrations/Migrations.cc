@@ -0,0 +1,401 @@
+#include "Migrator.h"
+
+// Append new migrations at the end with the next version number; never edit one that has shipped.
+auto migrations() -> const std::vector<Migration> & {
+    static const std::vector<Migration> all = {
+        // Built concurrently so the first boot against a populated person table does not block
+        // writes. The invalid index a failed build leaves behind is dropped by the Migrator on
+        // the next boot.
+        {1, "person_foreign_key_indexes", {
+            "create index concurrently if not exists person_manager_id_idx on person (manager_id)",
+            "create index concurrently if not exists person_department_id_idx on person (department_id)",
+            "create index concurrently if not exists person_job_id_idx on person (job_id)",
+        }, false},
+        // Denormalized copy of the person/job/department/manager join read by the person
+        // listings. Columns are in PersonInfo order; triggers keep it in step with its sources.
+        {2, "person_details_table", {
+            R"sql(
+            create table person_details (
+                id int primary key,
+                job_id int not null,
+                department_id int not null,
+                manager_id int not null,
+                first_name varchar(50) not null,
+                last_name varchar(50) not null,
+                hire_date date not null,
+                job_title varchar(50) not null,
+                department_name varchar(50) not null,
+                manager_full_name text not null
+            ))sql",
+            "create index person_details_department_id_idx on person_details (department_id, id)",
+            "create index person_details_job_id_idx on person_details (job_id, id)",
+            "create index person_details_manager_id_idx on person_details (manager_id, id)",
+            R"sql(
+            create function person_details_refresh(pid int) returns void as $$
+            begin
+                delete from person_details where id = pid;
+                insert into person_details
+                select person.id, person.job_id, person.department_id, person.manager_id,
+                       person.first_name, person.last_name, person.hire_date,
+                       job.title, department.name,
+                       concat(manager.first_name, ' ', manager.last_name)
+                from person
+                join job on person.job_id = job.id
+                join department on person.department_id = department.id
+                join person as manager on person.manager_id = manager.id
+                where person.id = pid;
+            end;
+            $$ language plpgsql)sql",
+            R"sql(
+            create function person_details_on_person() returns trigger as $$
+            begin
+                if tg_op = 'DELETE' then
+                    delete from person_details where id = old.id;
+                    return old;
+                end if;
+                if tg_op = 'UPDATE' and new.id <> old.id then
+                    delete from person_details where id = old.id;
+                end if;
+                perform person_details_refresh(new.id);
+                if tg_op = 'UPDATE' and (new.first_name, new.last_name) is distinct from (old.first_name, old.last_name) then
+                    update person_details set manager_full_name = concat(new.first_name, ' ', new.last_name)
+                    where manager_id = new.id;
+                end if;
+                return new;
+            end;
+            $$ language plpgsql)sql",
+            R"sql(
+            create function person_details_on_job() returns trigger as $$
+            begin
+                if tg_op = 'DELETE' then
+                    delete from person_details where job_id = old.id;
+                    return old;
+                end if;
+                update person_details set job_title = new.title where job_id = new.id;
+                return new;
+            end;
+            $$ language plpgsql)sql",
+            R"sql(
+            create function person_details_on_department() returns trigger as $$
+            begin
+                if tg_op = 'DELETE' then
+                    delete from person_details where department_id = old.id;
+                    return old;
+                end if;
+                update person_details set department_name = new.name where department_id = new.id;
+                return new;
+            end;
+            $$ language plpgsql)sql",
+            "create trigger person_details_person after insert or update or delete on person "
+                "for each row execute function person_details_on_person()",
+            "create trigger person_details_job after update of title or delete on job "
+                "for each row execute function person_details_on_job()",
+            "create trigger person_details_department after update of name or delete on department "
+                "for each row execute function person_details_on_department()",
+            R"sql(
+            insert into person_details
+            select person.id, person.job_id, person.department_id, person.manager_id,
+                   person.first_name, person.last_name, person.hire_date,
+                   job.title, department.name,
+                   concat(manager.first_name, ' ', manager.last_name)
+            from person
+            join job on person.job_id = job.id
+            join department on person.department_id = department.id
+            join person as manager on person.manager_id = manager.id)sql",
+        }},
+        // Publishes "<table>:<id>" on org_chart_changes for every row change so each service
+        // instance can drop what it has cached (see ChangeListenerPlugin).
+        {3, "change_notifications", {
+            R"sql(
+            create function org_chart_notify_change() returns trigger as $$
+            begin
+                if tg_op = 'DELETE' then
+                    perform pg_notify('org_chart_changes', tg_table_name || ':' || old.id);
+                else
+                    perform pg_notify('org_chart_changes', tg_table_name || ':' || new.id);
+                end if;
+                return null;
+            end;
+            $$ language plpgsql)sql",
+            "create trigger person_notify_change after insert or update or delete on person "
+                "for each row execute function org_chart_notify_change()",
+            "create trigger job_notify_change after insert or update or delete on job "
+                "for each row execute function org_chart_notify_change()",
+            "create trigger department_notify_change after insert or update or delete on department "
+                "for each row execute function org_chart_notify_change()",
+            "create trigger users_notify_change after insert or update or delete on users "
+                "for each row execute function org_chart_notify_change()",
+        }},
+        // Only the (first_name, last_name) pair identifies a person; unique first names, last
+        // names and hire dates on their own made loading any real organization impossible.
+        {4, "person_drop_single_column_unique", {
+            "alter table person drop constraint if exists person_first_name_key",
+            "alter table person drop constraint if exists person_last_name_key",
+            "alter table person drop constraint if exists person_hire_date_key",
+        }},
+        // Row versions for ETags and optimistic concurrency (If-Match) on updates. person_details
+        // carries the person's version so GET /persons/{id} can expose it without a join.
+        {5, "row_versions", {
+            "alter table person add column version int not null default 1",
+            "alter table department add column version int not null default 1",
+            "alter table job add column version int not null default 1",
+            "alter table person_details add column version int not null default 1",
+            R"sql(
+            create or replace function person_details_refresh(pid int) returns void as $$
+            begin
+                delete from person_details where id = pid;
+                insert into person_details
+                select person.id, person.job_id, person.department_id, person.manager_id,
+                       person.first_name, person.last_name, person.hire_date,
+                       job.title, department.name,
+                       concat(manager.first_name, ' ', manager.last_name),
+                       person.version
+                from person
+                join job on person.job_id = job.id
+                join department on person.department_id = department.id
+                join person as manager on person.manager_id = manager.id
+                where person.id = pid;
+            end;
+            $$ language plpgsql)sql",
+        }},
+        // Managers of every person, nearest first, so a whole management chain is one index
+        // lookup. Kept up to date by a trigger that also rewrites the paths of the moved
+        // person's organization when their manager changes.
+        {6, "person_path", {
+            R"sql(
+            create table person_path (
+                id int primary key references person (id) on delete cascade,
+                ancestors int[] not null
+            ))sql",
+            "create index person_path_ancestors_idx on person_path using gin (ancestors)",
+            R"sql(
+            create function person_path_on_person() returns trigger as $$
+            declare
+                path int[];
+            begin
+                if new.manager_id = new.id then
+                    path := '{}';
+                else
+                    select array[new.manager_id] || ancestors into path from person_path where id = new.manager_id;
+                    path := coalesce(path, array[new.manager_id]);
+                end if;
+                if new.id = any(path) then
+                    raise exception 'person % would manage themselves', new.id using errcode = 'check_violation';
+                end if;
+                insert into person_path (id, ancestors) values (new.id, path)
+                on conflict (id) do update set ancestors = excluded.ancestors;
+                if tg_op = 'UPDATE' then
+                    update person_path
+                    set ancestors = ancestors[1:array_position(ancestors, new.id)] || path
+                    where ancestors @> array[new.id];
+                end if;
+                return new;
+            end;
+            $$ language plpgsql)sql",
+            "create trigger person_path_insert after insert on person "
+                "for each row execute function person_path_on_person()",
+            "create trigger person_path_update after update of manager_id on person "
+                "for each row when (new.manager_id is distinct from old.manager_id) "
+                "execute function person_path_on_person()",
+            R"sql(
+            insert into person_path (id, ancestors)
+            with recursive chain (id, ancestors) as (
+                select id, '{}'::int[] from person where manager_id = id
+                union all
+                select person.id, array[person.manager_id] || chain.ancestors
+                from person join chain on person.manager_id = chain.id
+                where person.id <> person.manager_id
+            )
+            select id, ancestors from chain)sql",
+        }},
+        // Every (ancestor, descendant) pair with the number of levels between them, including
+        // each person paired with themselves at depth 0, and the size of every person's
+        // organization. Both are maintained by triggers in the transaction of the person write.
+        {7, "person_closure", {
+            R"sql(
+            create table person_closure (
+                ancestor int not null references person (id) on delete cascade,
+                descendant int not null references person (id) on delete cascade,
+                depth int not null,
+                primary key (ancestor, descendant)
+            ))sql",
+            "create index person_closure_descendant_idx on person_closure (descendant, ancestor)",
+            R"sql(
+            create table person_org_size (
+                id int primary key references person (id) on delete cascade,
+                size int not null
+            ))sql",
+            R"sql(
+            create function person_closure_on_person() returns trigger as $$
+            declare
+                moved int;
+            begin
+                if tg_op = 'DELETE' then
+                    -- only people without reports can be deleted; the rows go with the person
+                    update person_org_size set size = size - 1
+                    where id in (select ancestor from person_closure where descendant = old.id and depth > 0);
+                    return old;
+                end if;
+
+                if tg_op = 'INSERT' then
+                    insert into person_closure (ancestor, descendant, depth) values (new.id, new.id, 0);
+                    insert into person_org_size (id, size) values (new.id, 0);
+                    moved := 1;
+                else
+                    if exists (select 1 from person_closure
+                               where ancestor = new.id and descendant = new.manager_id and depth > 0) then
+                        raise exception 'person % would manage themselves', new.id using errcode = 'check_violation';
+                    end if;
+                    select size + 1 into moved from person_org_size where id = new.id;
+                    update person_org_size set size = size - moved
+                    where id in (select ancestor from person_closure where descendant = new.id and depth > 0);
+                    delete from person_closure
+                    where descendant in (select descendant from person_closure where ancestor = new.id)
+                      and ancestor in (select ancestor from person_closure where descendant = new.id and depth > 0);
+                end if;
+
+                if new.manager_id <> new.id then
+                    insert into person_closure (ancestor, descendant, depth)
+                    select above.ancestor, below.descendant, above.depth + below.depth + 1
+                    from person_closure above, person_closure below
+                    where above.descendant = new.manager_id and below.ancestor = new.id;
+                    update person_org_size set size = size + moved
+                    where id in (select ancestor from person_closure where descendant = new.id and depth > 0);
+                end if;
+                return new;
+            end;
+            $$ language plpgsql)sql",
+            "create trigger person_closure_insert after insert on person "
+                "for each row execute function person_closure_on_person()",
+            "create trigger person_closure_update after update of manager_id on person "
+                "for each row when (new.manager_id is distinct from old.manager_id) "
+                "execute function person_closure_on_person()",
+            "create trigger person_closure_delete before delete on person "
+                "for each row execute function person_closure_on_person()",
+            R"sql(
+            insert into person_closure (ancestor, descendant, depth)
+            select id, id, 0 from person_path
+            union all
+            select above.ancestor, person_path.id, above.depth
+            from person_path cross join unnest(person_path.ancestors) with ordinality as above (ancestor, depth))sql",
+            R"sql(
+            insert into person_org_size (id, size)
+            select ancestor, count(*) - 1 from person_closure group by ancestor)sql",
+        }},
+        // Two moves that each look fine against the other's uncommitted state (X under Y and Y
+        // under X) could both pass the checks of migrations 6 and 7 and commit a loop. Every
+        // hierarchy write now takes one transaction-level advisory lock ("org_tree") first, so
+        // they run one at a time; under READ COMMITTED each statement after the lock sees the
+        // rows the previous writer committed.
+        {8, "person_hierarchy_lock", {
+            R"sql(
+            create or replace function person_path_on_person() returns trigger as $$
+            declare
+                path int[];
+            begin
+                perform pg_advisory_xact_lock(8030594745228223845);
+                if new.manager_id = new.id then
+                    path := '{}';
+                else
+                    select array[new.manager_id] || ancestors into path from person_path where id = new.manager_id;
+                    path := coalesce(path, array[new.manager_id]);
+                end if;
+                if new.id = any(path) then
+                    raise exception 'person % would manage themselves', new.id using errcode = 'check_violation';
+                end if;
+                insert into person_path (id, ancestors) values (new.id, path)
+                on conflict (id) do update set ancestors = excluded.ancestors;
+                if tg_op = 'UPDATE' then
+                    update person_path
+                    set ancestors = ancestors[1:array_position(ancestors, new.id)] || path
+                    where ancestors @> array[new.id];
+                end if;
+                return new;
+            end;
+            $$ language plpgsql)sql",
+            R"sql(
+            create or replace function person_closure_on_person() returns trigger as $$
+            declare
+                moved int;
+            begin
+                perform pg_advisory_xact_lock(8030594745228223845);
+                if tg_op = 'DELETE' then
+                    -- only people without reports can be deleted; the rows go with the person
+                    update person_org_size set size = size - 1
+                    where id in (select ancestor from person_closure where descendant = old.id and depth > 0);
+                    return old;
+                end if;
+
+                if tg_op = 'INSERT' then
+                    insert into person_closure (ancestor, descendant, depth) values (new.id, new.id, 0);
+                    insert into person_org_size (id, size) values (new.id, 0);
+                    moved := 1;
+                else
+                    if exists (select 1 from person_closure
+                               where ancestor = new.id and descendant = new.manager_id and depth > 0) then
+                        raise exception 'person % would manage themselves', new.id using errcode = 'check_violation';
+                    end if;
+                    select size + 1 into moved from person_org_size where id = new.id;
+                    update person_org_size set size = size - moved
+                    where id in (select ancestor from person_closure where descendant = new.id and depth > 0);
+                    delete from person_closure
+                    where descendant in (select descendant from person_closure where ancestor = new.id)
+                      and ancestor in (select ancestor from person_closure where descendant = new.id and depth > 0);
+                end if;
+
+                if new.manager_id <> new.id then
+                    insert into person_closure (ancestor, descendant, depth)
+                    select above.ancestor, below.descendant, above.depth + below.depth + 1
+                    from person_closure above, person_closure below
+                    where above.descendant = new.manager_id and below.ancestor = new.id;
+                    update person_org_size set size = size + moved
+                    where id in (select ancestor from person_closure where descendant = new.id and depth > 0);
+                end if;
+                return new;
+            end;
+            $$ language plpgsql)sql",
+        }},
+        // The one-pass fills of migrations 2 (with migration 5's version), 6 and 7 as functions,
+        // for bulk loads that disable the row triggers (see bench/datagen.cc). Each expects its
+        // tables empty; person_closure_backfill reads person_path and fills person_org_size too.
+        {9, "derived_table_backfills", {
+            R"sql(
+            create function person_details_backfill() returns void as $$
+                insert into person_details (id, job_id, department_id, manager_id, first_name, last_name,
+                                            hire_date, job_title, department_name, manager_full_name, version)
+                select person.id, person.job_id, person.department_id, person.manager_id,
+                       person.first_name, person.last_name, person.hire_date,
+                       job.title, department.name,
+                       concat(manager.first_name, ' ', manager.last_name),
+                       person.version
+                from person
+                join job on person.job_id = job.id
+                join department on person.department_id = department.id
+                join person as manager on person.manager_id = manager.id
+            $$ language sql)sql",
+            R"sql(
+            create function person_path_backfill() returns void as $$
+                insert into person_path (id, ancestors)
+                with recursive chain (id, ancestors) as (
+                    select id, '{}'::int[] from person where manager_id = id
+                    union all
+                    select person.id, array[person.manager_id] || chain.ancestors
+                    from person join chain on person.manager_id = chain.id
+                    where person.id <> person.manager_id
+                )
+                select id, ancestors from chain
+            $$ language sql)sql",
+            R"sql(
+            create function person_closure_backfill() returns void as $$
+                insert into person_closure (ancestor, descendant, depth)
+                select id, id, 0 from person_path
+                union all
+                select above.ancestor, person_path.id, above.depth
+                from person_path cross join unnest(person_path.ancestors) with ordinality as above (ancestor, depth);
+                insert into person_org_size (id, size)
+                select ancestor, count(*) - 1 from person_closure group by ancestor
+            $$ language sql)sql",
+        }},
+    };
+    return all;
+}
@@ -0,0 +1,93 @@
+#include "Migrator.h"
+#include <drogon/orm/Exception.h>
+#include <trantor/utils/Logger.h>
+#include <regex>
+
+using namespace drogon::orm;
+
+namespace {
+    // Serializes concurrent instances migrating the same database at boot.
+    const long long kMigrationLockKey = 0x6f72675f63686172;
+
+    bool isApplied(DbClient &db, const Migration &migration) {
+        return !db.execSqlSync("select version from schema_migrations where version = $1", migration.version).empty();
+    }
+
+    // A failed create index concurrently leaves an invalid index behind, which "if not exists"
+    // would keep on the next attempt; drop it so the statement builds the index again.
+    void dropInvalidIndex(DbClient &db, const std::string &statement) {
+        static const std::regex createIndex(
+            R"(^\s*create\s+(?:unique\s+)?index\s+concurrently\s+if\s+not\s+exists\s+(\w+))", std::regex::icase);
+        std::smatch match;
+        if (!std::regex_search(statement, match, createIndex)) return;
+        auto name = match[1].str();
+        auto index = db.execSqlSync("select indisvalid from pg_index where indexrelid = to_regclass($1)", name);
+        if (index.empty() || index[0]["indisvalid"].as<bool>()) return;
+        LOG_WARN << "dropping invalid index " << name << " left by an earlier attempt";
+        db.execSqlSync("drop index concurrently if exists " + name);
+    }
+
+    void record(DbClient &db, const Migration &migration) {
+        db.execSqlSync("insert into schema_migrations (version, name) values ($1, $2)",
+                       migration.version, migration.name);
+    }
+}
+
+Migrator::Migrator(const DbClientPtr &dbClientPtr, const std::vector<Migration> &all)
+    : dbClientPtr{dbClientPtr}, all{all} {}
+
+auto Migrator::apply() -> int {
+    dbClientPtr->execSqlSync("create table if not exists schema_migrations ( \n\
+                                  version int primary key, \n\
+                                  name varchar(100) not null, \n\
+                                  applied_at timestamptz not null default now())");
+
+    int applied = 0;
+    for (const auto &migration : all) {
+        bool ran = migration.transactional ? applyInTransaction(migration) : applyOutsideTransaction(migration);
+        if (ran) ++applied;
+    }
+    LOG_INFO << "schema up to date, " << applied << " migration(s) applied";
+    return applied;
+}
+
+bool Migrator::applyInTransaction(const Migration &migration) {
+    auto trans = dbClientPtr->newTransaction();
+    try {
+        trans->execSqlSync("select pg_advisory_xact_lock($1)", kMigrationLockKey);
+        if (isApplied(*trans, migration)) return false;
+
+        LOG_INFO << "applying migration " << migration.version << " " << migration.name;
+        for (const auto &statement : migration.statements) {
+            trans->execSqlSync(statement);
+        }
+        record(*trans, migration);
+        return true;
+    } catch (const DrogonDbException &e) {
+        LOG_ERROR << "migration " << migration.version << " " << migration.name << " failed: " << e.base().what();
+        trans->rollback();
+        throw;
+    }
+}
+
+bool Migrator::applyOutsideTransaction(const Migration &migration) {
+    dbClientPtr->execSqlSync("select pg_advisory_lock($1)", kMigrationLockKey);
+    try {
+        bool ran = !isApplied(*dbClientPtr, migration);
+        if (ran) {
+            LOG_INFO << "applying migration " << migration.version << " " << migration.name
+                     << " outside a transaction";
+            for (const auto &statement : migration.statements) {
+                dropInvalidIndex(*dbClientPtr, statement);
+                dbClientPtr->execSqlSync(statement);
+            }
+            record(*dbClientPtr, migration);
+        }
+        dbClientPtr->execSqlSync("select pg_advisory_unlock($1)", kMigrationLockKey);
+        return ran;
+    } catch (const DrogonDbException &e) {
+        // The lock goes with the session when the failed boot closes its connection.
+        LOG_ERROR << "migration " << migration.version << " " << migration.name << " failed: " << e.base().what();
+        throw;
+    }
+}
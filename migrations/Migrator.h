@@ -0,0 +1,39 @@
+#pragma once
+
+#include <drogon/orm/DbClient.h>
+#include <string>
+#include <vector>
+
+struct Migration {
+    int version;
+    std::string name;
+    // Executed one by one inside a single transaction, unless transactional is false.
+    std::vector<std::string> statements;
+    // False for statements PostgreSQL refuses inside a transaction block, such as
+    // create index concurrently. They then run one by one under a session lock, so each must be
+    // safe to run again after a failure part way through; the Migrator drops the invalid index
+    // a failed "create index concurrently if not exists" leaves behind before running it again.
+    bool transactional = true;
+};
+
+// Numbered schema changes, in the order they must be applied. See Migrations.cc.
+auto migrations() -> const std::vector<Migration> &;
+
+class Migrator {
+ public:
+    // dbClientPtr must have a single connection: the lock taken for migrations that run outside
+    // a transaction belongs to the session.
+    explicit Migrator(const drogon::orm::DbClientPtr &dbClientPtr,
+                      const std::vector<Migration> &all = migrations());
+    // Applies every migration newer than the recorded schema version and returns how many ran.
+    // Throws drogon::orm::DrogonDbException if a migration fails; a transactional migration is
+    // rolled back.
+    auto apply() -> int;
+
+ private:
+    bool applyInTransaction(const Migration &migration);
+    bool applyOutsideTransaction(const Migration &migration);
+
+    drogon::orm::DbClientPtr dbClientPtr;
+    std::vector<Migration> all;
+};
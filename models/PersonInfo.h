@@ -96,6 +96,15 @@ class PersonInfo
     const std::shared_ptr<::trantor::Date> &getHireDate() const noexcept;
 
     Json::Value toJson() const;
+
+    /// Reads the person_details table, which is kept in step with person, job and department
+    /// by triggers (see migrations/Migrations.cc). Columns are in the order read by the constructor.
+    /// Callers append their own where/order/limit clauses.
+    static const std::string &sqlForSelecting()
+    {
+        static const std::string sql="select * from person_details";
+        return sql;
+    }
   private:
     friend drogon::orm::Mapper<PersonInfo>;
     std::shared_ptr<int32_t> id_;
@@ -0,0 +1,59 @@
+#include "AllocTrackingPlugin.h"
+#include <drogon/drogon.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include "../utils/AllocTracking.h"
+#include "../utils/Metrics.h"
+
+using namespace drogon;
+
+void AllocTrackingPlugin::initAndStart(const Json::Value &) {
+    LOG_DEBUG << "AllocTracking initialized and Start";
+    if (!kAllocTracking) {
+        LOG_DEBUG << "allocation tracking not built in, configure with -DORG_CHART_TRACK_ALLOCATIONS=ON";
+        return;
+    }
+
+    auto &registry = MetricsRegistry::instance();
+    registry.describe("http_request_allocations", "Heap allocations made while handling a request.");
+    registry.describe("http_request_allocated_bytes", "Bytes allocated on the heap while handling a request.");
+
+    app().registerPreRoutingAdvice([](const HttpRequestPtr &req) {
+        attachAllocCounters(req);
+        // Runs once the IO thread is done with this request's parsing, routing, filters and
+        // handler, so later work on the loop is not charged to it.
+        trantor::EventLoop::getEventLoopOfCurrentThread()->queueInLoop([]() { setCurrentAllocCounters(nullptr); });
+    });
+    app().registerPostHandlingAdvice(&AllocTrackingPlugin::observe);
+}
+
+void AllocTrackingPlugin::shutdown() {
+    LOG_DEBUG << "AllocTracking shut down";
+}
+
+void AllocTrackingPlugin::observe(const HttpRequestPtr &req, const HttpResponsePtr &resp) {
+    auto counters = allocCountersOf(req);
+    if (!counters) return;
+    auto count = counters->count.load(std::memory_order_relaxed);
+    auto bytes = counters->bytes.load(std::memory_order_relaxed);
+    resp->addHeader("X-Alloc-Count", std::to_string(count));
+    resp->addHeader("X-Alloc-Bytes", std::to_string(bytes));
+
+    std::string_view pattern = req->matchedPathPattern();
+    thread_local std::unordered_map<std::string, std::pair<int, int>> seriesIds;
+    auto key = std::string(req->methodString()) + " " + std::string(pattern);
+    auto it = seriesIds.find(key);
+    if (it == seriesIds.end()) {
+        auto labels = metricLabel("method", req->methodString()) + "," +
+                      metricLabel("route", pattern.empty() ? std::string_view("unmatched") : pattern);
+        auto &registry = MetricsRegistry::instance();
+        it = seriesIds
+                 .emplace(key, std::make_pair(registry.countSeries("http_request_allocations", labels),
+                                              registry.countSeries("http_request_allocated_bytes", labels)))
+                 .first;
+    }
+    MetricsRegistry::instance().record(it->second.first, count);
+    MetricsRegistry::instance().record(it->second.second, bytes);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <drogon/plugins/Plugin.h>
+#include <drogon/HttpRequest.h>
+#include <drogon/HttpResponse.h>
+
+// Reports heap allocations per request in builds configured with
+// -DORG_CHART_TRACK_ALLOCATIONS=ON (see utils/AllocTracking.h): X-Alloc-Count and
+// X-Alloc-Bytes response headers, and http_request_allocations and
+// http_request_allocated_bytes summaries by method and route at /metrics. Counted are
+// allocations on the IO thread while the request is routed, filtered and handled, and in its
+// database callbacks; the framework's work after the response is handed over is not.
+class AllocTrackingPlugin : public drogon::Plugin<AllocTrackingPlugin> {
+ public:
+    virtual void initAndStart(const Json::Value &config) override;
+    virtual void shutdown() override;
+
+ private:
+    static void observe(const drogon::HttpRequestPtr &req, const drogon::HttpResponsePtr &resp);
+};
@@ -0,0 +1,53 @@
+#include "ChangeListenerPlugin.h"
+#include <drogon/drogon.h>
+#include "../utils/DbConfig.h"
+
+using namespace drogon;
+
+namespace {
+    const char *kChannel = "org_chart_changes";
+}
+
+void ChangeListenerPlugin::initAndStart(const Json::Value &config) {
+    LOG_DEBUG << "ChangeListener initialized and Start";
+    listener = orm::DbListener::newPgListener(pgConnInfo());
+    listener->listen(kChannel, [this](const std::string &payload) {
+        dispatch(payload);
+    });
+}
+
+void ChangeListenerPlugin::shutdown() {
+    LOG_DEBUG << "ChangeListener shut down";
+    if (listener) listener->unlisten(kChannel);
+    listener.reset();
+}
+
+void ChangeListenerPlugin::subscribe(ChangeCallback callback) {
+    std::lock_guard<std::mutex> lock(mutex);
+    subscribers.push_back(std::move(callback));
+}
+
+void ChangeListenerPlugin::dispatch(const std::string &payload) {
+    auto pos = payload.find(':');
+    if (pos == std::string::npos) {
+        LOG_ERROR << "malformed change notification: " << payload;
+        return;
+    }
+    auto table = payload.substr(0, pos);
+    int id;
+    try {
+        id = std::stoi(payload.substr(pos + 1));
+    } catch (const std::exception &e) {
+        LOG_ERROR << "malformed change notification: " << payload;
+        return;
+    }
+
+    std::vector<ChangeCallback> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        callbacks = subscribers;
+    }
+    for (const auto &callback : callbacks) {
+        callback(table, id);
+    }
+}
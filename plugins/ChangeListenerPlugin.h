@@ -0,0 +1,28 @@
+#pragma once
+
+#include <drogon/plugins/Plugin.h>
+#include <drogon/orm/DbListener.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Listens on the channel the notify triggers publish to (migration 3) and fans each
+// "<table>:<id>" message out to subscribers, so every instance sees writes made on any other.
+class ChangeListenerPlugin : public drogon::Plugin<ChangeListenerPlugin> {
+ public:
+    using ChangeCallback = std::function<void(const std::string &table, int id)>;
+
+    virtual void initAndStart(const Json::Value &config) override;
+    virtual void shutdown() override;
+    // Callbacks run on the listener's own event loop thread.
+    void subscribe(ChangeCallback callback);
+
+ private:
+    void dispatch(const std::string &payload);
+
+    std::shared_ptr<drogon::orm::DbListener> listener;
+    std::mutex mutex;
+    std::vector<ChangeCallback> subscribers;
+};
@@ -0,0 +1,242 @@
+#include "CompressionPlugin.h"
+#include <drogon/drogon.h>
+#include <zlib.h>
+#ifdef ORG_CHART_USE_BROTLI
+#include <brotli/encode.h>
+#endif
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdlib>
+#include <vector>
+#include "../utils/utils.h"
+
+using namespace drogon;
+
+namespace {
+    bool isCompressible(const HttpResponsePtr &resp) {
+        switch (resp->contentType()) {
+            case CT_APPLICATION_JSON:
+            case CT_TEXT_PLAIN:
+            case CT_TEXT_HTML:
+            case CT_TEXT_CSV:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // One deflate stream per IO thread, reset between responses instead of reallocated.
+    struct GzipContext {
+        z_stream stream{};
+        bool initialized = false;
+        int level = 0;
+
+        ~GzipContext() {
+            if (initialized) deflateEnd(&stream);
+        }
+
+        bool compress(std::string_view in, int pLevel, std::string &out) {
+            if (initialized && level != pLevel) {
+                deflateEnd(&stream);
+                initialized = false;
+            }
+            if (!initialized) {
+                // 15 window bits + 16 selects the gzip wrapper
+                if (deflateInit2(&stream, pLevel, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) return false;
+                initialized = true;
+                level = pLevel;
+            } else if (deflateReset(&stream) != Z_OK) {
+                return false;
+            }
+            out.resize(deflateBound(&stream, in.size()));
+            stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in.data()));
+            stream.avail_in = in.size();
+            stream.next_out = reinterpret_cast<Bytef *>(&out[0]);
+            stream.avail_out = out.size();
+            if (deflate(&stream, Z_FINISH) != Z_STREAM_END) return false;
+            out.resize(stream.total_out);
+            return true;
+        }
+    };
+
+    thread_local GzipContext gzipContext;
+
+#ifdef ORG_CHART_USE_BROTLI
+    // Brotli cannot reset an encoder, so each response gets a new one. Its memory comes from
+    // blocks this thread kept from earlier responses rather than from the heap, and the output
+    // is streamed through a buffer that is reused as well.
+    struct BrotliContext {
+        // Each block starts with a header holding its capacity.
+        static constexpr size_t kHeader = alignof(std::max_align_t);
+        static constexpr size_t kMaxSpareBlocks = 16;
+
+        std::vector<void *> spare;
+        std::vector<uint8_t> buffer = std::vector<uint8_t>(64 * 1024);
+
+        ~BrotliContext() {
+            for (auto *block : spare) std::free(block);
+        }
+
+        static auto capacityOf(void *block) -> size_t { return *static_cast<size_t *>(block); }
+
+        static void *allocate(void *opaque, size_t size) {
+            auto &spare = static_cast<BrotliContext *>(opaque)->spare;
+            // the smallest kept block that fits, unless it would waste more than half of itself
+            auto best = spare.end();
+            for (auto it = spare.begin(); it != spare.end(); ++it) {
+                auto capacity = capacityOf(*it);
+                if (capacity >= size && capacity / 2 <= size &&
+                    (best == spare.end() || capacity < capacityOf(*best))) {
+                    best = it;
+                }
+            }
+            void *block;
+            if (best != spare.end()) {
+                block = *best;
+                *best = spare.back();
+                spare.pop_back();
+            } else {
+                block = std::malloc(kHeader + size);
+                if (block == nullptr) return nullptr;
+                *static_cast<size_t *>(block) = size;
+            }
+            return static_cast<char *>(block) + kHeader;
+        }
+
+        static void release(void *opaque, void *address) {
+            if (address == nullptr) return;
+            auto &spare = static_cast<BrotliContext *>(opaque)->spare;
+            auto *block = static_cast<char *>(address) - kHeader;
+            if (spare.size() < kMaxSpareBlocks) {
+                spare.push_back(block);
+            } else {
+                std::free(block);
+            }
+        }
+
+        bool compress(std::string_view in, int quality, std::string &out) {
+            auto *state = BrotliEncoderCreateInstance(allocate, release, this);
+            if (state == nullptr) return false;
+            BrotliEncoderSetParameter(state, BROTLI_PARAM_QUALITY, quality);
+            BrotliEncoderSetParameter(state, BROTLI_PARAM_MODE, BROTLI_MODE_TEXT);
+            BrotliEncoderSetParameter(state, BROTLI_PARAM_SIZE_HINT, static_cast<uint32_t>(std::min<size_t>(in.size(), 1u << 30)));
+
+            auto availableIn = in.size();
+            auto *nextIn = reinterpret_cast<const uint8_t *>(in.data());
+            bool ok = true;
+            out.clear();
+            while (ok && !BrotliEncoderIsFinished(state)) {
+                auto availableOut = buffer.size();
+                auto *nextOut = buffer.data();
+                ok = BrotliEncoderCompressStream(state, BROTLI_OPERATION_FINISH, &availableIn, &nextIn,
+                                                 &availableOut, &nextOut, nullptr);
+                out.append(reinterpret_cast<const char *>(buffer.data()), buffer.size() - availableOut);
+            }
+            BrotliEncoderDestroyInstance(state);
+            return ok;
+        }
+    };
+
+    thread_local BrotliContext brotliContext;
+#endif
+}  // namespace
+
+auto CompressionPlugin::negotiate(const std::string &acceptEncoding) -> Encoding {
+    // -1: not listed. Identity is acceptable unless excluded, but least preferred when unlisted.
+    double gzip = -1, brotli = -1, identity = -1, any = -1;
+    size_t pos = 0;
+    while (pos < acceptEncoding.size()) {
+        auto end = acceptEncoding.find(',', pos);
+        if (end == std::string::npos) end = acceptEncoding.size();
+        auto item = acceptEncoding.substr(pos, end - pos);
+        pos = end + 1;
+
+        double q = 1;
+        auto semi = item.find(';');
+        if (semi != std::string::npos) {
+            auto qPos = item.find("q=", semi);
+            if (qPos != std::string::npos) q = std::atof(item.c_str() + qPos + 2);
+            item.resize(semi);
+        }
+        auto first = item.find_first_not_of(" \t");
+        auto last = item.find_last_not_of(" \t");
+        if (first == std::string::npos) continue;
+        auto coding = item.substr(first, last - first + 1);
+        std::transform(coding.begin(), coding.end(), coding.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (coding == "gzip") gzip = q;
+        else if (coding == "br") brotli = q;
+        else if (coding == "identity") identity = q;
+        else if (coding == "*") any = q;
+    }
+    if (gzip < 0) gzip = any;
+    if (brotli < 0) brotli = any;
+    if (identity < 0) identity = any >= 0 ? any : 0.001;
+#ifndef ORG_CHART_USE_BROTLI
+    brotli = -1;
+#endif
+    if (brotli > 0 && brotli >= gzip && brotli >= identity) return Encoding::Brotli;
+    if (gzip > 0 && gzip >= identity) return Encoding::Gzip;
+    return Encoding::Identity;
+}
+
+bool CompressionPlugin::encode(std::string_view body, Encoding encoding, std::string &out) const {
+    switch (encoding) {
+        case Encoding::Gzip:
+            return gzipContext.compress(body, gzipLevel, out);
+#ifdef ORG_CHART_USE_BROTLI
+        case Encoding::Brotli:
+            return brotliContext.compress(body, brotliQuality, out);
+#endif
+        default:
+            return false;
+    }
+}
+
+void CompressionPlugin::initAndStart(const Json::Value &config) {
+    LOG_DEBUG << "Compression initialized and Start";
+    minSize = config.get("min_size", 1024).asUInt();
+    gzipLevel = config.get("gzip_level", 6).asInt();
+    brotliQuality = config.get("brotli_quality", 5).asInt();
+    for (const auto &path : config["exclude_paths"]) {
+        excludedPaths.push_back(path.asString());
+    }
+
+    app().registerPostHandlingAdvice([this](const HttpRequestPtr &req, const HttpResponsePtr &resp) {
+        compress(req, resp);
+    });
+}
+
+void CompressionPlugin::shutdown() {
+    LOG_DEBUG << "Compression shut down";
+}
+
+bool CompressionPlugin::isExcluded(const std::string &path) const {
+    for (const auto &prefix : excludedPaths) {
+        if (path.compare(0, prefix.size(), prefix) == 0) return true;
+    }
+    return false;
+}
+
+void CompressionPlugin::compress(const HttpRequestPtr &req, const HttpResponsePtr &resp) const {
+    if (!resp->getHeader("content-encoding").empty()) return;
+    if (!isCompressible(resp) || isExcluded(req->path())) return;
+    // Caches must key on Accept-Encoding even for a body sent as is, or one stored for a client
+    // without gzip would be served to every other client too.
+    addVary(resp, "Accept-Encoding");
+
+    auto body = resp->getBody();
+    if (body.size() < minSize) return;
+
+    auto encoding = negotiate(req->getHeader("accept-encoding"));
+    if (encoding == Encoding::Identity) return;
+
+    std::string out;
+    if (!encode(body, encoding, out)) {
+        LOG_ERROR << (encoding == Encoding::Gzip ? "gzip" : "brotli") << " compression failed";
+        return;
+    }
+    resp->addHeader("Content-Encoding", encoding == Encoding::Gzip ? "gzip" : "br");
+    resp->setBody(std::move(out));
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <drogon/plugins/Plugin.h>
+#include <drogon/HttpRequest.h>
+#include <drogon/HttpResponse.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Compresses dynamic JSON/text responses with gzip or brotli, whichever the client prefers
+// in Accept-Encoding. Static files keep using the precompressed gzip_static/br_static files.
+class CompressionPlugin : public drogon::Plugin<CompressionPlugin> {
+ public:
+    virtual void initAndStart(const Json::Value &config) override;
+    virtual void shutdown() override;
+
+    enum class Encoding { Identity, Gzip, Brotli };
+    // The coding with the highest quality value in an Accept-Encoding header, e.g.
+    // "gzip;q=0.8, br". Brotli is only chosen when built in; ties go to the smaller output.
+    static auto negotiate(const std::string &acceptEncoding) -> Encoding;
+    // Compresses body into out with this thread's reusable context; false on failure.
+    bool encode(std::string_view body, Encoding encoding, std::string &out) const;
+
+ private:
+    void compress(const drogon::HttpRequestPtr &req, const drogon::HttpResponsePtr &resp) const;
+    bool isExcluded(const std::string &path) const;
+
+    size_t minSize = 1024;
+    int gzipLevel = 6;
+    int brotliQuality = 5;
+    std::vector<std::string> excludedPaths;
+};
@@ -0,0 +1,70 @@
+#include "MetricsPlugin.h"
+#include <drogon/drogon.h>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "../utils/Metrics.h"
+
+using namespace drogon;
+
+void MetricsPlugin::initAndStart(const Json::Value &config) {
+    LOG_DEBUG << "Metrics initialized and Start";
+    probeInterval = config.get("loop_probe_interval", 1.0).asDouble();
+
+    auto &registry = MetricsRegistry::instance();
+    registry.describe("http_request_duration_seconds",
+                      "Time from receiving a request to handing its response to the framework.");
+    registry.describe("io_loop_queue_delay_seconds",
+                      "How long the last probe task waited in the IO loop's queue before running.");
+
+    app().registerPostHandlingAdvice(&MetricsPlugin::observe);
+    // IO loops only exist once the app is running.
+    app().registerBeginningAdvice([this]() { startLoopProbes(); });
+}
+
+void MetricsPlugin::shutdown() {
+    LOG_DEBUG << "Metrics shut down";
+}
+
+void MetricsPlugin::observe(const HttpRequestPtr &req, const HttpResponsePtr &resp) {
+    auto micros = trantor::Date::now().microSecondsSinceEpoch() - req->creationDate().microSecondsSinceEpoch();
+    std::string_view pattern = req->matchedPathPattern();
+
+    // Series ids per thread, keyed without allocating once the key buffer has grown.
+    thread_local std::unordered_map<std::string, int> seriesIds;
+    thread_local std::string key;
+    key.assign(req->methodString());
+    key += ' ';
+    key.append(pattern.data(), pattern.size());
+    key += ' ';
+    key += std::to_string(static_cast<int>(resp->statusCode()));
+
+    auto it = seriesIds.find(key);
+    if (it == seriesIds.end()) {
+        // Unrouted paths share one label so scanners cannot blow up the series count.
+        auto labels = metricLabel("method", req->methodString()) + "," +
+                      metricLabel("route", pattern.empty() ? std::string_view("unmatched") : pattern) + "," +
+                      metricLabel("status", std::to_string(static_cast<int>(resp->statusCode())));
+        auto id = MetricsRegistry::instance().latencySeries("http_request_duration_seconds", labels);
+        it = seriesIds.emplace(key, id).first;
+    }
+    MetricsRegistry::instance().record(it->second, micros < 0 ? 0 : static_cast<uint64_t>(micros));
+}
+
+void MetricsPlugin::startLoopProbes() const {
+    for (size_t i = 0; i < app().getThreadNum(); ++i) {
+        auto *loop = app().getIOLoop(i);
+        auto gaugeId = MetricsRegistry::instance().gaugeSeries("io_loop_queue_delay_seconds",
+                                                               metricLabel("loop", std::to_string(i)));
+        // The timer fires on the loop itself; the task it queues runs after everything already
+        // waiting there, so its delay tracks the backlog.
+        loop->runEvery(probeInterval, [loop, gaugeId]() {
+            auto queuedAt = std::chrono::steady_clock::now();
+            loop->queueInLoop([queuedAt, gaugeId]() {
+                auto delay = std::chrono::duration<double>(std::chrono::steady_clock::now() - queuedAt).count();
+                MetricsRegistry::instance().set(gaugeId, delay);
+            });
+        });
+    }
+}
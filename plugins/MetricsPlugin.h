@@ -0,0 +1,20 @@
+#pragma once
+
+#include <drogon/plugins/Plugin.h>
+#include <drogon/HttpRequest.h>
+#include <drogon/HttpResponse.h>
+
+// Feeds MetricsRegistry (served by MetricsController at /metrics): latency of every response by
+// method, matched route pattern and status, and how long work queued on each IO loop waits
+// before it runs.
+class MetricsPlugin : public drogon::Plugin<MetricsPlugin> {
+ public:
+    virtual void initAndStart(const Json::Value &config) override;
+    virtual void shutdown() override;
+
+ private:
+    static void observe(const drogon::HttpRequestPtr &req, const drogon::HttpResponsePtr &resp);
+    void startLoopProbes() const;
+
+    double probeInterval = 1.0;
+};
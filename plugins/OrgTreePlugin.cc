@@ -0,0 +1,193 @@
+#include "OrgTreePlugin.h"
+#include <drogon/drogon.h>
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include "ChangeListenerPlugin.h"
+#include "../utils/TimedQuery.h"
+#include "../utils/utils.h"
+
+using namespace drogon;
+using namespace drogon::orm;
+
+void OrgTreePlugin::initAndStart(const Json::Value &config) {
+    LOG_DEBUG << "OrgTree initialized and Start";
+    retryInterval = config.get("retry_interval", 5.0).asDouble();
+    reloadInterval = config.get("reload_interval", 300.0).asDouble();
+
+    if (auto *listenerPtr = app().getPlugin<ChangeListenerPlugin>()) {
+        listenerPtr->subscribe([this](const std::string &table, int id) {
+            if (table == "person") refresh(id);
+        });
+    }
+    // The database client is only usable once the app runs. Notifications missed while the
+    // listener reconnects would leave the tree wrong for good, so it is also reloaded in full
+    // every reload_interval.
+    app().registerBeginningAdvice([this]() {
+        load();
+        if (reloadInterval > 0) app().getLoop()->runEvery(reloadInterval, [this]() { load(); });
+    });
+}
+
+void OrgTreePlugin::shutdown() {
+    LOG_DEBUG << "OrgTree shut down";
+}
+
+void OrgTreePlugin::load() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (loading) return;
+        loading = true;
+    }
+    TimedQuery timed(nullptr, "person.load_org_tree");
+    *dbClient() << "select id, manager_id from person"
+                >> timed.onResult([this](const Result &result) {
+                       std::vector<std::pair<int, int>> managers;
+                       managers.reserve(result.size());
+                       for (const auto &row : result) {
+                           managers.emplace_back(row["id"].as<int32_t>(), row["manager_id"].as<int32_t>());
+                       }
+                       // built aside, so lookups keep answering from the current tree meanwhile
+                       OrgTree fresh;
+                       fresh.build(managers);
+                       std::vector<int> pending;
+                       {
+                           std::lock_guard<std::mutex> lock(mutex);
+                           tree = std::move(fresh);
+                           loaded = true;
+                           loading = false;
+                           pending.swap(pendingIds);
+                       }
+                       LOG_INFO << "org tree loaded, " << managers.size() << " persons";
+                       // changes made after the select started may be missing from its rows
+                       for (auto id : pending) refresh(id);
+                   })
+                >> timed.onError([this](const DrogonDbException &e) {
+                       LOG_ERROR << "org tree load failed, retrying: " << e.base().what();
+                       {
+                           std::lock_guard<std::mutex> lock(mutex);
+                           loading = false;
+                       }
+                       app().getLoop()->runAfter(retryInterval, [this]() { load(); });
+                   });
+}
+
+void OrgTreePlugin::refresh(int id) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!loaded) {
+            pendingIds.push_back(id);
+            return;
+        }
+        refreshIds.push_back(id);
+        if (refreshing) return;
+        refreshing = true;
+    }
+    // after the notifications already queued on the loop, so a burst becomes one statement
+    app().getLoop()->queueInLoop([this]() { refreshQueued(); });
+}
+
+void OrgTreePlugin::refreshQueued() {
+    std::vector<int> ids;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ids.swap(refreshIds);
+    }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    std::string idArray = "{";
+    for (auto id : ids) {
+        if (idArray.size() > 1) idArray += ',';
+        idArray += std::to_string(id);
+    }
+    idArray += '}';
+
+    // Rows arrive in any order; the tree keeps a report whose manager is not in yet and attaches
+    // them once the manager is.
+    auto finish = [this]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (refreshIds.empty()) {
+            refreshing = false;
+        } else {
+            app().getLoop()->queueInLoop([this]() { refreshQueued(); });
+        }
+    };
+    TimedQuery timed(nullptr, "person.get_managers");
+    *dbClient() << "select id, manager_id from person where id = any($1::int[])"
+                << idArray
+                >> timed.onResult([this, ids, finish](const Result &result) {
+                       std::unordered_map<int, int> managers;
+                       for (const auto &row : result) {
+                           managers.emplace(row["id"].as<int32_t>(), row["manager_id"].as<int32_t>());
+                       }
+                       for (auto id : ids) {
+                           auto it = managers.find(id);
+                           if (it == managers.end()) {
+                               personRemoved(id);
+                           } else {
+                               personAdded(id, it->second);
+                           }
+                       }
+                       finish();
+                   })
+                >> timed.onError([this, ids](const DrogonDbException &e) {
+                       LOG_ERROR << "org tree refresh of " << ids.size() << " persons failed, retrying: "
+                                 << e.base().what();
+                       {
+                           std::lock_guard<std::mutex> lock(mutex);
+                           refreshIds.insert(refreshIds.end(), ids.begin(), ids.end());
+                       }
+                       app().getLoop()->runAfter(retryInterval, [this]() { refreshQueued(); });
+                   });
+}
+
+auto OrgTreePlugin::commonManager(const std::vector<int> &ids, int &managerId) -> Lookup {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!loaded) return Lookup::Loading;
+    for (auto id : ids) {
+        if (!tree.contains(id)) return Lookup::UnknownPerson;
+    }
+    auto common = tree.commonManager(ids);
+    if (!common) return Lookup::NoCommonManager;
+    managerId = *common;
+    return Lookup::Found;
+}
+
+bool OrgTreePlugin::wouldCreateCycle(int id, int managerId) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return loaded && managerId != id && tree.isUnder(managerId, id);
+}
+
+void OrgTreePlugin::personAdded(int id, int managerId) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!loaded) {
+        pendingIds.push_back(id);
+        return;
+    }
+    if (loading) pendingIds.push_back(id);
+    // Also covers a person seen again through a notification: add() then moves them.
+    if (!tree.add(id, managerId)) {
+        LOG_DEBUG << "org tree: person " << id << " waits for manager " << managerId;
+    }
+}
+
+void OrgTreePlugin::managerChanged(int id, int managerId) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!loaded) {
+        pendingIds.push_back(id);
+        return;
+    }
+    if (loading) pendingIds.push_back(id);
+    tree.setManager(id, managerId);
+}
+
+void OrgTreePlugin::personRemoved(int id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!loaded) {
+        pendingIds.push_back(id);
+        return;
+    }
+    if (loading) pendingIds.push_back(id);
+    tree.remove(id);
+}
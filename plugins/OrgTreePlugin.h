@@ -0,0 +1,47 @@
+#pragma once
+
+#include <drogon/plugins/Plugin.h>
+#include <mutex>
+#include <vector>
+#include "../utils/OrgTree.h"
+
+// Keeps an OrgTree of all persons for GET /persons/common_manager. It is loaded from the
+// person table once the app runs, patched by PersonsController on its own writes and by
+// ChangeListenerPlugin notifications for writes made anywhere, and reloaded in full every
+// reload_interval in case a notification was missed. Notifications are batched: the
+// persons heard about while a re-read is in flight are re-read together by the next one.
+class OrgTreePlugin : public drogon::Plugin<OrgTreePlugin> {
+ public:
+    virtual void initAndStart(const Json::Value &config) override;
+    virtual void shutdown() override;
+
+    enum class Lookup { Loading, UnknownPerson, NoCommonManager, Found };
+    auto commonManager(const std::vector<int> &ids, int &managerId) -> Lookup;
+    // True when managerId is in id's organization, so making them id's manager would close a
+    // loop. O(log depth); false while the tree is loading.
+    bool wouldCreateCycle(int id, int managerId);
+
+    void personAdded(int id, int managerId);
+    void managerChanged(int id, int managerId);
+    void personRemoved(int id);
+
+ private:
+    void load();
+    // Queues id for re-reading after a change notification.
+    void refresh(int id);
+    // Re-reads the managers of every queued person in one statement.
+    void refreshQueued();
+
+    std::mutex mutex;
+    OrgTree tree;
+    bool loaded = false;
+    // Whether a full load is in flight; the first one or a periodic reload.
+    bool loading = false;
+    // Changes heard about while loading, refreshed once the new tree is in place.
+    std::vector<int> pendingIds;
+    // Changes waiting for the next refreshQueued, and whether one is scheduled or in flight.
+    std::vector<int> refreshIds;
+    bool refreshing = false;
+    double retryInterval = 5.0;
+    double reloadInterval = 300.0;
+};
@@ -0,0 +1,40 @@
+#include "PersonCachePlugin.h"
+#include <drogon/drogon.h>
+#include "ChangeListenerPlugin.h"
+
+using namespace drogon;
+
+void PersonCachePlugin::initAndStart(const Json::Value &config) {
+    LOG_DEBUG << "PersonCache initialized and Start";
+    cache = PersonCache(config.get("capacity", 10000).asUInt(), config.get("ttl", 60.0).asDouble());
+
+    auto *listenerPtr = app().getPlugin<ChangeListenerPlugin>();
+    listenerPtr->subscribe([this](const std::string &table, int id) {
+        invalidate(table, id);
+    });
+}
+
+void PersonCachePlugin::shutdown() {
+    LOG_DEBUG << "PersonCache shut down";
+}
+
+auto PersonCachePlugin::generation() -> uint64_t {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cache.generation();
+}
+
+auto PersonCachePlugin::get(int personId) -> std::shared_ptr<const CachedResponse> {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cache.get(personId);
+}
+
+void PersonCachePlugin::put(int personId, uint64_t generation, int managerId, int departmentId, int jobId,
+                            std::string body, std::string etag) {
+    std::lock_guard<std::mutex> lock(mutex);
+    cache.put(personId, generation, managerId, departmentId, jobId, std::move(body), std::move(etag));
+}
+
+void PersonCachePlugin::invalidate(const std::string &table, int id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    cache.invalidate(table, id);
+}
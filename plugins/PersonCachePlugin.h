@@ -0,0 +1,29 @@
+#pragma once
+
+#include <drogon/plugins/Plugin.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "../utils/PersonCache.h"
+
+// Serialized GET /persons/{id} responses, dropped when ChangeListenerPlugin reports a change
+// to the person, their manager, their job or their department. The ttl only bounds staleness
+// for notifications missed while the listener was reconnecting.
+class PersonCachePlugin : public drogon::Plugin<PersonCachePlugin> {
+ public:
+    virtual void initAndStart(const Json::Value &config) override;
+    virtual void shutdown() override;
+
+    // See PersonCache.
+    using CachedResponse = PersonCache::CachedResponse;
+    auto generation() -> uint64_t;
+    auto get(int personId) -> std::shared_ptr<const CachedResponse>;
+    void put(int personId, uint64_t generation, int managerId, int departmentId, int jobId,
+             std::string body, std::string etag);
+    void invalidate(const std::string &table, int id);
+
+ private:
+    std::mutex mutex;
+    PersonCache cache;
+};
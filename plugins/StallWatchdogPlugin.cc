@@ -0,0 +1,185 @@
+#include "StallWatchdogPlugin.h"
+#include <drogon/drogon.h>
+#include <execinfo.h>
+#include <pthread.h>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include "../utils/Metrics.h"
+
+using namespace drogon;
+
+struct StallWatchdogPlugin::LoopSlot {
+    static constexpr int kMaxFrames = 64;
+
+    // Steady clock microseconds of the last heartbeat; written by the loop, read by the watchdog.
+    std::atomic<int64_t> lastBeat{0};
+    int64_t reportedBeat = 0;
+    pthread_t thread{};
+    std::atomic<bool> ready{false};
+
+    // Route of the last handler dispatched since the last heartbeat.
+    std::mutex routeMutex;
+    std::string route;
+
+    // Filled by the SIGUSR2 handler on the loop thread.
+    void *frames[kMaxFrames];
+    std::atomic<int> depth{0};
+    std::atomic<bool> captured{true};
+
+    int durationSeries = 0;
+    int stalledGauge = 0;
+};
+
+namespace {
+    thread_local StallWatchdogPlugin::LoopSlot *currentSlot = nullptr;
+
+    auto steadyMicros() -> int64_t {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    void captureStack(int) {
+        auto *slot = currentSlot;
+        if (slot == nullptr || slot->captured.load()) return;
+        slot->depth = backtrace(slot->frames, StallWatchdogPlugin::LoopSlot::kMaxFrames);
+        slot->captured = true;
+    }
+}  // namespace
+
+void StallWatchdogPlugin::initAndStart(const Json::Value &config) {
+    LOG_DEBUG << "StallWatchdog initialized and Start";
+    heartbeatInterval = config.get("heartbeat_interval", 0.01).asDouble();
+    thresholdMicros = static_cast<int64_t>(config.get("stall_threshold_ms", 100.0).asDouble() * 1000);
+    captureStacks = config.get("capture_stacks", true).asBool();
+
+    if (captureStacks) {
+        // The first backtrace() loads libgcc, which must not happen inside the signal handler.
+        void *frame;
+        backtrace(&frame, 1);
+        struct sigaction action {};
+        action.sa_handler = captureStack;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGUSR2, &action, nullptr);
+    }
+
+    auto &registry = MetricsRegistry::instance();
+    registry.describe("io_loop_stall_duration_seconds",
+                      "Heartbeat gaps of IO loops longer than the stall threshold.");
+    registry.describe("io_loop_stalled_seconds", "Age of the IO loop's current stall, 0 when it is responsive.");
+
+    // Handlers run on the IO thread that dispatched them, so a blocking one holds up that loop.
+    app().registerPreHandlingAdvice([](const HttpRequestPtr &req) {
+        auto *slot = currentSlot;
+        if (slot == nullptr) return;
+        std::string_view pattern = req->matchedPathPattern();
+        std::lock_guard<std::mutex> lock(slot->routeMutex);
+        slot->route.assign(req->methodString());
+        slot->route += ' ';
+        if (pattern.empty()) {
+            slot->route += req->path();
+        } else {
+            slot->route.append(pattern.data(), pattern.size());
+        }
+    });
+    // IO loops only exist once the app is running.
+    app().registerBeginningAdvice([this]() { startHeartbeats(); });
+}
+
+void StallWatchdogPlugin::shutdown() {
+    running = false;
+    if (watchdog.joinable()) watchdog.join();
+    LOG_DEBUG << "StallWatchdog shut down";
+}
+
+void StallWatchdogPlugin::startHeartbeats() {
+    auto intervalMicros = static_cast<int64_t>(heartbeatInterval * 1e6);
+    for (size_t i = 0; i < app().getThreadNum(); ++i) {
+        auto slot = std::make_unique<LoopSlot>();
+        auto &registry = MetricsRegistry::instance();
+        slot->durationSeries =
+            registry.latencySeries("io_loop_stall_duration_seconds", metricLabel("loop", std::to_string(i)));
+        slot->stalledGauge = registry.gaugeSeries("io_loop_stalled_seconds", metricLabel("loop", std::to_string(i)));
+        slot->lastBeat = steadyMicros();
+
+        auto *loop = app().getIOLoop(i);
+        auto *raw = slot.get();
+        loop->runInLoop([raw]() {
+            currentSlot = raw;
+            raw->thread = pthread_self();
+            raw->ready = true;
+        });
+        auto threshold = thresholdMicros;
+        loop->runEvery(heartbeatInterval, [raw, intervalMicros, threshold]() {
+            auto now = steadyMicros();
+            auto gap = now - raw->lastBeat.exchange(now) - intervalMicros;
+            if (gap > threshold) MetricsRegistry::instance().record(raw->durationSeries, static_cast<uint64_t>(gap));
+            std::lock_guard<std::mutex> lock(raw->routeMutex);
+            raw->route.clear();
+        });
+        slots.push_back(std::move(slot));
+    }
+
+    running = true;
+    watchdog = std::thread([this]() { watch(); });
+}
+
+void StallWatchdogPlugin::watch() {
+    auto interval = std::chrono::microseconds(static_cast<int64_t>(heartbeatInterval * 1e6));
+    while (running) {
+        std::this_thread::sleep_for(interval);
+        auto now = steadyMicros();
+        for (size_t i = 0; i < slots.size(); ++i) {
+            auto &slot = *slots[i];
+            auto lastBeat = slot.lastBeat.load();
+            auto age = now - lastBeat;
+            bool stalled = age > thresholdMicros;
+            MetricsRegistry::instance().set(slot.stalledGauge, stalled ? age / 1e6 : 0.0);
+            // One report per stall.
+            if (stalled && slot.reportedBeat != lastBeat) {
+                slot.reportedBeat = lastBeat;
+                report(i, age);
+            }
+        }
+    }
+}
+
+void StallWatchdogPlugin::report(size_t loopIndex, int64_t stalledMicros) {
+    auto &slot = *slots[loopIndex];
+    std::string route;
+    {
+        std::lock_guard<std::mutex> lock(slot.routeMutex);
+        route = slot.route;
+    }
+
+    std::string stack;
+    if (captureStacks && slot.ready) {
+        slot.captured = false;
+        if (pthread_kill(slot.thread, SIGUSR2) == 0) {
+            for (int i = 0; i < 100 && !slot.captured; ++i) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        if (slot.captured) {
+            int depth = slot.depth;
+            char **symbols = backtrace_symbols(slot.frames, depth);
+            // Frame 0 is the signal handler and frame 1 the signal trampoline.
+            for (int i = 2; symbols != nullptr && i < depth; ++i) {
+                stack += "\n    ";
+                stack += symbols[i];
+            }
+            std::free(symbols);
+        } else {
+            slot.captured = true;
+            stack = "\n    (stack not captured)";
+        }
+    }
+
+    LOG_WARN << "IO loop " << loopIndex << " stalled for " << stalledMicros / 1000.0 << " ms, last route "
+             << (route.empty() ? "(none)" : route) << stack;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <drogon/plugins/Plugin.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Finds handlers that block IO threads. Every IO loop runs a heartbeat timer; a watchdog thread
+// checks the heartbeats and, when one is older than stall_threshold_ms, logs the route last
+// dispatched on that loop together with the loop thread's stack (captured with SIGUSR2).
+// io_loop_stall_duration_seconds{loop} counts finished stalls and sums their length, and
+// io_loop_stalled_seconds{loop} is the age of a stall still in progress (0 otherwise).
+class StallWatchdogPlugin : public drogon::Plugin<StallWatchdogPlugin> {
+ public:
+    virtual void initAndStart(const Json::Value &config) override;
+    virtual void shutdown() override;
+
+    struct LoopSlot;
+
+ private:
+    void startHeartbeats();
+    void watch();
+    void report(size_t loopIndex, int64_t stalledMicros);
+
+    double heartbeatInterval = 0.01;
+    int64_t thresholdMicros = 100000;
+    bool captureStacks = true;
+
+    std::vector<std::unique_ptr<LoopSlot>> slots;
+    std::atomic<bool> running{false};
+    std::thread watchdog;
+};
@@ -0,0 +1,48 @@
+#include "TracingPlugin.h"
+#include <drogon/drogon.h>
+#include <string>
+#include <string_view>
+#include "../utils/Tracing.h"
+
+using namespace drogon;
+
+void TracingPlugin::initAndStart(const Json::Value &config) {
+    LOG_DEBUG << "Tracing initialized and Start";
+    auto path = config.get("file", "trace.json").asString();
+    auto sampleRate = config.get("sample_rate", 0.01).asDouble();
+    if (!Tracer::instance().open(path, sampleRate)) {
+        LOG_ERROR << "tracing disabled: cannot open " << path;
+        return;
+    }
+
+    app().registerPreRoutingAdvice([](const HttpRequestPtr &req) { Tracer::instance().begin(req); });
+    app().registerPostRoutingAdvice([](const HttpRequestPtr &req) {
+        if (auto trace = Tracer::instance().find(req)) trace->routedAt = traceClockMicros();
+    });
+    // Filters run between routing and handling.
+    app().registerPreHandlingAdvice([](const HttpRequestPtr &req) {
+        auto trace = Tracer::instance().find(req);
+        if (!trace) return;
+        auto now = traceClockMicros();
+        if (auto routedAt = trace->routedAt.load()) trace->addSpan("filters", routedAt, now);
+        trace->handlingAt = now;
+    });
+    app().registerPostHandlingAdvice(&TracingPlugin::finish);
+}
+
+void TracingPlugin::shutdown() {
+    Tracer::instance().close();
+    LOG_DEBUG << "Tracing shut down, " << Tracer::instance().dropped() << " traces dropped";
+}
+
+void TracingPlugin::finish(const HttpRequestPtr &req, const HttpResponsePtr &resp) {
+    auto trace = Tracer::instance().find(req);
+    if (!trace) return;
+    if (auto handlingAt = trace->handlingAt.load()) trace->addSpan("handler", handlingAt, traceClockMicros());
+
+    std::string_view pattern = req->matchedPathPattern();
+    auto name = std::string(req->methodString()) + " " +
+                std::string(pattern.empty() ? std::string_view("unmatched") : pattern) + " " +
+                std::to_string(static_cast<int>(resp->statusCode()));
+    Tracer::instance().finish(req, name);
+}
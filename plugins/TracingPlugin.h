@@ -0,0 +1,18 @@
+#pragma once
+
+#include <drogon/plugins/Plugin.h>
+#include <drogon/HttpRequest.h>
+#include <drogon/HttpResponse.h>
+
+// Traces a sample of requests into a Chrome trace event file (see Tracer): one root span per
+// request named by method, route and status, with "filters" and "handler" spans from the
+// framework's advices, "db <statement>" spans from TimedQuery and "serialize" spans from the
+// controllers.
+class TracingPlugin : public drogon::Plugin<TracingPlugin> {
+ public:
+    virtual void initAndStart(const Json::Value &config) override;
+    virtual void shutdown() override;
+
+ private:
+    static void finish(const drogon::HttpRequestPtr &req, const drogon::HttpResponsePtr &resp);
+};
@@ -0,0 +1,794 @@
+#include "FakeDbClient.h"
+#include <drogon/orm/Exception.h>
+#include <arpa/inet.h>
+#include <endian.h>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <future>
+#include <map>
+#include <mutex>
+#include <regex>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+
+using namespace drogon::orm;
+
+using Value = std::optional<std::string>;
+using Params = std::vector<Value>;
+
+namespace {
+    struct Table {
+        std::vector<std::string> columns;
+        // Column groups that must be unique, and (column, referenced table) foreign keys on id.
+        std::vector<std::vector<std::string>> uniqueKeys;
+        std::vector<std::pair<std::string, std::string>> references;
+        std::vector<FakeRow> rows;
+        int nextId = 1;
+
+        auto indexOf(const std::string &column) const -> size_t {
+            auto it = std::find(columns.begin(), columns.end(), column);
+            if (it == columns.end()) throw std::runtime_error("column \"" + column + "\" does not exist");
+            return it - columns.begin();
+        }
+    };
+
+    bool asInteger(const Value &value, long long &out) {
+        if (!value || value->empty()) return false;
+        auto end = value->data() + value->size();
+        auto [ptr, ec] = std::from_chars(value->data(), end, out);
+        return ec == std::errc() && ptr == end;
+    }
+
+    // Integers compare as numbers and everything else as text, as the real column types would.
+    bool sameValue(const Value &a, const Value &b) {
+        if (!a || !b) return false;
+        long long x, y;
+        if (asInteger(a, x) && asInteger(b, y)) return x == y;
+        return *a == *b;
+    }
+
+    // NULLs sort last, as in PostgreSQL's ascending order.
+    bool lessValue(const Value &a, const Value &b) {
+        if (!a) return false;
+        if (!b) return true;
+        long long x, y;
+        if (asInteger(a, x) && asInteger(b, y)) return x < y;
+        return *a < *b;
+    }
+
+    class Tokens {
+     public:
+        explicit Tokens(std::string_view sql) {
+            size_t i = 0;
+            while (i < sql.size()) {
+                auto c = sql[i];
+                if (std::isspace(static_cast<unsigned char>(c)) || c == '\\') {
+                    ++i;
+                } else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+                    std::string word;
+                    while (i < sql.size() && (std::isalnum(static_cast<unsigned char>(sql[i])) || sql[i] == '_')) {
+                        word += static_cast<char>(std::tolower(static_cast<unsigned char>(sql[i++])));
+                    }
+                    tokens.push_back(std::move(word));
+                } else if (std::isdigit(static_cast<unsigned char>(c)) || c == '$') {
+                    auto start = i++;
+                    while (i < sql.size() && std::isdigit(static_cast<unsigned char>(sql[i]))) ++i;
+                    tokens.emplace_back(sql.substr(start, i - start));
+                } else if (c == ':' && i + 1 < sql.size() && sql[i + 1] == ':') {
+                    tokens.emplace_back("::");
+                    i += 2;
+                } else {
+                    tokens.emplace_back(1, c);
+                    ++i;
+                }
+            }
+        }
+
+        auto peek() const -> const std::string & {
+            static const std::string end;
+            return pos < tokens.size() ? tokens[pos] : end;
+        }
+
+        bool accept(const char *token) {
+            if (peek() != token) return false;
+            ++pos;
+            return true;
+        }
+
+        void expect(const char *token) {
+            if (!accept(token)) fail(std::string("expected \"") + token + "\"");
+        }
+
+        auto identifier() -> std::string {
+            const auto &token = peek();
+            if (token.empty() || !(std::isalpha(static_cast<unsigned char>(token[0])) || token[0] == '_')) {
+                fail("expected an identifier");
+            }
+            return tokens[pos++];
+        }
+
+        // Zero based index of a $n placeholder.
+        auto parameter(const Params &params) -> size_t {
+            const auto &token = peek();
+            if (token.size() < 2 || token[0] != '$') fail("expected a parameter");
+            auto index = std::stoul(token.substr(1)) - 1;
+            if (index >= params.size()) fail("there is no parameter " + token);
+            ++pos;
+            return index;
+        }
+
+        auto number() -> long long {
+            long long value;
+            if (!asInteger(peek(), value)) fail("expected a number");
+            ++pos;
+            return value;
+        }
+
+        void expectEnd() {
+            if (pos < tokens.size()) fail("unsupported statement");
+        }
+
+        [[noreturn]] void fail(const std::string &message) const {
+            throw std::runtime_error(message + " at \"" + peek() + "\"");
+        }
+
+     private:
+        std::vector<std::string> tokens;
+        size_t pos = 0;
+    };
+
+    auto integerParam(const Params &params, size_t index) -> long long {
+        long long value;
+        if (!asInteger(params[index], value)) throw std::runtime_error("parameter must be an integer");
+        return value;
+    }
+
+    // LIMIT and OFFSET take bigint: like PostgreSQL, refuse a binary value of another width.
+    // binaryLengths holds the byte count of each binary parameter, 0 for text ones.
+    auto bigintParam(const Params &params, const std::vector<int> &binaryLengths, size_t index) -> long long {
+        if (index < binaryLengths.size() && binaryLengths[index] != 0 && binaryLengths[index] != 8) {
+            throw std::runtime_error("incorrect binary data format in bind parameter " + std::to_string(index + 1));
+        }
+        return integerParam(params, index);
+    }
+
+    // "{1,2,3}", the text form of an int[] parameter.
+    auto arrayParam(const Params &params, size_t index) -> std::vector<Value> {
+        const auto &text = params[index];
+        if (!text || text->size() < 2 || text->front() != '{' || text->back() != '}') {
+            throw std::runtime_error("malformed array literal");
+        }
+        std::vector<Value> values;
+        size_t pos = 1;
+        while (pos < text->size() - 1) {
+            auto end = text->find(',', pos);
+            if (end == std::string::npos || end > text->size() - 1) end = text->size() - 1;
+            values.emplace_back(text->substr(pos, end - pos));
+            pos = end + 1;
+        }
+        return values;
+    }
+}  // namespace
+
+class FakeDatabase {
+ public:
+    FakeDatabase() {
+        tables["job"] = {{"id", "title", "version"}, {{"title"}}, {}, {}};
+        tables["department"] = {{"id", "name", "version"}, {{"name"}}, {}, {}};
+        tables["person"] = {{"id", "job_id", "department_id", "manager_id", "first_name", "last_name", "hire_date",
+                             "version"},
+                            {{"first_name", "last_name"}},
+                            {{"job_id", "job"}, {"department_id", "department"}, {"manager_id", "person"}},
+                            {}};
+        tables["users"] = {{"id", "username", "password"}, {{"username"}}, {}, {}};
+        tables["schema_migrations"] = {{"version", "name"}, {{"version"}}, {}, {}};
+        // One row per index, named by indexrelid rather than by oid.
+        tables["pg_index"] = {{"indexrelid", "indisvalid"}, {{"indexrelid"}}, {}, {}};
+    }
+
+    auto execute(const std::string &sql, const Params &params, const std::vector<int> &binaryLengths = {})
+        -> Result {
+        std::lock_guard<std::mutex> lock(mutex);
+        try {
+            Tokens tokens(sql);
+            if (tokens.peek() == "select") return select(tokens, params, binaryLengths);
+            if (tokens.peek() == "insert") return insert(tokens, params);
+            if (tokens.peek() == "update") return update(tokens, params);
+            if (tokens.peek() == "delete") return remove(tokens, params);
+            if (tokens.peek() == "create") return create(tokens);
+            if (tokens.peek() == "drop") return dropIndex(tokens);
+            tokens.fail("unsupported statement");
+        } catch (const DrogonDbException &) {
+            throw;
+        } catch (const std::exception &e) {
+            throw SqlError(std::string("FakeDbClient: ") + e.what(), sql);
+        }
+    }
+
+    auto nextId(const std::string &name) -> int {
+        std::lock_guard<std::mutex> lock(mutex);
+        return table(name).nextId;
+    }
+
+ private:
+    auto table(const std::string &name) -> Table & {
+        auto it = tables.find(name);
+        if (it == tables.end()) throw std::runtime_error("relation \"" + name + "\" does not exist");
+        return it->second;
+    }
+
+    // The person join that person_details holds in the real schema, computed on every read.
+    auto personDetails() -> Table {
+        Table details{{"id", "job_id", "department_id", "manager_id", "first_name", "last_name", "hire_date",
+                       "job_title", "department_name", "manager_full_name", "version"},
+                      {}, {}, {}};
+        auto byId = [](const Table &source) {
+            std::unordered_map<std::string, const FakeRow *> index;
+            for (const auto &row : source.rows) index[*row[0]] = &row;
+            return index;
+        };
+        auto jobs = byId(tables["job"]);
+        auto departments = byId(tables["department"]);
+        auto persons = byId(tables["person"]);
+        for (const auto &person : tables["person"].rows) {
+            auto job = jobs.find(*person[1]);
+            auto department = departments.find(*person[2]);
+            auto manager = persons.find(*person[3]);
+            if (job == jobs.end() || department == departments.end() || manager == persons.end()) continue;
+            details.rows.push_back({person[0], person[1], person[2], person[3], person[4], person[5], person[6],
+                                    (*job->second)[1], (*department->second)[1],
+                                    *(*manager->second)[4] + " " + *(*manager->second)[5], person[7]});
+        }
+        return details;
+    }
+
+    auto select(Tokens &tokens, const Params &params, const std::vector<int> &binaryLengths) -> Result {
+        tokens.expect("select");
+        // There is one client and no isolation to protect, so locks are granted at once.
+        if (tokens.peek().rfind("pg_advisory", 0) == 0) {
+            auto function = tokens.identifier();
+            tokens.expect("(");
+            tokens.parameter(params);
+            tokens.expect(")");
+            tokens.expectEnd();
+            return makeFakeResult({function}, {{std::string()}});
+        }
+        std::vector<std::string> projection;
+        if (!tokens.accept("*")) {
+            do {
+                projection.push_back(tokens.identifier());
+            } while (tokens.accept(","));
+        }
+        tokens.expect("from");
+        auto name = tokens.identifier();
+        Table details;
+        if (name == "person_details") details = personDetails();
+        const auto &source = name == "person_details" ? details : table(name);
+
+        std::vector<const FakeRow *> rows;
+        for (const auto &row : source.rows) rows.push_back(&row);
+        if (tokens.accept("where")) {
+            auto column = source.indexOf(tokens.identifier());
+            tokens.expect("=");
+            std::vector<Value> wanted;
+            if (tokens.accept("any")) {
+                tokens.expect("(");
+                wanted = arrayParam(params, tokens.parameter(params));
+                tokens.expect("::");
+                tokens.expect("int");
+                tokens.expect("[");
+                tokens.expect("]");
+                tokens.expect(")");
+            } else if (tokens.accept("to_regclass")) {
+                // relations are known by name here
+                tokens.expect("(");
+                wanted.push_back(params[tokens.parameter(params)]);
+                tokens.expect(")");
+            } else {
+                wanted.push_back(params[tokens.parameter(params)]);
+            }
+            rows.erase(std::remove_if(rows.begin(), rows.end(),
+                                      [&](const FakeRow *row) {
+                                          return std::none_of(wanted.begin(), wanted.end(), [&](const Value &value) {
+                                              return sameValue((*row)[column], value);
+                                          });
+                                      }),
+                       rows.end());
+        }
+        if (tokens.accept("order")) {
+            tokens.expect("by");
+            auto column = source.indexOf(tokens.identifier());
+            bool descending = tokens.accept("desc");
+            if (!descending) tokens.accept("asc");
+            std::stable_sort(rows.begin(), rows.end(), [&](const FakeRow *a, const FakeRow *b) {
+                return descending ? lessValue((*b)[column], (*a)[column]) : lessValue((*a)[column], (*b)[column]);
+            });
+        }
+        auto limit = static_cast<long long>(rows.size());
+        long long offset = 0;
+        if (tokens.accept("limit")) limit = bigintParam(params, binaryLengths, tokens.parameter(params));
+        if (tokens.accept("offset")) offset = bigintParam(params, binaryLengths, tokens.parameter(params));
+        tokens.expectEnd();
+
+        std::vector<size_t> columns;
+        if (projection.empty()) {
+            projection = source.columns;
+            for (size_t i = 0; i < source.columns.size(); ++i) columns.push_back(i);
+        } else {
+            for (const auto &column : projection) columns.push_back(source.indexOf(column));
+        }
+        std::vector<FakeRow> out;
+        for (auto i = std::max(offset, 0LL); i < static_cast<long long>(rows.size()) && limit-- > 0; ++i) {
+            FakeRow row;
+            for (auto column : columns) row.push_back((*rows[i])[column]);
+            out.push_back(std::move(row));
+        }
+        return makeFakeResult(std::move(projection), std::move(out));
+    }
+
+    auto insert(Tokens &tokens, const Params &params) -> Result {
+        tokens.expect("insert");
+        tokens.expect("into");
+        auto name = tokens.identifier();
+        auto &target = table(name);
+        std::vector<size_t> columns;
+        tokens.expect("(");
+        do {
+            columns.push_back(target.indexOf(tokens.identifier()));
+        } while (tokens.accept(","));
+        tokens.expect(")");
+        tokens.expect("values");
+        tokens.expect("(");
+        std::vector<size_t> values;
+        do {
+            values.push_back(tokens.parameter(params));
+        } while (tokens.accept(","));
+        tokens.expect(")");
+        bool returning = tokens.accept("returning");
+        if (returning) tokens.expect("*");
+        tokens.expectEnd();
+        if (columns.size() != values.size()) throw std::runtime_error("INSERT has a different number of columns and values");
+
+        FakeRow row(target.columns.size());
+        for (size_t i = 0; i < columns.size(); ++i) row[columns[i]] = params[values[i]];
+        long long id;
+        if (target.columns[0] == "indexrelid") {
+            // named, not numbered
+        } else if (asInteger(row[0], id)) {
+            target.nextId = std::max(target.nextId, static_cast<int>(id) + 1);
+        } else {
+            row[0] = std::to_string(target.nextId++);
+        }
+        auto version = std::find(target.columns.begin(), target.columns.end(), "version");
+        if (version != target.columns.end() && !row[version - target.columns.begin()]) {
+            row[version - target.columns.begin()] = "1";
+        }
+        check(name, target, row, target.rows.size());
+        target.rows.push_back(row);
+        if (!returning) return makeFakeResult(target.columns, {}, 1);
+        return makeFakeResult(target.columns, {row});
+    }
+
+    auto update(Tokens &tokens, const Params &params) -> Result {
+        enum class Kind { Set, Coalesce, Increment };
+        struct Assignment {
+            size_t column;
+            Kind kind;
+            size_t parameter;
+            long long increment;
+        };
+
+        tokens.expect("update");
+        auto name = tokens.identifier();
+        auto &target = table(name);
+        tokens.expect("set");
+        std::vector<Assignment> assignments;
+        do {
+            auto column = tokens.identifier();
+            Assignment assignment{target.indexOf(column), Kind::Set, 0, 0};
+            tokens.expect("=");
+            if (tokens.accept("coalesce")) {
+                tokens.expect("(");
+                assignment.kind = Kind::Coalesce;
+                assignment.parameter = tokens.parameter(params);
+                tokens.expect(",");
+                if (tokens.identifier() != column) tokens.fail("coalesce must fall back to the column itself");
+                tokens.expect(")");
+            } else if (tokens.peek().size() > 1 && tokens.peek()[0] == '$') {
+                assignment.parameter = tokens.parameter(params);
+            } else {
+                if (tokens.identifier() != column) tokens.fail("only column + n is supported");
+                tokens.expect("+");
+                assignment.kind = Kind::Increment;
+                assignment.increment = tokens.number();
+            }
+            assignments.push_back(assignment);
+        } while (tokens.accept(","));
+
+        tokens.expect("where");
+        auto whereColumn = target.indexOf(tokens.identifier());
+        tokens.expect("=");
+        auto whereValue = params[tokens.parameter(params)];
+        std::optional<size_t> expectedVersion;
+        if (tokens.accept("and")) {
+            tokens.expect("(");
+            expectedVersion = tokens.parameter(params);
+            tokens.expect("::");
+            tokens.expect("int");
+            tokens.expect("is");
+            tokens.expect("null");
+            tokens.expect("or");
+            if (tokens.identifier() != "version") tokens.fail("expected the version guard");
+            tokens.expect("=");
+            tokens.parameter(params);
+            tokens.expect(")");
+        }
+        bool returning = tokens.accept("returning");
+        if (returning) tokens.expect("*");
+        tokens.expectEnd();
+
+        std::vector<FakeRow> updated;
+        for (size_t i = 0; i < target.rows.size(); ++i) {
+            auto &row = target.rows[i];
+            if (!sameValue(row[whereColumn], whereValue)) continue;
+            if (expectedVersion && params[*expectedVersion] &&
+                !sameValue(row[target.indexOf("version")], params[*expectedVersion])) {
+                continue;
+            }
+            auto changed = row;
+            for (const auto &assignment : assignments) {
+                auto &cell = changed[assignment.column];
+                if (assignment.kind == Kind::Increment) {
+                    long long value;
+                    if (!asInteger(cell, value)) throw std::runtime_error("cannot add to a non integer column");
+                    cell = std::to_string(value + assignment.increment);
+                } else if (assignment.kind == Kind::Set || params[assignment.parameter]) {
+                    cell = params[assignment.parameter];
+                }
+            }
+            check(name, target, changed, i);
+            row = std::move(changed);
+            updated.push_back(row);
+        }
+        auto affected = updated.size();
+        if (!returning) updated.clear();
+        return makeFakeResult(target.columns, std::move(updated), affected);
+    }
+
+    auto remove(Tokens &tokens, const Params &params) -> Result {
+        tokens.expect("delete");
+        tokens.expect("from");
+        auto name = tokens.identifier();
+        auto &target = table(name);
+        tokens.expect("where");
+        auto column = target.indexOf(tokens.identifier());
+        tokens.expect("=");
+        auto value = params[tokens.parameter(params)];
+        tokens.expectEnd();
+
+        std::vector<size_t> doomed;
+        for (size_t i = 0; i < target.rows.size(); ++i) {
+            if (sameValue(target.rows[i][column], value)) doomed.push_back(i);
+        }
+        // The foreign keys are ON DELETE SET NULL on NOT NULL columns, so a referenced row cannot go.
+        for (auto i : doomed) {
+            const auto &id = target.rows[i][0];
+            for (const auto &[otherName, other] : tables) {
+                for (const auto &[referencing, referenced] : other.references) {
+                    if (referenced != name) continue;
+                    auto index = other.indexOf(referencing);
+                    for (const auto &row : other.rows) {
+                        if (sameValue(row[index], id) && !(otherName == name && sameValue(row[0], id))) {
+                            throw std::runtime_error("null value in column \"" + referencing +
+                                                     "\" violates not-null constraint");
+                        }
+                    }
+                }
+            }
+        }
+        for (auto it = doomed.rbegin(); it != doomed.rend(); ++it) target.rows.erase(target.rows.begin() + *it);
+        return makeFakeResult(target.columns, {}, doomed.size());
+    }
+
+    auto create(Tokens &tokens) -> Result {
+        tokens.expect("create");
+        if (!tokens.accept("index")) {
+            tokens.expect("table");
+            tokens.expect("if");
+            tokens.expect("not");
+            tokens.expect("exists");
+            table(tokens.identifier());
+            return makeFakeResult({}, {}, 0);
+        }
+        tokens.expect("concurrently");
+        tokens.expect("if");
+        tokens.expect("not");
+        tokens.expect("exists");
+        auto name = tokens.identifier();
+        tokens.expect("on");
+        auto &target = table(tokens.identifier());
+        tokens.expect("(");
+        do {
+            target.indexOf(tokens.identifier());
+        } while (tokens.accept(","));
+        tokens.expect(")");
+        tokens.expectEnd();
+        // like PostgreSQL, an index of that name is kept even when it is invalid
+        auto &indexes = table("pg_index");
+        for (const auto &row : indexes.rows) {
+            if (*row[0] == name) return makeFakeResult({}, {}, 0);
+        }
+        indexes.rows.push_back({name, std::string("t")});
+        return makeFakeResult({}, {}, 0);
+    }
+
+    auto dropIndex(Tokens &tokens) -> Result {
+        tokens.expect("drop");
+        tokens.expect("index");
+        tokens.expect("concurrently");
+        tokens.expect("if");
+        tokens.expect("exists");
+        auto name = tokens.identifier();
+        tokens.expectEnd();
+        auto &rows = table("pg_index").rows;
+        rows.erase(std::remove_if(rows.begin(), rows.end(), [&name](const FakeRow &row) { return *row[0] == name; }),
+                   rows.end());
+        return makeFakeResult({}, {}, 0);
+    }
+
+    // Not null, unique and foreign key checks for row, which is (or is about to be) target.rows[self].
+    void check(const std::string &name, const Table &target, const FakeRow &row, size_t self) {
+        for (size_t i = 0; i < row.size(); ++i) {
+            if (!row[i]) throw std::runtime_error("null value in column \"" + target.columns[i] + "\" violates not-null constraint");
+        }
+        for (const auto &key : target.uniqueKeys) {
+            for (size_t i = 0; i < target.rows.size(); ++i) {
+                if (i == self) continue;
+                bool same = std::all_of(key.begin(), key.end(), [&](const std::string &column) {
+                    auto index = target.indexOf(column);
+                    return sameValue(target.rows[i][index], row[index]);
+                });
+                if (same) throw std::runtime_error("duplicate key value violates unique constraint on " + name);
+            }
+        }
+        for (const auto &[column, referenced] : target.references) {
+            const auto &value = row[target.indexOf(column)];
+            if (referenced == name && sameValue(value, row[0])) continue;
+            const auto &rows = tables[referenced].rows;
+            if (std::none_of(rows.begin(), rows.end(), [&](const FakeRow &other) { return sameValue(other[0], value); })) {
+                throw std::runtime_error("insert or update on table \"" + name +
+                                         "\" violates foreign key constraint on " + column);
+            }
+        }
+    }
+
+    std::mutex mutex;
+    std::map<std::string, Table> tables;
+};
+
+// Statements go to the client that opened the transaction, except for cursors, which live here:
+// declare runs the query at once and fetch hands out its rows a batch at a time.
+class FakeTransaction : public Transaction, public std::enable_shared_from_this<FakeTransaction> {
+ public:
+    explicit FakeTransaction(FakeDbClient &client) : client{client} {
+        type_ = ClientType::PostgreSQL;
+        connectionInfo_ = "fake";
+    }
+
+    ~FakeTransaction() override {
+        if (commitCallback) commitCallback(!rolledBack);
+        client.endTransaction();
+    }
+
+    void rollback() override { rolledBack = true; }
+    void setCommitCallback(const std::function<void(bool)> &callback) override { commitCallback = callback; }
+
+    std::shared_ptr<Transaction> newTransaction(const std::function<void(bool)> &) noexcept(false) override {
+        throw SqlError("FakeDbClient: nested transactions are not supported");
+    }
+    void newTransactionAsync(const std::function<void(const std::shared_ptr<Transaction> &)> &) override {
+        throw SqlError("FakeDbClient: nested transactions are not supported");
+    }
+    bool hasAvailableConnections() const noexcept override { return true; }
+    void setTimeout(double) override {}
+
+ private:
+    struct Cursor {
+        std::vector<std::string> columns;
+        std::vector<FakeRow> rows;
+        size_t next = 0;
+    };
+
+    void execSql(const char *sql, size_t sqlLength, size_t paraNum, std::vector<const char *> &&parameters,
+                 std::vector<int> &&length, std::vector<int> &&format, ResultCallback &&rcb,
+                 std::function<void(const std::exception_ptr &)> &&exceptCallback) override {
+        static const std::regex declare(R"(\s*declare\s+(\w+)\s+(?:no\s+scroll\s+)?cursor\s+for\s+([\s\S]*))",
+                                        std::regex::icase);
+        static const std::regex fetch(R"(\s*fetch\s+(\d+)\s+from\s+(\w+)\s*)", std::regex::icase);
+        std::string statement(sql, sqlLength);
+        std::smatch match;
+        auto self = shared_from_this();
+        if (std::regex_match(statement, match, declare)) {
+            client.deliver(
+                [self, name = match[1].str(), query = match[2].str()]() {
+                    auto result = self->client.query(query);
+                    Cursor cursor;
+                    for (Result::RowSizeType i = 0; i < result.columns(); ++i) {
+                        cursor.columns.emplace_back(result.columnName(i));
+                    }
+                    for (const auto &row : result) {
+                        FakeRow values;
+                        for (const auto &field : row) {
+                            values.push_back(field.isNull() ? std::nullopt
+                                                            : std::optional<std::string>(field.as<std::string>()));
+                        }
+                        cursor.rows.push_back(std::move(values));
+                    }
+                    self->cursors[name] = std::move(cursor);
+                    return makeFakeResult({}, {}, 0);
+                },
+                std::move(rcb), std::move(exceptCallback));
+        } else if (std::regex_match(statement, match, fetch)) {
+            client.deliver(
+                [self, count = std::stoul(match[1].str()), name = match[2].str(), statement]() {
+                    auto it = self->cursors.find(name);
+                    if (it == self->cursors.end()) {
+                        throw SqlError("FakeDbClient: cursor \"" + name + "\" does not exist", statement);
+                    }
+                    auto &cursor = it->second;
+                    auto end = std::min(cursor.rows.size(), cursor.next + count);
+                    std::vector<FakeRow> batch(cursor.rows.begin() + cursor.next, cursor.rows.begin() + end);
+                    cursor.next = end;
+                    return makeFakeResult(cursor.columns, std::move(batch));
+                },
+                std::move(rcb), std::move(exceptCallback));
+        } else {
+            client.execSql(sql, sqlLength, paraNum, std::move(parameters), std::move(length), std::move(format),
+                           std::move(rcb), std::move(exceptCallback));
+        }
+    }
+
+    FakeDbClient &client;
+    std::function<void(bool)> commitCallback;
+    bool rolledBack = false;
+    // Only touched by statements, which run one at a time on the client's loop.
+    std::unordered_map<std::string, Cursor> cursors;
+};
+
+FakeDbClient::FakeDbClient(std::chrono::microseconds latency)
+    : database{std::make_unique<FakeDatabase>()}, latencyMicros{latency.count()} {
+    type_ = ClientType::PostgreSQL;
+    connectionInfo_ = "fake";
+    loopThread.run();
+}
+
+FakeDbClient::~FakeDbClient() = default;
+
+auto FakeDbClient::addJob(const std::string &title) -> int {
+    return query("insert into job (title) values ($1) returning *", {title})[0]["id"].as<int>();
+}
+
+auto FakeDbClient::addDepartment(const std::string &name) -> int {
+    return query("insert into department (name) values ($1) returning *", {name})[0]["id"].as<int>();
+}
+
+auto FakeDbClient::addPerson(const std::string &firstName, const std::string &lastName, const std::string &hireDate,
+                             int departmentId, int jobId, int managerId) -> int {
+    auto id = database->nextId("person");
+    return query("insert into person (id, job_id, department_id, manager_id, first_name, last_name, hire_date) "
+                 "values ($1, $2, $3, $4, $5, $6, $7) returning *",
+                 {std::to_string(id), std::to_string(jobId), std::to_string(departmentId),
+                  std::to_string(managerId == 0 ? id : managerId), firstName, lastName, hireDate})[0]["id"]
+        .as<int>();
+}
+
+auto FakeDbClient::query(const std::string &sql, const std::vector<std::optional<std::string>> &params) -> Result {
+    return database->execute(sql, params);
+}
+
+void FakeDbClient::setConnections(size_t count) {
+    std::lock_guard<std::mutex> lock(transactionMutex);
+    connections = count;
+}
+
+// Must not be called on the client's loop, which is where the transaction is handed over.
+std::shared_ptr<Transaction> FakeDbClient::newTransaction(const std::function<void(bool)> &commitCallback) noexcept(false) {
+    std::promise<std::shared_ptr<Transaction>> opened;
+    newTransactionAsync([&opened](const std::shared_ptr<Transaction> &trans) { opened.set_value(trans); });
+    auto trans = opened.get_future().get();
+    if (commitCallback) trans->setCommitCallback(commitCallback);
+    return trans;
+}
+
+void FakeDbClient::newTransactionAsync(const std::function<void(const std::shared_ptr<Transaction> &)> &callback) {
+    {
+        std::lock_guard<std::mutex> lock(transactionMutex);
+        if (connections > 0 && openTransactions >= connections) {
+            waitingTransactions.push_back(callback);
+            return;
+        }
+        ++openTransactions;
+    }
+    loopThread.getLoop()->queueInLoop([this, callback]() { callback(std::make_shared<FakeTransaction>(*this)); });
+}
+
+// The connection of an ended transaction goes to the longest waiting one.
+void FakeDbClient::endTransaction() {
+    std::function<void(const std::shared_ptr<Transaction> &)> next;
+    {
+        std::lock_guard<std::mutex> lock(transactionMutex);
+        if (waitingTransactions.empty()) {
+            --openTransactions;
+            return;
+        }
+        next = std::move(waitingTransactions.front());
+        waitingTransactions.pop_front();
+    }
+    loopThread.getLoop()->queueInLoop([this, next]() { next(std::make_shared<FakeTransaction>(*this)); });
+}
+
+void FakeDbClient::execSql(const char *sql, size_t sqlLength, size_t paraNum, std::vector<const char *> &&parameters,
+                           std::vector<int> &&length, std::vector<int> &&format, ResultCallback &&rcb,
+                           std::function<void(const std::exception_ptr &)> &&exceptCallback) {
+    ++statements;
+    // SqlBinder sends strings as text and integers in network byte order.
+    Params params;
+    std::vector<int> binaryLengths(paraNum, 0);
+    std::string error;
+    for (size_t i = 0; i < paraNum; ++i) {
+        const auto *value = parameters[i];
+        if (value != nullptr && format[i] != 0) binaryLengths[i] = length[i];
+        if (value == nullptr) {
+            params.emplace_back();
+        } else if (format[i] == 0) {
+            params.emplace_back(std::string(value, std::strlen(value)));
+        } else if (length[i] == 1) {
+            params.emplace_back(std::to_string(static_cast<int>(*value)));
+        } else if (length[i] == 2) {
+            uint16_t raw;
+            std::memcpy(&raw, value, sizeof(raw));
+            params.emplace_back(std::to_string(static_cast<int16_t>(ntohs(raw))));
+        } else if (length[i] == 4) {
+            uint32_t raw;
+            std::memcpy(&raw, value, sizeof(raw));
+            params.emplace_back(std::to_string(static_cast<int32_t>(ntohl(raw))));
+        } else if (length[i] == 8) {
+            uint64_t raw;
+            std::memcpy(&raw, value, sizeof(raw));
+            params.emplace_back(std::to_string(static_cast<int64_t>(be64toh(raw))));
+        } else {
+            error = "unsupported binary parameter of " + std::to_string(length[i]) + " bytes";
+        }
+    }
+
+    deliver(
+        [this, statement = std::string(sql, sqlLength), params = std::move(params),
+         binaryLengths = std::move(binaryLengths), error]() {
+            if (!error.empty()) throw SqlError("FakeDbClient: " + error, statement);
+            return database->execute(statement, params, binaryLengths);
+        },
+        std::move(rcb), std::move(exceptCallback));
+}
+
+void FakeDbClient::deliver(std::function<Result()> work, ResultCallback &&rcb,
+                           std::function<void(const std::exception_ptr &)> &&exceptCallback) {
+    auto run = [work = std::move(work), rcb = std::move(rcb), exceptCallback = std::move(exceptCallback)]() {
+        std::optional<Result> result;
+        try {
+            result = work();
+        } catch (...) {
+            exceptCallback(std::current_exception());
+            return;
+        }
+        rcb(*result);
+    };
+    auto latency = latencyMicros.load();
+    if (latency > 0) {
+        loopThread.getLoop()->runAfter(std::chrono::microseconds(latency), std::move(run));
+    } else {
+        loopThread.getLoop()->queueInLoop(std::move(run));
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <drogon/orm/DbClient.h>
+#include <trantor/net/EventLoopThread.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+#include "FakeResult.h"
+
+class FakeDatabase;
+class FakeTransaction;
+
+// In-memory stand-in for the PostgreSQL client, holding the job, department, person, users and
+// person_details tables (the latter computed from the person join on every read). It answers
+// the statement shapes the controllers and drogon's Mapper send:
+//
+//   select * | col, ... from t [where col = $n | where col = any($n::int[])]
+//       [order by col [asc|desc]] [limit $n] [offset $n]
+//   insert into t (col, ...) values ($n, ...) [returning *]
+//   update t set col = coalesce($n, col) | col = $n | col = col + 1, ...
+//       where id = $n [and ($n::int is null or version = $n)] [returning *]
+//   delete from t where col = $n
+//   select pg_advisory_lock($n) | pg_advisory_unlock($n) | pg_advisory_xact_lock($n)
+//   create table if not exists t (...)      -- a no-op; the tables above are fixed
+//   create index concurrently if not exists name on t (col, ...)
+//   drop index concurrently if exists name
+//
+// plus schema_migrations for the Migrator, and pg_index (indexrelid, indisvalid) holding the
+// index names, which select ... where indexrelid = to_regclass($n) finds. Transactions run their statements straight away
+// (there is no isolation, and rollback undoes nothing) and add
+//
+//   declare name [no scroll] cursor for <select above>
+//   fetch n from name
+//
+// Not null, unique and foreign key constraints of scripts/create_db.sql are checked, and so is
+// the bigint type of LIMIT and OFFSET parameters (a 4-byte binary int is refused, as
+// PostgreSQL does); anything else fails with a SqlError. Results are delivered on the client's own loop after the
+// configured latency, like the real client's, so blocking Mapper futures called from an IO
+// thread behave the same way.
+class FakeDbClient : public drogon::orm::DbClient {
+ public:
+    explicit FakeDbClient(std::chrono::microseconds latency = std::chrono::microseconds{0});
+    ~FakeDbClient() override;
+
+    void setLatency(std::chrono::microseconds latency) { latencyMicros = latency.count(); }
+    // How many transactions may be open at once, like the connections of a real pool; further
+    // ones wait for an open one to end. 0, the default, means no limit.
+    void setConnections(size_t count);
+    auto statementCount() const -> size_t { return statements.load(); }
+
+    // Seeding; each returns the new row's id. A manager id of 0 makes the person their own manager.
+    auto addJob(const std::string &title) -> int;
+    auto addDepartment(const std::string &name) -> int;
+    auto addPerson(const std::string &firstName, const std::string &lastName, const std::string &hireDate,
+                   int departmentId, int jobId, int managerId = 0) -> int;
+
+    // Runs one statement synchronously; params are in text format, std::nullopt is NULL.
+    auto query(const std::string &sql, const std::vector<std::optional<std::string>> &params = {})
+        -> drogon::orm::Result;
+
+    std::shared_ptr<drogon::orm::Transaction> newTransaction(const std::function<void(bool)> &commitCallback =
+                                                                 std::function<void(bool)>()) noexcept(false) override;
+    void newTransactionAsync(const std::function<void(const std::shared_ptr<drogon::orm::Transaction> &)> &callback)
+        override;
+    bool hasAvailableConnections() const noexcept override { return true; }
+    void setTimeout(double) override {}
+    void closeAll() override {}
+
+ private:
+    friend class FakeTransaction;
+
+    void execSql(const char *sql, size_t sqlLength, size_t paraNum, std::vector<const char *> &&parameters,
+                 std::vector<int> &&length, std::vector<int> &&format, drogon::orm::ResultCallback &&rcb,
+                 std::function<void(const std::exception_ptr &)> &&exceptCallback) override;
+    // Runs work on the client's loop after the configured latency and hands its result or
+    // exception to the callbacks.
+    void deliver(std::function<drogon::orm::Result()> work, drogon::orm::ResultCallback &&rcb,
+                 std::function<void(const std::exception_ptr &)> &&exceptCallback);
+    void endTransaction();
+
+    std::unique_ptr<FakeDatabase> database;
+    trantor::EventLoopThread loopThread{"FakeDbClient"};
+    std::atomic<int64_t> latencyMicros;
+    std::atomic<size_t> statements{0};
+
+    std::mutex transactionMutex;
+    size_t connections = 0;
+    size_t openTransactions = 0;
+    std::deque<std::function<void(const std::shared_ptr<drogon::orm::Transaction> &)>> waitingTransactions;
+};
@@ -0,0 +1,54 @@
+#include "FakeResult.h"
+#include <drogon/orm/Exception.h>
+#include <algorithm>
+#include <memory>
+// Not installed by drogon; found through third_party/drogon/orm_lib/src, see test/CMakeLists.txt.
+#include "ResultImpl.h"
+
+using namespace drogon::orm;
+
+namespace {
+    class FakeResultImpl : public ResultImpl {
+     public:
+        FakeResultImpl(std::vector<std::string> columns, std::vector<FakeRow> rows, unsigned long long affected)
+            : columnNames{std::move(columns)}, values{std::move(rows)}, affected{affected} {}
+
+        SizeType size() const noexcept override { return values.size(); }
+        RowSizeType columns() const noexcept override { return static_cast<RowSizeType>(columnNames.size()); }
+        const char *columnName(RowSizeType number) const override { return columnNames.at(number).c_str(); }
+        SizeType affectedRows() const noexcept override { return affected; }
+
+        RowSizeType columnNumber(const char colName[]) const override {
+            auto it = std::find(columnNames.begin(), columnNames.end(), colName);
+            if (it == columnNames.end()) throw RangeError(std::string("there is no column named ") + colName);
+            return static_cast<RowSizeType>(it - columnNames.begin());
+        }
+
+        const char *getValue(SizeType row, RowSizeType column) const override {
+            const auto &value = values.at(row).at(column);
+            return value ? value->c_str() : nullptr;
+        }
+
+        bool isNull(SizeType row, RowSizeType column) const override { return !values.at(row).at(column); }
+
+        FieldSizeType getLength(SizeType row, RowSizeType column) const override {
+            const auto &value = values.at(row).at(column);
+            return value ? static_cast<FieldSizeType>(value->size()) : 0;
+        }
+
+     private:
+        std::vector<std::string> columnNames;
+        std::vector<FakeRow> values;
+        unsigned long long affected;
+    };
+}  // namespace
+
+auto makeFakeResult(std::vector<std::string> columns, std::vector<FakeRow> rows) -> Result {
+    auto affected = rows.size();
+    return makeFakeResult(std::move(columns), std::move(rows), affected);
+}
+
+auto makeFakeResult(std::vector<std::string> columns, std::vector<FakeRow> rows, unsigned long long affectedRows)
+    -> Result {
+    return Result(std::make_shared<FakeResultImpl>(std::move(columns), std::move(rows), affectedRows));
+}
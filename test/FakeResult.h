@@ -0,0 +1,16 @@
+#pragma once
+
+#include <drogon/orm/Result.h>
+#include <optional>
+#include <string>
+#include <vector>
+
+// A row of an in-memory result; values are in PostgreSQL's text format (what libpq hands to
+// drogon), std::nullopt is NULL.
+using FakeRow = std::vector<std::optional<std::string>>;
+
+// Builds a drogon Result without a database, for tests and benchmarks of code that reads rows.
+// Columns are looked up by exact name like PQfnumber does for lower case names.
+auto makeFakeResult(std::vector<std::string> columns, std::vector<FakeRow> rows) -> drogon::orm::Result;
+auto makeFakeResult(std::vector<std::string> columns, std::vector<FakeRow> rows, unsigned long long affectedRows)
+    -> drogon::orm::Result;
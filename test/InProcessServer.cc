@@ -0,0 +1,34 @@
+#include "InProcessServer.h"
+#include <drogon/drogon.h>
+#include "utils/utils.h"
+
+namespace {
+    std::shared_ptr<FakeDbClient> fakeDb;
+}  // namespace
+
+void configureInProcessServer(double orgTreeReloadInterval) {
+    fakeDb = std::make_shared<FakeDbClient>();
+    // as many transactions as the real export pool has connections
+    fakeDb->setConnections(2);
+    setDbClient(fakeDb);
+    setExportDbClient(fakeDb);
+
+    Json::Value config;
+    config["listeners"][0]["address"] = "127.0.0.1";
+    config["listeners"][0]["port"] = 3901;
+    config["plugins"][0]["name"] = "JwtPlugin";
+    config["plugins"][0]["config"]["secret"] = "in-process-secret";
+    // X-Alloc-Count on every response in allocation tracking builds
+    config["plugins"][1]["name"] = "AllocTrackingPlugin";
+    // loads from "select id, manager_id from person" and answers the PUT cycle check; without
+    // ChangeListenerPlugin it only hears about writes made through the API
+    config["plugins"][2]["name"] = "OrgTreePlugin";
+    config["plugins"][2]["config"]["reload_interval"] = orgTreeReloadInterval;
+    config["app"]["log"]["log_level"] = "WARN";
+    drogon::app().loadConfigJson(config);
+    drogon::app().setExceptionHandler(respondToException);
+}
+
+auto inProcessDb() -> FakeDbClient & {
+    return *fakeDb;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <memory>
+#include "FakeDbClient.h"
+
+// The app of a test or benchmark binary serving the real controllers, filters and plugins on
+// kInProcessUrl, with FakeDbClient in place of PostgreSQL.
+constexpr const char *kInProcessUrl = "http://127.0.0.1:3901";
+
+// Call before app().run(): listener, plugins, exception handler and database clients.
+// OrgTreePlugin reloads the person table every orgTreeReloadInterval seconds; 0 turns that off.
+void configureInProcessServer(double orgTreeReloadInterval = 0);
+auto inProcessDb() -> FakeDbClient &;
@@ -0,0 +1,50 @@
+#include "PgTestServer.h"
+#include <drogon/drogon.h>
+#include <fstream>
+#include <stdexcept>
+#include "migrations/Migrator.h"
+#include "utils/utils.h"
+
+using namespace drogon::orm;
+
+namespace {
+    DbClientPtr pgDb;
+
+    // The scripts hold plain statements separated by semicolons, without functions or quoted ';'.
+    void runScript(const DbClientPtr &dbClientPtr, const std::string &name) {
+        std::ifstream file(std::string(ORG_CHART_SCRIPTS_DIR) + "/" + name);
+        if (!file) throw std::runtime_error("cannot read scripts/" + name);
+        std::string statement;
+        while (std::getline(file, statement, ';')) {
+            if (statement.find_first_not_of(" \t\r\n") != std::string::npos) dbClientPtr->execSqlSync(statement);
+        }
+    }
+}  // namespace
+
+void configurePgTestServer(const std::string &connInfo) {
+    // one connection, as Migrator needs
+    auto setupDb = DbClient::newPgClient(connInfo, 1);
+    setupDb->execSqlSync("drop schema public cascade");
+    setupDb->execSqlSync("create schema public");
+    runScript(setupDb, "create_db.sql");
+    runScript(setupDb, "seed_db.sql");
+    Migrator(setupDb).apply();
+
+    // enough connections for a test to hold a transaction open while others run
+    pgDb = DbClient::newPgClient(connInfo, 4);
+    setDbClient(pgDb);
+    setExportDbClient(pgDb);
+
+    Json::Value config;
+    config["listeners"][0]["address"] = "127.0.0.1";
+    config["listeners"][0]["port"] = 3902;
+    config["plugins"][0]["name"] = "JwtPlugin";
+    config["plugins"][0]["config"]["secret"] = "pg-test-secret";
+    config["app"]["log"]["log_level"] = "WARN";
+    drogon::app().loadConfigJson(config);
+    drogon::app().setExceptionHandler(respondToException);
+}
+
+auto pgTestDb() -> DbClientPtr {
+    return pgDb;
+}
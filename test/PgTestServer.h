@@ -0,0 +1,15 @@
+#pragma once
+
+#include <drogon/orm/DbClient.h>
+#include <string>
+
+// The app of the PostgreSQL test binary: the real controllers, filters and plugins on
+// kPgTestUrl against the scratch database named by ORG_CHART_TEST_DB. That database's public
+// schema is dropped and rebuilt from scripts/create_db.sql, scripts/seed_db.sql and the
+// migrations on every run, so never point it at data you want to keep.
+constexpr const char *kPgTestUrl = "http://127.0.0.1:3902";
+
+// Call before app().run(): schema, listener, JwtPlugin, exception handler and database clients.
+// Throws drogon::orm::DrogonDbException when the database cannot be prepared.
+void configurePgTestServer(const std::string &connInfo);
+auto pgTestDb() -> drogon::orm::DbClientPtr;
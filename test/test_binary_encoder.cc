@@ -0,0 +1,50 @@
+#include <drogon/drogon_test.h>
+#include <string>
+#include "utils/BinaryEncoder.h"
+
+DROGON_TEST(MsgPackEncoding)
+{
+    BinaryEncoder encoder(ResponseFormat::MsgPack);
+    encoder.beginMap(2);
+    encoder.add("id");
+    encoder.add(int64_t{300});
+    encoder.add("name");
+    encoder.addNull();
+    auto out = encoder.take();
+
+    // {"id": 300, "name": nil}
+    const std::string expected{"\x82\xa2id\xcd\x01\x2c\xa4name\xc0", 13};
+    CHECK(out == expected);
+}
+
+DROGON_TEST(CborEncoding)
+{
+    BinaryEncoder encoder(ResponseFormat::Cbor);
+    encoder.beginArray(3);
+    encoder.add(int64_t{23});
+    encoder.add(int64_t{-500});
+    encoder.add("Product");
+    auto out = encoder.take();
+
+    // [23, -500, "Product"]
+    const std::string expected{"\x83\x17\x39\x01\xf3\x67Product", 13};
+    CHECK(out == expected);
+}
+
+DROGON_TEST(FormatNegotiationHonorsQualityValues)
+{
+    CHECK(negotiateFormat("") == ResponseFormat::Json);
+    CHECK(negotiateFormat("*/*") == ResponseFormat::Json);
+    CHECK(negotiateFormat("application/msgpack") == ResponseFormat::MsgPack);
+    CHECK(negotiateFormat("application/x-msgpack") == ResponseFormat::MsgPack);
+    CHECK(negotiateFormat("Application/CBOR") == ResponseFormat::Cbor);
+    CHECK(negotiateFormat("application/cbor, application/msgpack") == ResponseFormat::Cbor);
+    CHECK(negotiateFormat("application/msgpack;q=0, application/json") == ResponseFormat::Json);
+    CHECK(negotiateFormat("application/msgpack;q=0") == ResponseFormat::Json);
+    CHECK(negotiateFormat("application/json;q=0.5, application/cbor;q=0.9") == ResponseFormat::Cbor);
+    CHECK(negotiateFormat("application/msgpack; charset=x; q=0.2, */*;q=0.1") == ResponseFormat::MsgPack);
+    // the most specific range decides, whatever its position
+    CHECK(negotiateFormat("application/*;q=0.9, application/json;q=0.1") == ResponseFormat::MsgPack);
+    CHECK(negotiateFormat("*/*, application/cbor;q=0.5") == ResponseFormat::Json);
+    CHECK(negotiateFormat("text/html") == ResponseFormat::Json);
+}
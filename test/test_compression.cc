@@ -0,0 +1,118 @@
+#include <drogon/drogon_test.h>
+#include <drogon/HttpResponse.h>
+#include <zlib.h>
+#ifdef ORG_CHART_USE_BROTLI
+#include <brotli/decode.h>
+#endif
+#include <string>
+#include "plugins/CompressionPlugin.h"
+#include "utils/utils.h"
+
+using Encoding = CompressionPlugin::Encoding;
+
+namespace {
+#ifdef ORG_CHART_USE_BROTLI
+    const auto kBrotli = Encoding::Brotli;
+#else
+    const auto kBrotli = Encoding::Gzip;
+#endif
+
+    auto gunzip(const std::string &in) -> std::string {
+        z_stream stream{};
+        if (inflateInit2(&stream, 15 + 16) != Z_OK) return "";
+        std::string out(1 << 20, '\0');
+        stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in.data()));
+        stream.avail_in = in.size();
+        stream.next_out = reinterpret_cast<Bytef *>(&out[0]);
+        stream.avail_out = out.size();
+        auto status = inflate(&stream, Z_FINISH);
+        out.resize(stream.total_out);
+        inflateEnd(&stream);
+        return status == Z_STREAM_END ? out : "";
+    }
+
+    auto body(size_t people) -> std::string {
+        std::string json = "[";
+        for (size_t i = 0; i < people; ++i) {
+            if (i > 0) json += ',';
+            json += R"({"id":)" + std::to_string(i) + R"(,"first_name":"Gary","last_name":"Reed"})";
+        }
+        return json + "]";
+    }
+}  // namespace
+
+DROGON_TEST(CompressionNegotiatesQualityValues)
+{
+    CHECK(CompressionPlugin::negotiate("") == Encoding::Identity);
+    CHECK(CompressionPlugin::negotiate("gzip") == Encoding::Gzip);
+    CHECK(CompressionPlugin::negotiate("GZip, deflate") == Encoding::Gzip);
+    CHECK(CompressionPlugin::negotiate("gzip, br") == kBrotli);
+    CHECK(CompressionPlugin::negotiate("br;q=0.5, gzip;q=0.8") == Encoding::Gzip);
+    CHECK(CompressionPlugin::negotiate("gzip; q=0.2, br; q=0.9") == kBrotli);
+    CHECK(CompressionPlugin::negotiate("gzip;q=0") == Encoding::Identity);
+    CHECK(CompressionPlugin::negotiate("deflate") == Encoding::Identity);
+    CHECK(CompressionPlugin::negotiate("*") == kBrotli);
+    CHECK(CompressionPlugin::negotiate("*;q=0") == Encoding::Identity);
+    CHECK(CompressionPlugin::negotiate("br;q=0, *") == Encoding::Gzip);
+}
+
+DROGON_TEST(CompressionHonorsIdentity)
+{
+    // identity outranks gzip here, and is excluded or outranked there
+    CHECK(CompressionPlugin::negotiate("gzip;q=0.5, identity") == Encoding::Identity);
+    CHECK(CompressionPlugin::negotiate("identity") == Encoding::Identity);
+    CHECK(CompressionPlugin::negotiate("identity;q=0, gzip;q=0.1") == Encoding::Gzip);
+    CHECK(CompressionPlugin::negotiate("identity;q=0.5, gzip") == Encoding::Gzip);
+    // "*" covers identity when it is not listed
+    CHECK(CompressionPlugin::negotiate("*;q=0.5, gzip;q=0.3, br;q=0.3") == Encoding::Identity);
+}
+
+DROGON_TEST(CompressionKeepsVary)
+{
+    // a binary person response already varies on Accept
+    auto resp = drogon::HttpResponse::newHttpResponse();
+    resp->addHeader("Vary", "Accept");
+    addVary(resp, "Accept-Encoding");
+    CHECK(resp->getHeader("vary") == "Accept, Accept-Encoding");
+    addVary(resp, "accept-encoding");
+    CHECK(resp->getHeader("vary") == "Accept, Accept-Encoding");
+
+    auto plain = drogon::HttpResponse::newHttpResponse();
+    addVary(plain, "Accept-Encoding");
+    CHECK(plain->getHeader("vary") == "Accept-Encoding");
+    auto any = drogon::HttpResponse::newHttpResponse();
+    any->addHeader("Vary", "*");
+    addVary(any, "Accept-Encoding");
+    CHECK(any->getHeader("vary") == "*");
+}
+
+DROGON_TEST(CompressionGzipRoundTrip)
+{
+    CompressionPlugin plugin;
+    // the second response reuses the thread's deflate stream
+    for (auto input : {body(500), body(20), std::string()}) {
+        std::string out;
+        REQUIRE(plugin.encode(input, Encoding::Gzip, out));
+        if (input.size() > 1000) CHECK(out.size() < input.size() / 4);
+        CHECK(gunzip(out) == input);
+    }
+}
+
+#ifdef ORG_CHART_USE_BROTLI
+DROGON_TEST(CompressionBrotliRoundTrip)
+{
+    CompressionPlugin plugin;
+    // later responses run on encoder memory kept from the earlier ones
+    for (auto input : {body(500), body(20), body(5000), std::string()}) {
+        std::string out;
+        REQUIRE(plugin.encode(input, Encoding::Brotli, out));
+        if (input.size() > 1000) CHECK(out.size() < input.size() / 4);
+        std::string decoded(input.size() + 16, '\0');
+        size_t decodedSize = decoded.size();
+        REQUIRE(BrotliDecoderDecompress(out.size(), reinterpret_cast<const uint8_t *>(out.data()), &decodedSize,
+                                        reinterpret_cast<uint8_t *>(&decoded[0])) == BROTLI_DECODER_RESULT_SUCCESS);
+        decoded.resize(decodedSize);
+        CHECK(decoded == input);
+    }
+}
+#endif
@@ -0,0 +1,64 @@
+#include <drogon/drogon_test.h>
+#include "import/ImportRows.h"
+
+DROGON_TEST(ParseCsvRows)
+{
+    std::string input = "last_name, first_name ,ignored\nShantee,Tayler,1\n\n\"Axl\nJr\",\"Mad\"\"onna\",2\r\n";
+    for (int i = 0; i < 20000; ++i) input += "L" + std::to_string(i) + ",\"F\nx\",3\n";
+    input += "\"Unterminated,x\n";
+
+    auto parsed = parseRows(input, InputFormat::Csv, {"first_name", "last_name"}, 4);
+    REQUIRE(parsed.rows.size() == 20002);
+    CHECK(parsed.rows[0].line == 2);
+    CHECK(parsed.rows[0].values[0] == "Tayler");
+    CHECK(parsed.rows[1].line == 4);
+    CHECK(parsed.rows[1].values[0] == "Mad\"onna");
+    CHECK(parsed.rows[1].values[1] == "Axl\nJr");
+    // Chunk boundaries must not fall inside the quoted multi-line fields.
+    CHECK(parsed.rows.back().values[0] == "F\nx");
+    CHECK(parsed.rows.back().values[1] == "L19999");
+    REQUIRE(parsed.errors.size() == 1);
+    CHECK(parsed.errors[0].line == 40006);
+}
+
+DROGON_TEST(ParseCsvQuoteInsideField)
+{
+    // A quote inside an unquoted field is text; it must not make the split think the quoted
+    // newlines below are record ends.
+    std::string input = "last_name,first_name\nO\"Brien,Tayler\n";
+    for (int i = 0; i < 20000; ++i) input += "L" + std::to_string(i) + ",\"F\nx\"\n";
+
+    auto parsed = parseRows(input, InputFormat::Csv, {"first_name", "last_name"}, 4);
+    CHECK(parsed.errors.empty());
+    REQUIRE(parsed.rows.size() == 20001);
+    CHECK(parsed.rows[0].values[1] == "O\"Brien");
+    std::size_t split = 0;
+    for (std::size_t i = 1; i < parsed.rows.size(); ++i) {
+        if (parsed.rows[i].values[0] != "F\nx") ++split;
+    }
+    CHECK(split == 0);
+    CHECK(parsed.rows.back().line == 40001);
+}
+
+DROGON_TEST(ParseNdjsonRows)
+{
+    auto parsed = parseRows("{\"first_name\": \"R\\u00e9my\", \"last_name\": null, \"other\": [1]}\n\n"
+                            "{\"first_name\": 5}\n{\"first_name\": \n",
+                            InputFormat::Ndjson, {"first_name", "last_name"}, 2);
+    REQUIRE(parsed.rows.size() == 2);
+    CHECK(parsed.rows[0].values[0] == "R\xc3\xa9my");
+    CHECK(parsed.rows[0].values[1].empty());
+    CHECK(parsed.rows[1].line == 3);
+    CHECK(parsed.rows[1].values[0] == "5");
+    REQUIRE(parsed.errors.size() == 1);
+    CHECK(parsed.errors[0].line == 4);
+}
+
+DROGON_TEST(OrderManagersFirst)
+{
+    std::vector<std::size_t> unreachable;
+    // 1 is the root, 2 reports to 1 and 0 to 2; 3 and 4 manage each other; 6 reports to rejected 5.
+    auto order = orderManagersFirst({2, kRootRow, 1, 4, 3, kRejectedRow, 5}, unreachable);
+    CHECK(order == std::vector<std::size_t>({1, 2, 0}));
+    CHECK(unreachable == std::vector<std::size_t>({3, 4, 6}));
+}
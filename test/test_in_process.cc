@@ -0,0 +1,303 @@
+#include <drogon/drogon_test.h>
+#include <drogon/drogon.h>
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+#include "InProcessServer.h"
+#include "plugins/OrgTreePlugin.h"
+#include "utils/AllocTracking.h"
+
+using namespace drogon;
+
+// Requests go through the real filters, controllers and models of this binary's app; only
+// the database is FakeDbClient.
+namespace {
+    auto send(HttpMethod method, const std::string &path, const Json::Value *body = nullptr,
+              const std::string &token = "", const std::string &ifMatch = "") -> HttpResponsePtr {
+        static auto client = HttpClient::newHttpClient(kInProcessUrl);
+        auto req = body ? HttpRequest::newHttpJsonRequest(*body) : HttpRequest::newHttpRequest();
+        req->setMethod(method);
+        req->setPath(path);
+        if (!token.empty()) req->addHeader("Authorization", "Bearer " + token);
+        if (!ifMatch.empty()) req->addHeader("If-Match", ifMatch);
+        auto [result, resp] = client->sendRequest(req, 10);
+        return result == ReqResult::Ok ? resp : nullptr;
+    }
+
+    auto loginToken(const std::string &username) -> std::string {
+        Json::Value user;
+        user["username"] = username;
+        user["password"] = "password";
+        send(Post, "/auth/register", &user);
+        auto resp = send(Post, "/auth/login", &user);
+        if (!resp || !resp->getJsonObject()) return "";
+        return (*resp->getJsonObject())["token"].asString();
+    }
+}  // namespace
+
+DROGON_TEST(InProcessPersonJoin)
+{
+    auto &db = inProcessDb();
+    auto department = db.addDepartment("Join Department");
+    auto job = db.addJob("Join Job");
+    auto boss = db.addPerson("Sabryna", "Peers", "2015-01-01", department, job);
+    auto report = db.addPerson("Gary", "Reed", "2018-04-07", department, job, boss);
+
+    auto resp = send(Get, "/persons/" + std::to_string(report));
+    REQUIRE(resp != nullptr);
+    CHECK(resp->getStatusCode() == k200OK);
+    CHECK(resp->getHeader("ETag") == "W/\"1\"");
+    // JSON too, since a msgpack client gets another body from the same URL
+    CHECK(resp->getHeader("Vary") == "Accept");
+    auto json = resp->getJsonObject();
+    REQUIRE(json != nullptr);
+    CHECK((*json)["first_name"].asString() == "Gary");
+    CHECK((*json)["manager"]["full_name"].asString() == "Sabryna Peers");
+    CHECK((*json)["department"]["name"].asString() == "Join Department");
+    CHECK((*json)["job"]["title"].asString() == "Join Job");
+    // the join and the response body at least
+    if (kAllocTracking) CHECK(std::stoull(resp->getHeader("X-Alloc-Count")) > 2);
+
+    auto reports = send(Get, "/persons/" + std::to_string(boss) + "/reports");
+    REQUIRE(reports != nullptr);
+    CHECK(reports->getStatusCode() == k200OK);
+    CHECK(reports->getHeader("Vary") == "Accept");
+    REQUIRE(reports->getJsonObject() != nullptr);
+    // the boss is their own manager
+    CHECK(reports->getJsonObject()->size() == 2);
+
+    auto lookup = send(Get, "/persons?ids=" + std::to_string(report) + ",999999," + std::to_string(boss));
+    REQUIRE(lookup != nullptr);
+    CHECK(lookup->getHeader("Vary") == "Accept");
+    REQUIRE(lookup->getJsonObject() != nullptr);
+    const auto &entries = *lookup->getJsonObject();
+    REQUIRE(entries.size() == 3);
+    CHECK(entries[0]["id"].asInt() == report);
+    CHECK(entries[1]["error"].asString() == "resource not found");
+    CHECK(entries[2]["id"].asInt() == boss);
+
+    CHECK(send(Get, "/persons/999999")->getStatusCode() == k404NotFound);
+}
+
+DROGON_TEST(InProcessVersionedUpdate)
+{
+    auto &db = inProcessDb();
+    auto department = db.addDepartment("Versioned Department");
+    auto job = db.addJob("Versioned Job");
+    auto person = db.addPerson("Tayler", "Shantee", "2019-02-03", department, job);
+    auto path = "/persons/" + std::to_string(person);
+
+    Json::Value change;
+    change["last_name"] = "Shantay";
+    auto stale = send(Put, path, &change, "", "\"7\"");
+    REQUIRE(stale != nullptr);
+    CHECK(stale->getStatusCode() == k412PreconditionFailed);
+    CHECK(stale->getHeader("ETag") == "W/\"1\"");
+
+    auto updated = send(Put, path, &change, "", "W/\"1\"");
+    REQUIRE(updated != nullptr);
+    CHECK(updated->getStatusCode() == k204NoContent);
+    CHECK(updated->getHeader("ETag") == "W/\"2\"");
+    CHECK((*send(Get, path)->getJsonObject())["last_name"].asString() == "Shantay");
+
+    CHECK(send(Put, "/persons/999999", &change, "", "W/\"1\"")->getStatusCode() == k404NotFound);
+}
+
+DROGON_TEST(InProcessManagerLoopRefused)
+{
+    auto &db = inProcessDb();
+    auto department = db.addDepartment("Loop Department");
+    auto job = db.addJob("Loop Job");
+    auto boss = db.addPerson("Loop", "Boss", "2016-01-01", department, job);
+
+    auto *treePtr = app().getPlugin<OrgTreePlugin>();
+    REQUIRE(treePtr != nullptr);
+    int managerId = 0;
+    for (int i = 0; i < 200 && treePtr->commonManager({1}, managerId) == OrgTreePlugin::Lookup::Loading; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    // seeded behind the API's back, so tell the tree as a change notification would
+    treePtr->personAdded(boss, boss);
+
+    Json::Value person;
+    person["first_name"] = "Loop";
+    person["last_name"] = "Report";
+    person["hire_date"] = "2019-01-01";
+    person["department_id"] = department;
+    person["job_id"] = job;
+    person["manager_id"] = boss;
+    auto created = send(Post, "/persons", &person);
+    REQUIRE(created != nullptr);
+    REQUIRE(created->getStatusCode() == k201Created);
+    REQUIRE(created->getJsonObject() != nullptr);
+    auto report = (*created->getJsonObject())["id"].asInt();
+
+    Json::Value change;
+    change["manager_id"] = report;
+    auto refused = send(Put, "/persons/" + std::to_string(boss), &change);
+    REQUIRE(refused != nullptr);
+    CHECK(refused->getStatusCode() == k409Conflict);
+    auto row = db.query("select manager_id, version from person where id = $1", {std::to_string(boss)});
+    REQUIRE(row.size() == 1);
+    CHECK(row[0]["manager_id"].as<int>() == boss);
+    CHECK(row[0]["version"].as<int>() == 1);
+}
+
+DROGON_TEST(InProcessOrgTreeHealsMissedChanges)
+{
+    auto &db = inProcessDb();
+    auto department = db.addDepartment("Healing Department");
+    auto job = db.addJob("Healing Job");
+    // written behind the plugin's back, like a change whose notification was lost
+    auto boss = db.addPerson("Healing", "Boss", "2013-03-01", department, job);
+    auto report = db.addPerson("Healing", "Report", "2017-03-01", department, job, boss);
+    auto other = db.addPerson("Healing", "Other", "2018-03-01", department, job, boss);
+
+    auto *treePtr = app().getPlugin<OrgTreePlugin>();
+    REQUIRE(treePtr != nullptr);
+    auto waitFor = [treePtr](const std::vector<int> &ids, int expected) {
+        int managerId = 0;
+        for (int i = 0; i < 300; ++i) {
+            if (treePtr->commonManager(ids, managerId) == OrgTreePlugin::Lookup::Found && managerId == expected) {
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return false;
+    };
+    CHECK(waitFor({report, other}, boss));
+
+    db.query("update person set manager_id = $1 where id = $2", {std::to_string(other), std::to_string(report)});
+    CHECK(waitFor({report, other}, other));
+}
+
+DROGON_TEST(InProcessConstraintViolation)
+{
+    Json::Value person;
+    person["first_name"] = "Nobody";
+    person["last_name"] = "Anywhere";
+    person["hire_date"] = "2020-01-01";
+    person["department_id"] = 999999;
+    person["job_id"] = 999999;
+    person["manager_id"] = 999999;
+    auto resp = send(Post, "/persons", &person);
+    REQUIRE(resp != nullptr);
+    CHECK(resp->getStatusCode() == k500InternalServerError);
+    REQUIRE(resp->getJsonObject() != nullptr);
+    CHECK((*resp->getJsonObject())["error"].asString() == "database error");
+}
+
+DROGON_TEST(InProcessLoginFilter)
+{
+    inProcessDb().addDepartment("Filtered Department");
+    CHECK(send(Get, "/departments")->getStatusCode() == k400BadRequest);
+
+    auto token = loginToken("in-process-user");
+    REQUIRE(!token.empty());
+    auto resp = send(Get, "/departments?limit=100", nullptr, token);
+    REQUIRE(resp != nullptr);
+    CHECK(resp->getStatusCode() == k200OK);
+    REQUIRE(resp->getJsonObject() != nullptr);
+    bool found = false;
+    for (const auto &department : *resp->getJsonObject()) {
+        found = found || department["name"].asString() == "Filtered Department";
+    }
+    CHECK(found);
+}
+
+DROGON_TEST(InProcessMemberListings)
+{
+    auto &db = inProcessDb();
+    auto department = db.addDepartment("Listing Department");
+    auto job = db.addJob("Listing Job");
+    auto boss = db.addPerson("Listing", "Boss", "2014-06-01", department, job);
+    auto first = db.addPerson("Listing", "First", "2018-06-01", department, job, boss);
+    auto second = db.addPerson("Listing", "Second", "2019-06-01", department, job, boss);
+    auto token = loginToken("listing-user");
+    REQUIRE(!token.empty());
+
+    // limit and offset are bound as bigint, which the fake checks as PostgreSQL does
+    for (const auto &path : {"/departments/" + std::to_string(department), "/jobs/" + std::to_string(job)}) {
+        auto page = send(Get, path + "/persons?limit=2&offset=1", nullptr, token);
+        REQUIRE(page != nullptr);
+        CHECK(page->getStatusCode() == k200OK);
+        CHECK(page->getHeader("Vary") == "Accept");
+        REQUIRE(page->getJsonObject() != nullptr);
+        REQUIRE(page->getJsonObject()->size() == 2);
+        CHECK((*page->getJsonObject())[0]["id"].asInt() == first);
+        CHECK((*page->getJsonObject())[1]["id"].asInt() == second);
+
+        auto past = send(Get, path + "/persons?offset=10", nullptr, token);
+        REQUIRE(past != nullptr);
+        CHECK(past->getStatusCode() == k200OK);
+        CHECK(past->getHeader("Vary") == "Accept");
+        REQUIRE(past->getJsonObject() != nullptr);
+        CHECK(past->getJsonObject()->isArray());
+        CHECK(past->getJsonObject()->empty());
+    }
+    CHECK(send(Get, "/departments/999999/persons", nullptr, token)->getStatusCode() == k404NotFound);
+    CHECK(send(Get, "/jobs/999999/persons", nullptr, token)->getStatusCode() == k404NotFound);
+}
+
+DROGON_TEST(InProcessLatencyInjection)
+{
+    auto &db = inProcessDb();
+    auto department = db.addDepartment("Latency Department");
+    auto job = db.addJob("Latency Job");
+    auto person = db.addPerson("Slow", "Query", "2021-05-06", department, job);
+
+    db.setLatency(std::chrono::milliseconds(50));
+    auto start = std::chrono::steady_clock::now();
+    auto resp = send(Get, "/persons/" + std::to_string(person));
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    db.setLatency(std::chrono::microseconds(0));
+
+    REQUIRE(resp != nullptr);
+    CHECK(resp->getStatusCode() == k200OK);
+    CHECK(elapsed >= std::chrono::milliseconds(50));
+}
+
+DROGON_TEST(InProcessConcurrentExports)
+{
+    auto &db = inProcessDb();
+    for (int i = 0; i < 2500; ++i) db.addJob("Export Job " + std::to_string(i));
+    auto token = loginToken("export-user");
+    REQUIRE(!token.empty());
+
+    // Twice as many exports as the export pool has connections. The later ones wait for a
+    // connection without holding up the IO loop, which the earlier ones need to finish.
+    db.setLatency(std::chrono::milliseconds(5));
+    std::vector<std::future<HttpResponsePtr>> exports;
+    for (int i = 0; i < 4; ++i) {
+        exports.push_back(std::async(std::launch::async, [token]() -> HttpResponsePtr {
+            // one connection each; a shared client would send them one after another
+            auto client = HttpClient::newHttpClient(kInProcessUrl);
+            auto req = HttpRequest::newHttpRequest();
+            req->setPath("/export/jobs.ndjson");
+            req->addHeader("Authorization", "Bearer " + token);
+            auto [result, resp] = client->sendRequest(req, 10);
+            return result == ReqResult::Ok ? resp : nullptr;
+        }));
+    }
+    auto other = send(Get, "/persons/999999");
+    std::vector<HttpResponsePtr> responses;
+    for (auto &future : exports) responses.push_back(future.get());
+    db.setLatency(std::chrono::microseconds(0));
+
+    REQUIRE(other != nullptr);
+    CHECK(other->getStatusCode() == k404NotFound);
+    for (const auto &resp : responses) REQUIRE(resp != nullptr);
+    auto first = responses[0]->getBody();
+    auto lines = std::count(first.begin(), first.end(), '\n');
+    CHECK(lines >= 2500);
+    for (const auto &resp : responses) {
+        CHECK(resp->getStatusCode() == k200OK);
+        auto body = resp->getBody();
+        CHECK(std::count(body.begin(), body.end(), '\n') == lines);
+        CHECK(body.find("\"title\":\"Export Job 2499\"") != std::string_view::npos);
+        CHECK(body.find("database error") == std::string_view::npos);
+    }
+}
@@ -1,6 +1,7 @@
 #define DROGON_TEST_MAIN
 #include <drogon/drogon_test.h>
 #include <drogon/drogon.h>
+#include "InProcessServer.h"
 
 // DROGON_TEST(RemoteAPITest)
 // {
@@ -27,6 +28,9 @@ int main(int argc, char** argv)
 {
     using namespace drogon;
 
+    // often enough for InProcessOrgTreeHealsMissedChanges to watch writes behind its back heal
+    configureInProcessServer(0.2);
+
     std::promise<void> p1;
     std::future<void> f1 = p1.get_future();
 
@@ -0,0 +1,47 @@
+#include <drogon/drogon_test.h>
+#include <thread>
+#include "utils/Metrics.h"
+
+DROGON_TEST(HistogramBucketBounds)
+{
+    for (uint64_t value : {0ull, 1ull, 7ull, 8ull, 15ull, 16ull, 1000ull, 123456789ull, ~0ull}) {
+        auto bucket = LatencyHistogram::bucketOf(value);
+        CHECK(bucket < LatencyHistogram::kBuckets);
+        CHECK(LatencyHistogram::upperBoundOf(bucket) >= value);
+        if (bucket > 0) CHECK(LatencyHistogram::upperBoundOf(bucket - 1) < value);
+    }
+}
+
+DROGON_TEST(RenderMergesThreadShards)
+{
+    auto &registry = MetricsRegistry::instance();
+    auto id = registry.latencySeries("test_duration_seconds", metricLabel("route", "/a\"b"));
+    std::thread other([&]() {
+        for (uint64_t i = 1; i <= 500; ++i) registry.record(id, i);
+    });
+    other.join();
+    for (uint64_t i = 501; i <= 1000; ++i) registry.record(id, i);
+
+    auto text = registry.render();
+    CHECK(text.find("# TYPE test_duration_seconds histogram\n") != std::string::npos);
+    CHECK(text.find("test_duration_seconds_count{route=\"/a\\\"b\"} 1000\n") != std::string::npos);
+    CHECK(text.find("test_duration_seconds_sum{route=\"/a\\\"b\"} 0.5005\n") != std::string::npos);
+    // values from 480us share a bucket with 511us, above the 500us bound
+    CHECK(text.find("test_duration_seconds_bucket{route=\"/a\\\"b\",le=\"0.0005\"} 479\n") != std::string::npos);
+    CHECK(text.find("test_duration_seconds_bucket{route=\"/a\\\"b\",le=\"0.0025\"} 1000\n") != std::string::npos);
+    CHECK(text.find("test_duration_seconds_bucket{route=\"/a\\\"b\",le=\"+Inf\"} 1000\n") != std::string::npos);
+}
+
+DROGON_TEST(CountSeriesRenderUnscaled)
+{
+    auto &registry = MetricsRegistry::instance();
+    auto id = registry.countSeries("test_allocations", metricLabel("route", "/count"));
+    for (uint64_t i = 1; i <= 100; ++i) registry.record(id, 7);
+
+    auto text = registry.render();
+    CHECK(text.find("# TYPE test_allocations histogram\n") != std::string::npos);
+    CHECK(text.find("test_allocations_bucket{route=\"/count\",le=\"5\"} 0\n") != std::string::npos);
+    CHECK(text.find("test_allocations_bucket{route=\"/count\",le=\"10\"} 100\n") != std::string::npos);
+    CHECK(text.find("test_allocations_bucket{route=\"/count\",le=\"100000000\"} 100\n") != std::string::npos);
+    CHECK(text.find("test_allocations_sum{route=\"/count\"} 700\n") != std::string::npos);
+}
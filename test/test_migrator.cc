@@ -0,0 +1,83 @@
+#include <drogon/drogon_test.h>
+#include <drogon/orm/Exception.h>
+#include <memory>
+#include <set>
+#include "FakeDbClient.h"
+#include "migrations/Migrator.h"
+
+using namespace drogon;
+
+namespace {
+    auto appliedVersions(FakeDbClient &db) -> std::vector<int> {
+        std::vector<int> versions;
+        for (const auto &row : db.query("select version from schema_migrations order by version")) {
+            versions.push_back(row["version"].as<int>());
+        }
+        return versions;
+    }
+}  // namespace
+
+DROGON_TEST(MigrationsAreNumberedInOrder)
+{
+    const auto &all = migrations();
+    REQUIRE(!all.empty());
+    std::set<std::string> names;
+    for (size_t i = 0; i < all.size(); ++i) {
+        CHECK(all[i].version == static_cast<int>(i) + 1);
+        CHECK(names.insert(all[i].name).second);
+        CHECK(!all[i].statements.empty());
+        // PostgreSQL refuses these inside a transaction block
+        for (const auto &statement : all[i].statements) {
+            if (statement.find(" concurrently ") != std::string::npos) CHECK(!all[i].transactional);
+        }
+    }
+}
+
+DROGON_TEST(MigratorRecordsAppliedVersions)
+{
+    auto db = std::make_shared<FakeDbClient>();
+    std::vector<Migration> first = {
+        {1, "first", {"select * from job"}},
+        {2, "second", {"select * from department"}, false},
+    };
+    CHECK(Migrator(db, first).apply() == 2);
+    CHECK(appliedVersions(*db) == std::vector<int>{1, 2});
+    CHECK(Migrator(db, first).apply() == 0);
+
+    auto next = first;
+    next.push_back({3, "third", {"select * from person"}});
+    CHECK(Migrator(db, next).apply() == 1);
+    CHECK(appliedVersions(*db) == std::vector<int>{1, 2, 3});
+    auto names = db->query("select name from schema_migrations where version = $1", {"3"});
+    REQUIRE(names.size() == 1);
+    CHECK(names[0]["name"].as<std::string>() == "third");
+}
+
+DROGON_TEST(MigratorStopsAtFailingMigration)
+{
+    for (bool transactional : {true, false}) {
+        auto db = std::make_shared<FakeDbClient>();
+        std::vector<Migration> all = {
+            {1, "first", {"select * from job"}},
+            {2, "broken", {"select * from missing_table"}, transactional},
+            {3, "third", {"select * from person"}},
+        };
+        CHECK_THROWS_AS(Migrator(db, all).apply(), orm::DrogonDbException);
+        // neither the failed migration nor anything after it is recorded
+        CHECK(appliedVersions(*db) == std::vector<int>{1});
+    }
+}
+
+DROGON_TEST(MigratorRebuildsInvalidIndexes)
+{
+    // a first boot whose build of person_job_id_idx failed part way through
+    auto db = std::make_shared<FakeDbClient>();
+    db->query("insert into pg_index (indexrelid, indisvalid) values ($1, $2)", {"person_manager_id_idx", "t"});
+    db->query("insert into pg_index (indexrelid, indisvalid) values ($1, $2)", {"person_job_id_idx", "f"});
+
+    std::vector<Migration> first = {migrations()[0]};
+    CHECK(Migrator(db, first).apply() == 1);
+    CHECK(db->query("select indexrelid from pg_index").size() == 3);
+    CHECK(db->query("select indexrelid from pg_index where indisvalid = $1", {"f"}).empty());
+    CHECK(appliedVersions(*db) == std::vector<int>{1});
+}
@@ -0,0 +1,146 @@
+#include <drogon/drogon_test.h>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "utils/OrgTree.h"
+
+namespace {
+    // 1 manages 2 and 3, 2 manages 4 and 5, 3 manages 8; 6 is their own manager and manages 7.
+    OrgTree sampleTree() {
+        OrgTree tree;
+        tree.build({{1, 1}, {2, 1}, {3, 1}, {4, 2}, {5, 2}, {8, 3}, {6, 6}, {7, 6}});
+        return tree;
+    }
+}  // namespace
+
+DROGON_TEST(OrgTreeCommonManager)
+{
+    auto tree = sampleTree();
+    CHECK(tree.size() == 8);
+    CHECK(tree.commonManager({4, 5}) == 2);
+    CHECK(tree.commonManager({4, 8}) == 1);
+    CHECK(tree.commonManager({4, 5, 8}) == 1);
+    // a manager of the others is their lowest common manager
+    CHECK(tree.commonManager({2, 4}) == 2);
+    CHECK(tree.commonManager({1, 1}) == 1);
+    CHECK(!tree.commonManager({4, 7}).has_value());
+    CHECK(!tree.commonManager({4, 42}).has_value());
+}
+
+DROGON_TEST(OrgTreePatches)
+{
+    auto tree = sampleTree();
+    CHECK(tree.add(9, 8));
+    CHECK(tree.commonManager({9, 4}) == 1);
+    CHECK(!tree.add(10, 42));
+    CHECK(!tree.contains(10));
+
+    // moving 3's organization under 5
+    tree.setManager(3, 5);
+    CHECK(tree.commonManager({9, 4}) == 2);
+    CHECK(tree.isUnder(9, 5));
+    CHECK(!tree.isUnder(5, 9));
+
+    tree.remove(9);
+    CHECK(!tree.contains(9));
+    CHECK(!tree.commonManager({9, 4}).has_value());
+}
+
+DROGON_TEST(OrgTreeDeepChain)
+{
+    OrgTree tree;
+    tree.build({{1, 1}});
+    // growing past the depth the lifting tables were built for
+    for (int id = 2; id <= 5000; ++id) REQUIRE(tree.add(id, id - 1));
+    tree.add(5001, 2500);
+    CHECK(tree.commonManager({5000, 5001}) == 2500);
+    CHECK(tree.isUnder(5000, 1));
+}
+
+DROGON_TEST(OrgTreeSkipsLoops)
+{
+    OrgTree tree;
+    tree.build({{1, 1}, {2, 3}, {3, 2}, {4, 1}});
+    CHECK(tree.contains(4));
+    CHECK(!tree.contains(2));
+    CHECK(!tree.contains(3));
+}
+
+DROGON_TEST(OrgTreeReportBeforeManager)
+{
+    auto tree = sampleTree();
+    // 10 and 11 are heard about before their manager 9
+    CHECK(!tree.add(11, 10));
+    CHECK(!tree.add(10, 9));
+    CHECK(!tree.contains(10));
+    CHECK(tree.size() == 8);
+    CHECK(tree.add(9, 8));
+    CHECK(tree.contains(11));
+    CHECK(tree.size() == 11);
+    CHECK(tree.commonManager({11, 4}) == 1);
+    CHECK(tree.isUnder(11, 3));
+}
+
+DROGON_TEST(OrgTreeMoveIntoOwnOrganization)
+{
+    auto tree = sampleTree();
+    // a notification can briefly report a loop; 3 and 8 leave the tree until it is undone
+    tree.setManager(3, 8);
+    CHECK(!tree.contains(3));
+    CHECK(!tree.contains(8));
+    CHECK(tree.size() == 6);
+    CHECK(!tree.isUnder(8, 1));
+    tree.setManager(3, 4);
+    CHECK(tree.contains(8));
+    CHECK(tree.size() == 8);
+    CHECK(tree.isUnder(8, 2));
+    CHECK(tree.commonManager({8, 5}) == 2);
+}
+
+DROGON_TEST(OrgTreeMovesMatchChainWalk)
+{
+    // 1 is the root, everyone else starts under a lower id
+    std::vector<std::pair<int, int>> managers{{1, 1}};
+    std::vector<int> manager(401, 1);
+    uint32_t seed = 7;
+    auto next = [&seed](int bound) {
+        seed = seed * 1103515245 + 12345;
+        return static_cast<int>((seed >> 8) % static_cast<uint32_t>(bound));
+    };
+    for (int id = 2; id <= 400; ++id) {
+        manager[id] = 1 + next(id - 1);
+        managers.emplace_back(id, manager[id]);
+    }
+    OrgTree tree;
+    tree.build(managers);
+
+    auto chainOf = [&manager](int id) {
+        std::vector<int> chain{id};
+        while (manager[chain.back()] != chain.back()) chain.push_back(manager[chain.back()]);
+        return chain;
+    };
+    for (int round = 0; round < 2000; ++round) {
+        int id = 2 + next(399);
+        int managerId = 1 + next(400);
+        auto managerChain = chainOf(managerId);
+        // moves that would close a loop are refused before they reach the tree
+        if (std::find(managerChain.begin(), managerChain.end(), id) != managerChain.end()) continue;
+        manager[id] = managerId;
+        tree.setManager(id, managerId);
+
+        int a = 1 + next(400);
+        int b = 1 + next(400);
+        auto chainA = chainOf(a);
+        auto chainB = chainOf(b);
+        int expected = 1;
+        for (auto candidate : chainA) {
+            if (std::find(chainB.begin(), chainB.end(), candidate) != chainB.end()) {
+                expected = candidate;
+                break;
+            }
+        }
+        REQUIRE(tree.commonManager({a, b}) == expected);
+        REQUIRE(tree.isUnder(a, b) == (a != b && std::find(chainA.begin(), chainA.end(), b) != chainA.end()));
+    }
+    CHECK(tree.size() == 400);
+}
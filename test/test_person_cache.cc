@@ -0,0 +1,87 @@
+#include <drogon/drogon_test.h>
+#include "utils/PersonCache.h"
+
+namespace {
+    // Person id with manager, department and job ids.
+    void put(PersonCache &cache, int id, int managerId, int departmentId, int jobId) {
+        cache.put(id, cache.generation(), managerId, departmentId, jobId, "{\"id\":" + std::to_string(id) + "}", "\"1\"");
+    }
+}  // namespace
+
+DROGON_TEST(PersonCacheInvalidatesPersonAndReports)
+{
+    PersonCache cache;
+    put(cache, 1, 1, 10, 20);
+    put(cache, 2, 1, 10, 20);
+    put(cache, 3, 2, 11, 21);
+    put(cache, 4, 4, 11, 21);
+
+    // the entries of 2 and of their report 3, who shows 2's name
+    cache.invalidate("person", 2);
+    CHECK(cache.get(1) != nullptr);
+    CHECK(cache.get(2) == nullptr);
+    CHECK(cache.get(3) == nullptr);
+    CHECK(cache.get(4) != nullptr);
+
+    // 1 manages themselves
+    cache.invalidate("person", 1);
+    CHECK(cache.get(1) == nullptr);
+    CHECK(cache.size() == 1);
+}
+
+DROGON_TEST(PersonCacheInvalidatesDepartmentAndJob)
+{
+    PersonCache cache;
+    put(cache, 1, 1, 10, 20);
+    put(cache, 2, 1, 10, 21);
+    put(cache, 3, 1, 11, 20);
+
+    cache.invalidate("department", 10);
+    CHECK(cache.get(1) == nullptr);
+    CHECK(cache.get(2) == nullptr);
+    CHECK(cache.get(3) != nullptr);
+
+    cache.invalidate("job", 20);
+    CHECK(cache.get(3) == nullptr);
+
+    put(cache, 4, 1, 12, 22);
+    // neither shows up in a person response
+    cache.invalidate("users", 4);
+    cache.invalidate("person", 99);
+    CHECK(cache.get(4) != nullptr);
+}
+
+DROGON_TEST(PersonCacheIgnoresStalePuts)
+{
+    PersonCache cache;
+    auto generation = cache.generation();
+    cache.invalidate("person", 1);
+    cache.put(1, generation, 1, 10, 20, "{}", "\"1\"");
+    CHECK(cache.get(1) == nullptr);
+
+    // a newer response replaces the cached one and its index entries
+    put(cache, 1, 1, 10, 20);
+    put(cache, 1, 1, 12, 20);
+    cache.invalidate("department", 10);
+    REQUIRE(cache.get(1) != nullptr);
+    CHECK(cache.get(1)->body == "{\"id\":1}");
+    cache.invalidate("department", 12);
+    CHECK(cache.get(1) == nullptr);
+}
+
+DROGON_TEST(PersonCacheEvictsLeastRecentlyUsed)
+{
+    PersonCache cache(2);
+    put(cache, 1, 1, 10, 20);
+    put(cache, 2, 1, 10, 20);
+    CHECK(cache.get(1) != nullptr);
+    put(cache, 3, 1, 10, 20);
+    CHECK(cache.size() == 2);
+    CHECK(cache.get(1) != nullptr);
+    CHECK(cache.get(2) == nullptr);
+    CHECK(cache.get(3) != nullptr);
+
+    // the evicted entry left the indexes too
+    cache.invalidate("department", 10);
+    CHECK(cache.size() == 0);
+}
@@ -0,0 +1,53 @@
+#include <drogon/drogon_test.h>
+#include <string>
+#include "FakeResult.h"
+#include "utils/PersonFields.h"
+
+DROGON_TEST(PersonFieldsParsing)
+{
+    PersonFields fields;
+    std::string err;
+    CHECK(fields.parse("id,first_name", err));
+    CHECK(fields.selectList() == "id, first_name");
+
+    // blanks around names, empty items and repeats are harmless
+    CHECK(fields.parse(" id, first_name ,\tjob,,job, id", err));
+    CHECK(fields.selectList() == "id, first_name, job_id, job_title");
+
+    CHECK(!fields.parse("id,salary", err));
+    CHECK(err == "unknown field 'salary'");
+    CHECK(!fields.parse("id,first name", err));
+    CHECK(err == "unknown field 'first name'");
+    CHECK(!fields.parse(" , ", err));
+    CHECK(err == "fields must name at least one field");
+}
+
+DROGON_TEST(PersonFieldsSelectList)
+{
+    PersonFields fields;
+    std::string err;
+    // columns come in document order, whatever the order of the request
+    REQUIRE(fields.parse("job,department,manager,hire_date,last_name", err));
+    CHECK(fields.sqlForSelecting() ==
+          "select last_name, hire_date, manager_id, manager_full_name, department_id, department_name, "
+          "job_id, job_title from person_details");
+}
+
+DROGON_TEST(PersonFieldsSerializeOnlySelected)
+{
+    PersonFields fields;
+    std::string err;
+    REQUIRE(fields.parse("id, manager", err));
+    auto result = makeFakeResult({"id", "manager_id", "manager_full_name"}, {{"7", "3", "Sabryna Peers"}});
+    auto json = fields.toJson(result[0]);
+    CHECK(json.size() == 2);
+    CHECK(json["id"].asInt() == 7);
+    CHECK(json["manager"]["id"].asInt() == 3);
+    CHECK(json["manager"]["full_name"].asString() == "Sabryna Peers");
+
+    BinaryEncoder encoder(ResponseFormat::MsgPack);
+    fields.encode(encoder, result[0]);
+    // {"id": 7, "manager": {"id": 3, "full_name": "Sabryna Peers"}}
+    const std::string expected{"\x82\xa2id\x07\xa7manager\x82\xa2id\x03\xa9" "full_name\xadSabryna Peers", 42};
+    CHECK(encoder.take() == expected);
+}
@@ -0,0 +1,205 @@
+#include <drogon/drogon_test.h>
+#include <drogon/drogon.h>
+#include <chrono>
+#include <future>
+#include <string>
+#include <vector>
+#include "PgTestServer.h"
+
+using namespace drogon;
+using namespace drogon::orm;
+
+// Against scripts/seed_db.sql: 1 manages themselves and 2, 3 and 8; 2 manages 4 and 5, 3
+// manages 6 and 7, 8 manages 9 to 12. Each test puts back what it moves.
+namespace {
+    auto send(HttpMethod method, const std::string &path, const Json::Value *body = nullptr,
+              const std::string &token = "") -> HttpResponsePtr {
+        static auto client = HttpClient::newHttpClient(kPgTestUrl);
+        auto req = body ? HttpRequest::newHttpJsonRequest(*body) : HttpRequest::newHttpRequest();
+        req->setMethod(method);
+        req->setPath(path);
+        if (!token.empty()) req->addHeader("Authorization", "Bearer " + token);
+        auto [result, resp] = client->sendRequest(req, 10);
+        return result == ReqResult::Ok ? resp : nullptr;
+    }
+
+    auto loginToken(const std::string &username) -> std::string {
+        Json::Value user;
+        user["username"] = username;
+        user["password"] = "password";
+        send(Post, "/auth/register", &user);
+        auto resp = send(Post, "/auth/login", &user);
+        if (!resp || !resp->getJsonObject()) return "";
+        return (*resp->getJsonObject())["token"].asString();
+    }
+
+    auto moveTo(int id, int managerId) -> HttpResponsePtr {
+        Json::Value change;
+        change["manager_id"] = managerId;
+        return send(Put, "/persons/" + std::to_string(id), &change);
+    }
+
+    auto orgSize(int id) -> int {
+        auto result = pgTestDb()->execSqlSync("select size from person_org_size where id = $1", id);
+        return result.empty() ? -1 : result[0]["size"].as<int>();
+    }
+
+    // "{8,1}", as PostgreSQL prints int[]
+    auto ancestors(int id) -> std::string {
+        auto result = pgTestDb()->execSqlSync("select ancestors from person_path where id = $1", id);
+        return result.empty() ? "" : result[0]["ancestors"].as<std::string>();
+    }
+
+    auto depth(int ancestor, int descendant) -> int {
+        auto result = pgTestDb()->execSqlSync(
+            "select depth from person_closure where ancestor = $1 and descendant = $2", ancestor, descendant);
+        return result.empty() ? -1 : result[0]["depth"].as<int>();
+    }
+
+    // Persons found above themselves in their own chain, i.e. management loops.
+    auto loops() -> int64_t {
+        return pgTestDb()
+            ->execSqlSync("select count(*) from person_closure where ancestor = descendant and depth > 0")[0][0]
+            .as<int64_t>();
+    }
+
+    // The SQLSTATE of a failed statement, empty when it succeeded.
+    auto sqlStateOf(const std::string &sql) -> std::string {
+        try {
+            pgTestDb()->execSqlSync(sql);
+            return "";
+        } catch (const SqlError &e) {
+            return e.sqlState();
+        }
+    }
+}  // namespace
+
+DROGON_TEST(PgHierarchyTriggersFollowWrites)
+{
+    auto db = pgTestDb();
+    CHECK(orgSize(1) == 11);
+    CHECK(orgSize(8) == 4);
+    CHECK(ancestors(10) == "{8,1}");
+    CHECK(ancestors(1) == "{}");
+
+    db->execSqlSync("update person set manager_id = 3 where id = 8");
+    CHECK(orgSize(3) == 7);
+    CHECK(orgSize(1) == 11);
+    CHECK(ancestors(10) == "{8,3,1}");
+    CHECK(depth(3, 10) == 2);
+    CHECK(depth(1, 10) == 3);
+
+    db->execSqlSync("insert into person (id, job_id, department_id, manager_id, first_name, last_name, hire_date) "
+                    "values (100, 3, 2, 9, 'Trigger', 'Test', '2024-01-01')");
+    CHECK(ancestors(100) == "{9,8,3,1}");
+    CHECK(orgSize(9) == 1);
+    CHECK(orgSize(3) == 8);
+    CHECK(orgSize(1) == 12);
+
+    // 100 is in 3's organization now
+    CHECK(sqlStateOf("update person set manager_id = 100 where id = 3") == "23514");
+    CHECK(ancestors(3) == "{1}");
+
+    db->execSqlSync("delete from person where id = 100");
+    CHECK(orgSize(9) == 0);
+    CHECK(orgSize(1) == 11);
+
+    db->execSqlSync("update person set manager_id = 1 where id = 8");
+    CHECK(orgSize(3) == 2);
+    CHECK(ancestors(10) == "{8,1}");
+    CHECK(depth(3, 10) == -1);
+    CHECK(loops() == 0);
+}
+
+DROGON_TEST(PgConcurrentMovesCannotCloseALoop)
+{
+    auto db = pgTestDb();
+    // 3 under 4 (in 2's organization) and 2 under 6 (in 3's) each pass the check on their own,
+    // but together 2 and 3 would manage each other.
+    auto first = db->newTransaction();
+    first->execSqlSync("update person set manager_id = 4 where id = 3");
+
+    std::promise<std::string> secondState;
+    auto second = secondState.get_future();
+    db->execSqlAsync(
+        "update person set manager_id = 6 where id = 2",
+        [&secondState](const Result &) { secondState.set_value(""); },
+        [&secondState](const DrogonDbException &e) {
+            auto *sqlError = dynamic_cast<const SqlError *>(&e.base());
+            secondState.set_value(sqlError ? sqlError->sqlState() : e.base().what());
+        });
+
+    // the second move waits for the hierarchy lock until the first commits
+    CHECK(second.wait_for(std::chrono::milliseconds(300)) == std::future_status::timeout);
+    first.reset();
+    CHECK(second.get() == "23514");
+    CHECK(ancestors(3) == "{4,2,1}");
+    CHECK(ancestors(2) == "{1}");
+    CHECK(loops() == 0);
+
+    db->execSqlSync("update person set manager_id = 1 where id = 3");
+    CHECK(orgSize(2) == 2);
+    CHECK(orgSize(3) == 2);
+}
+
+DROGON_TEST(PgHierarchyEndpoints)
+{
+    auto chain = send(Get, "/persons/10/chain");
+    REQUIRE(chain != nullptr);
+    CHECK(chain->getStatusCode() == k200OK);
+    REQUIRE(chain->getJsonObject() != nullptr);
+    std::vector<int> ids;
+    for (const auto &person : *chain->getJsonObject()) ids.push_back(person["id"].asInt());
+    CHECK(ids == std::vector<int>({10, 8, 1}));
+    CHECK(send(Get, "/persons/999999/chain")->getStatusCode() == k404NotFound);
+
+    auto under = send(Get, "/persons/10/is_under/1");
+    REQUIRE(under != nullptr);
+    REQUIRE(under->getJsonObject() != nullptr);
+    CHECK((*under->getJsonObject())["is_under"].asBool());
+    CHECK((*under->getJsonObject())["levels"].asInt() == 2);
+    auto notUnder = send(Get, "/persons/1/is_under/10");
+    REQUIRE(notUnder != nullptr);
+    REQUIRE(notUnder->getJsonObject() != nullptr);
+    CHECK(!(*notUnder->getJsonObject())["is_under"].asBool());
+    CHECK(send(Get, "/persons/10/is_under/999999")->getStatusCode() == k404NotFound);
+
+    auto size = send(Get, "/persons/8/org_size");
+    REQUIRE(size != nullptr);
+    REQUIRE(size->getJsonObject() != nullptr);
+    CHECK((*size->getJsonObject())["org_size"].asInt() == 4);
+    CHECK(send(Get, "/persons/999999/org_size")->getStatusCode() == k404NotFound);
+
+    // department 2 holds 8 to 12; limit and offset must reach PostgreSQL as bigint
+    auto token = loginToken("pg-test-user");
+    REQUIRE(!token.empty());
+    auto members = send(Get, "/departments/2/persons?limit=2&offset=1", nullptr, token);
+    REQUIRE(members != nullptr);
+    CHECK(members->getStatusCode() == k200OK);
+    REQUIRE(members->getJsonObject() != nullptr);
+    REQUIRE(members->getJsonObject()->size() == 2);
+    CHECK((*members->getJsonObject())[0]["id"].asInt() == 9);
+    CHECK((*members->getJsonObject())[1]["id"].asInt() == 10);
+    auto past = send(Get, "/departments/2/persons?offset=50", nullptr, token);
+    REQUIRE(past != nullptr);
+    CHECK(past->getStatusCode() == k200OK);
+    REQUIRE(past->getJsonObject() != nullptr);
+    CHECK(past->getJsonObject()->empty());
+
+    // a move through the API is visible to all three
+    CHECK(moveTo(8, 3)->getStatusCode() == k204NoContent);
+    chain = send(Get, "/persons/10/chain");
+    REQUIRE(chain->getJsonObject() != nullptr);
+    CHECK(chain->getJsonObject()->size() == 4);
+    CHECK((*send(Get, "/persons/10/is_under/3")->getJsonObject())["levels"].asInt() == 2);
+    CHECK((*send(Get, "/persons/3/org_size")->getJsonObject())["org_size"].asInt() == 7);
+
+    // without OrgTreePlugin in this app the trigger is what refuses the loop
+    auto loop = moveTo(3, 10);
+    REQUIRE(loop != nullptr);
+    CHECK(loop->getStatusCode() == k409Conflict);
+    CHECK((*send(Get, "/persons/3")->getJsonObject())["manager"]["id"].asInt() == 1);
+
+    CHECK(moveTo(8, 1)->getStatusCode() == k204NoContent);
+    CHECK((*send(Get, "/persons/3/org_size")->getJsonObject())["org_size"].asInt() == 2);
+}
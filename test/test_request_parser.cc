@@ -0,0 +1,32 @@
+#include <drogon/drogon_test.h>
+#include "utils/RequestParser.h"
+#include "utils/utils.h"
+
+using namespace drogon_model::org_chart;
+
+DROGON_TEST(ParsePerson)
+{
+    auto person = parsePerson(R"({"first_name": "Tayler", "last_name": "Shantee", "hire_date": "2018-04-07",)"
+                              R"( "job_id": "2", "department_id": 1, "manager_id": null, "extra": {"a": [1]}})");
+    CHECK(person.getValueOfFirstName() == "Tayler");
+    CHECK(person.getValueOfLastName() == "Shantee");
+    CHECK(person.getValueOfJobId() == 2);
+    CHECK(person.getValueOfDepartmentId() == 1);
+    CHECK(person.getManagerId() == nullptr);
+    CHECK(person.getHireDate() != nullptr);
+}
+
+DROGON_TEST(ParseEscapedString)
+{
+    auto department = parseDepartment(R"({"name": "Réseau \"Core\""})");
+    CHECK(department.getValueOfName() == "R\xc3\xa9seau \"Core\"");
+}
+
+DROGON_TEST(RejectMalformedBodies)
+{
+    CHECK_THROWS_AS(parsePerson(""), BadRequestError);
+    CHECK_THROWS_AS(parsePerson(R"({"job_id": 1.5})"), BadRequestError);
+    CHECK_THROWS_AS(parsePerson(R"({"first_name": 3})"), BadRequestError);
+    CHECK_THROWS_AS(parsePerson(R"({"hire_date": "07/04/2018"})"), BadRequestError);
+    CHECK_THROWS_AS(parseUser(R"({"username": "admin",})"), BadRequestError);
+}
@@ -0,0 +1,77 @@
+#include <drogon/drogon_test.h>
+#include <drogon/HttpRequest.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "utils/Tracing.h"
+
+namespace {
+    auto readFile(const std::string &path) -> std::string {
+        std::ifstream in(path);
+        std::stringstream out;
+        out << in.rdbuf();
+        return out.str();
+    }
+}  // namespace
+
+DROGON_TEST(TracerWritesSampledSpans)
+{
+    const std::string path = "test_trace.json";
+    auto &tracer = Tracer::instance();
+    REQUIRE(tracer.open(path, 1.0));
+
+    auto req = drogon::HttpRequest::newHttpRequest();
+    tracer.begin(req);
+    REQUIRE(tracer.find(req) != nullptr);
+    {
+        TraceSpan span(req, "serialize");
+    }
+    tracer.finish(req, "GET /persons/{1} \"200\"");
+    CHECK(tracer.find(req) == nullptr);
+    tracer.close();
+
+    auto text = readFile(path);
+    CHECK(text.rfind("[\n", 0) == 0);
+    CHECK(text.find("{\"name\":\"serialize\",\"ph\":\"X\"") != std::string::npos);
+    CHECK(text.find("{\"name\":\"GET /persons/{1} \\\"200\\\"\",\"ph\":\"X\"") != std::string::npos);
+    std::remove(path.c_str());
+}
+
+DROGON_TEST(TracerSkipsUnsampledRequests)
+{
+    const std::string path = "test_trace_unsampled.json";
+    auto &tracer = Tracer::instance();
+    REQUIRE(tracer.open(path, 0.0));
+
+    auto req = drogon::HttpRequest::newHttpRequest();
+    tracer.begin(req);
+    CHECK(tracer.find(req) == nullptr);
+    TraceSpan span(req, "serialize");
+    tracer.finish(req, "GET /persons 200");
+    tracer.close();
+
+    CHECK(readFile(path) == "[\n");
+    std::remove(path.c_str());
+}
+
+DROGON_TEST(TracerForgetsAbandonedRequests)
+{
+    const std::string path = "test_trace_abandoned.json";
+    auto &tracer = Tracer::instance();
+    REQUIRE(tracer.open(path, 1.0));
+    {
+        // its connection dropped before post-handling
+        auto req = drogon::HttpRequest::newHttpRequest();
+        tracer.begin(req);
+        CHECK(tracer.alive() == 1);
+    }
+    // lookups are back to one atomic load, and a later request finds no stale trace
+    CHECK(tracer.alive() == 0);
+    auto next = drogon::HttpRequest::newHttpRequest();
+    CHECK(tracer.find(next) == nullptr);
+    tracer.close();
+
+    CHECK(readFile(path) == "[\n");
+    std::remove(path.c_str());
+}
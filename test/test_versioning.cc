@@ -0,0 +1,38 @@
+#include <drogon/drogon_test.h>
+#include "utils/Versioning.h"
+
+using namespace drogon;
+
+DROGON_TEST(VersionETagRoundTrip)
+{
+    auto req = HttpRequest::newHttpRequest();
+    std::optional<int32_t> version;
+    CHECK(parseIfMatch(req, version));
+    CHECK(!version.has_value());
+
+    CHECK(versionETag(42) == "W/\"42\"");
+    req->addHeader("If-Match", versionETag(42));
+    CHECK(parseIfMatch(req, version));
+    CHECK(version == 42);
+
+    // as sent by clients written against the strong ETags of earlier versions
+    auto strong = HttpRequest::newHttpRequest();
+    strong->addHeader("If-Match", "\"7\"");
+    CHECK(parseIfMatch(strong, version));
+    CHECK(version == 7);
+}
+
+DROGON_TEST(IfMatchRejectsForeignTags)
+{
+    std::optional<int32_t> version;
+    for (const char *header : {"42", "W/42", "W/\"\"", "w/\"42\"", "\"abc\"", "\"\"", "\"1\", \"2\""}) {
+        auto req = HttpRequest::newHttpRequest();
+        req->addHeader("If-Match", header);
+        CHECK(!parseIfMatch(req, version));
+    }
+
+    auto any = HttpRequest::newHttpRequest();
+    any->addHeader("If-Match", "*");
+    CHECK(parseIfMatch(any, version));
+    CHECK(!version.has_value());
+}
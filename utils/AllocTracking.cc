@@ -0,0 +1,98 @@
+#include "AllocTracking.h"
+#include <cstdlib>
+#include <new>
+#include <string>
+
+namespace {
+    const std::string kAttribute = "alloc_counters";
+
+    // operator new reads the raw pointer only: touching a thread_local with a destructor from
+    // inside it could allocate. The shared_ptr keeps the counters alive while they are current.
+    thread_local AllocCounters *current = nullptr;
+    thread_local std::shared_ptr<AllocCounters> currentOwner;
+}  // namespace
+
+void setCurrentAllocCounters(std::shared_ptr<AllocCounters> counters) {
+    if (!kAllocTracking) return;
+    current = counters.get();
+    currentOwner = std::move(counters);
+}
+
+auto attachAllocCounters(const drogon::HttpRequestPtr &req) -> std::shared_ptr<AllocCounters> {
+    if (!kAllocTracking) return nullptr;
+    auto counters = std::make_shared<AllocCounters>();
+    setCurrentAllocCounters(counters);
+    req->attributes()->insert(kAttribute, counters);
+    return counters;
+}
+
+auto allocCountersOf(const drogon::HttpRequestPtr &req) -> std::shared_ptr<AllocCounters> {
+    if (!kAllocTracking || !req) return nullptr;
+    return req->attributes()->get<std::shared_ptr<AllocCounters>>(kAttribute);
+}
+
+AllocScope::AllocScope(std::shared_ptr<AllocCounters> counters) {
+    if (!counters) return;
+    active = true;
+    previous = currentOwner;
+    setCurrentAllocCounters(std::move(counters));
+}
+
+AllocScope::~AllocScope() {
+    if (active) setCurrentAllocCounters(std::move(previous));
+}
+
+#ifdef ORG_CHART_TRACK_ALLOCATIONS
+namespace {
+    auto allocate(std::size_t size) -> void * {
+        if (auto *counters = current) {
+            counters->count.fetch_add(1, std::memory_order_relaxed);
+            counters->bytes.fetch_add(size, std::memory_order_relaxed);
+        }
+        return std::malloc(size == 0 ? 1 : size);
+    }
+}  // namespace
+
+// Over-aligned allocations go through the default aligned operator new and are not counted.
+void *operator new(std::size_t size) {
+    if (auto *p = allocate(size)) return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) {
+    if (auto *p = allocate(size)) return p;
+    throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    return allocate(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+    return allocate(size);
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+    std::free(p);
+}
+#endif
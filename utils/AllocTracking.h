@@ -0,0 +1,45 @@
+#pragma once
+
+#include <drogon/HttpRequest.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// Heap allocations charged to one request.
+struct AllocCounters {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> bytes{0};
+};
+
+// True in builds configured with -DORG_CHART_TRACK_ALLOCATIONS=ON, which replace the global
+// operator new to charge every allocation to the current thread's AllocCounters. Other builds
+// count nothing and every function here is a cheap no-op.
+#ifdef ORG_CHART_TRACK_ALLOCATIONS
+constexpr bool kAllocTracking = true;
+#else
+constexpr bool kAllocTracking = false;
+#endif
+
+// Charges allocations on this thread to counters (null: to nobody) until changed again.
+void setCurrentAllocCounters(std::shared_ptr<AllocCounters> counters);
+
+// Attaches fresh counters to req and makes them current; AllocTrackingPlugin does this when
+// a request arrives.
+auto attachAllocCounters(const drogon::HttpRequestPtr &req) -> std::shared_ptr<AllocCounters>;
+// The counters attached to req, or null.
+auto allocCountersOf(const drogon::HttpRequestPtr &req) -> std::shared_ptr<AllocCounters>;
+
+// Charges allocations to counters while in scope, for work a request continues on another
+// thread (database callbacks); does nothing when counters is null.
+class AllocScope {
+ public:
+    explicit AllocScope(std::shared_ptr<AllocCounters> counters);
+    ~AllocScope();
+
+    AllocScope(const AllocScope &) = delete;
+    AllocScope &operator=(const AllocScope &) = delete;
+
+ private:
+    bool active = false;
+    std::shared_ptr<AllocCounters> previous;
+};
@@ -0,0 +1,224 @@
+#include "BinaryEncoder.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+namespace {
+    struct Preference {
+        double q = 0;
+        // 0: */*, 1: type/*, 2: exact
+        int specificity = -1;
+        size_t position = 0;
+    };
+
+    auto trim(std::string_view text) -> std::string_view {
+        auto first = text.find_first_not_of(" \t");
+        if (first == std::string_view::npos) return {};
+        auto last = text.find_last_not_of(" \t");
+        return text.substr(first, last - first + 1);
+    }
+
+    auto lowercase(std::string_view text) -> std::string {
+        std::string out(text);
+        std::transform(out.begin(), out.end(), out.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return out;
+    }
+}  // namespace
+
+auto negotiateFormat(const drogon::HttpRequestPtr &req) -> ResponseFormat {
+    return negotiateFormat(req->getHeader("accept"));
+}
+
+auto negotiateFormat(const std::string &accept) -> ResponseFormat {
+    // In order of preference on a tie.
+    const std::pair<ResponseFormat, std::vector<const char *>> formats[] = {
+        {ResponseFormat::Json, {"application/json"}},
+        {ResponseFormat::MsgPack, {"application/msgpack", "application/x-msgpack"}},
+        {ResponseFormat::Cbor, {"application/cbor"}},
+    };
+    Preference preferences[3];
+
+    std::string_view rest(accept);
+    for (size_t position = 0; !rest.empty(); ++position) {
+        auto comma = rest.find(',');
+        auto item = rest.substr(0, comma);
+        rest = comma == std::string_view::npos ? std::string_view() : rest.substr(comma + 1);
+
+        double q = 1;
+        auto semi = item.find(';');
+        auto range = lowercase(trim(item.substr(0, semi)));
+        while (semi != std::string_view::npos) {
+            item = item.substr(semi + 1);
+            semi = item.find(';');
+            auto param = trim(item.substr(0, semi));
+            if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+                q = std::atof(std::string(param.substr(2)).c_str());
+            }
+        }
+        auto slash = range.find('/');
+        if (slash == std::string::npos) continue;
+
+        for (size_t i = 0; i < 3; ++i) {
+            for (const auto *type : formats[i].second) {
+                std::string_view name(type);
+                int specificity = -1;
+                if (range == name) {
+                    specificity = 2;
+                } else if (range.compare(slash, std::string::npos, "/*") == 0 &&
+                           name.compare(0, slash + 1, range, 0, slash + 1) == 0) {
+                    specificity = 1;
+                } else if (range == "*/*") {
+                    specificity = 0;
+                }
+                if (specificity > preferences[i].specificity) preferences[i] = Preference{q, specificity, position};
+            }
+        }
+    }
+
+    size_t best = 0;
+    for (size_t i = 1; i < 3; ++i) {
+        const auto &candidate = preferences[i];
+        const auto &current = preferences[best];
+        if (candidate.q > current.q ||
+            (candidate.q == current.q && (candidate.specificity > current.specificity ||
+                                          (candidate.specificity == current.specificity &&
+                                           candidate.position < current.position)))) {
+            best = i;
+        }
+    }
+    return preferences[best].q > 0 ? formats[best].first : ResponseFormat::Json;
+}
+
+auto contentTypeOf(ResponseFormat format) -> const char * {
+    switch (format) {
+        case ResponseFormat::MsgPack: return "application/msgpack";
+        case ResponseFormat::Cbor: return "application/cbor";
+        default: return "application/json; charset=utf-8";
+    }
+}
+
+BinaryEncoder::BinaryEncoder(ResponseFormat format) : format{format} {
+    buffer.reserve(256);
+}
+
+void BinaryEncoder::writeBigEndian(uint64_t value, int bytes) {
+    for (int shift = (bytes - 1) * 8; shift >= 0; shift -= 8) {
+        buffer.push_back(static_cast<char>((value >> shift) & 0xff));
+    }
+}
+
+void BinaryEncoder::cborHeader(uint8_t majorType, uint64_t value) {
+    uint8_t major = majorType << 5;
+    if (value < 24) {
+        buffer.push_back(static_cast<char>(major | value));
+    } else if (value <= 0xff) {
+        buffer.push_back(static_cast<char>(major | 24));
+        writeBigEndian(value, 1);
+    } else if (value <= 0xffff) {
+        buffer.push_back(static_cast<char>(major | 25));
+        writeBigEndian(value, 2);
+    } else if (value <= 0xffffffff) {
+        buffer.push_back(static_cast<char>(major | 26));
+        writeBigEndian(value, 4);
+    } else {
+        buffer.push_back(static_cast<char>(major | 27));
+        writeBigEndian(value, 8);
+    }
+}
+
+void BinaryEncoder::beginArray(size_t size) {
+    if (format == ResponseFormat::Cbor) {
+        cborHeader(4, size);
+    } else if (size < 16) {
+        buffer.push_back(static_cast<char>(0x90 | size));
+    } else if (size <= 0xffff) {
+        buffer.push_back(static_cast<char>(0xdc));
+        writeBigEndian(size, 2);
+    } else {
+        buffer.push_back(static_cast<char>(0xdd));
+        writeBigEndian(size, 4);
+    }
+}
+
+void BinaryEncoder::beginMap(size_t size) {
+    if (format == ResponseFormat::Cbor) {
+        cborHeader(5, size);
+    } else if (size < 16) {
+        buffer.push_back(static_cast<char>(0x80 | size));
+    } else if (size <= 0xffff) {
+        buffer.push_back(static_cast<char>(0xde));
+        writeBigEndian(size, 2);
+    } else {
+        buffer.push_back(static_cast<char>(0xdf));
+        writeBigEndian(size, 4);
+    }
+}
+
+void BinaryEncoder::add(int64_t value) {
+    if (format == ResponseFormat::Cbor) {
+        if (value >= 0) cborHeader(0, static_cast<uint64_t>(value));
+        else cborHeader(1, static_cast<uint64_t>(-1 - value));
+        return;
+    }
+    if (value >= 0) {
+        if (value < 128) {
+            buffer.push_back(static_cast<char>(value));
+        } else if (value <= 0xff) {
+            buffer.push_back(static_cast<char>(0xcc));
+            writeBigEndian(value, 1);
+        } else if (value <= 0xffff) {
+            buffer.push_back(static_cast<char>(0xcd));
+            writeBigEndian(value, 2);
+        } else if (value <= 0xffffffff) {
+            buffer.push_back(static_cast<char>(0xce));
+            writeBigEndian(value, 4);
+        } else {
+            buffer.push_back(static_cast<char>(0xcf));
+            writeBigEndian(value, 8);
+        }
+    } else if (value >= -32) {
+        buffer.push_back(static_cast<char>(value));
+    } else if (value >= INT8_MIN) {
+        buffer.push_back(static_cast<char>(0xd0));
+        writeBigEndian(static_cast<uint64_t>(value), 1);
+    } else if (value >= INT16_MIN) {
+        buffer.push_back(static_cast<char>(0xd1));
+        writeBigEndian(static_cast<uint64_t>(value), 2);
+    } else if (value >= INT32_MIN) {
+        buffer.push_back(static_cast<char>(0xd2));
+        writeBigEndian(static_cast<uint64_t>(value), 4);
+    } else {
+        buffer.push_back(static_cast<char>(0xd3));
+        writeBigEndian(static_cast<uint64_t>(value), 8);
+    }
+}
+
+void BinaryEncoder::add(std::string_view value) {
+    auto size = value.size();
+    if (format == ResponseFormat::Cbor) {
+        cborHeader(3, size);
+    } else if (size < 32) {
+        buffer.push_back(static_cast<char>(0xa0 | size));
+    } else if (size <= 0xff) {
+        buffer.push_back(static_cast<char>(0xd9));
+        writeBigEndian(size, 1);
+    } else if (size <= 0xffff) {
+        buffer.push_back(static_cast<char>(0xda));
+        writeBigEndian(size, 2);
+    } else {
+        buffer.push_back(static_cast<char>(0xdb));
+        writeBigEndian(size, 4);
+    }
+    buffer.append(value.data(), size);
+}
+
+void BinaryEncoder::addNull() {
+    buffer.push_back(static_cast<char>(format == ResponseFormat::Cbor ? 0xf6 : 0xc0));
+}
+
+auto BinaryEncoder::take() -> std::string {
+    return std::move(buffer);
+}
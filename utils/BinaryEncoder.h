@@ -0,0 +1,37 @@
+#pragma once
+
+#include <drogon/HttpRequest.h>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+enum class ResponseFormat { Json, MsgPack, Cbor };
+
+// Picks the response encoding from the Accept header: the format with the highest quality
+// value, where a media type's value comes from its most specific matching range. Ties go to
+// exact matches, then to the range listed first, then to JSON, which is also the answer when
+// nothing is acceptable.
+auto negotiateFormat(const drogon::HttpRequestPtr &req) -> ResponseFormat;
+auto negotiateFormat(const std::string &accept) -> ResponseFormat;
+auto contentTypeOf(ResponseFormat format) -> const char *;
+
+// Appends MessagePack or CBOR items to a single buffer. Containers are length-prefixed, so
+// callers announce the number of elements (arrays) or key/value pairs (maps) up front.
+class BinaryEncoder {
+ public:
+    explicit BinaryEncoder(ResponseFormat format);
+
+    void beginArray(size_t size);
+    void beginMap(size_t size);
+    void add(int64_t value);
+    void add(std::string_view value);
+    void addNull();
+    auto take() -> std::string;
+
+ private:
+    void writeBigEndian(uint64_t value, int bytes);
+    void cborHeader(uint8_t majorType, uint64_t value);
+
+    ResponseFormat format;
+    std::string buffer;
+};
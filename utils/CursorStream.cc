@@ -0,0 +1,130 @@
+#include "CursorStream.h"
+#include "TimedQuery.h"
+#include <drogon/drogon.h>
+#include <drogon/orm/Exception.h>
+
+using namespace drogon;
+using namespace drogon::orm;
+
+namespace {
+    const std::size_t kBatchSize = 1000;
+    // Bytes the connection may hold unsent before the next FETCH waits for it to drain.
+    const std::size_t kMaxUnsentBytes = 1 << 20;
+    // How often a stream waiting for a slow client checks on it.
+    const double kDrainCheckSeconds = 0.005;
+}
+
+CursorStream::CursorStream(RowWriter writer, std::weak_ptr<trantor::TcpConnection> connection)
+    : writer{std::move(writer)}, connection{std::move(connection)} {}
+
+auto CursorStream::newResponse(const HttpRequestPtr &req, const DbClientPtr &dbClientPtr, const std::string &query,
+                               RowWriter writer, const std::string &contentType) -> HttpResponsePtr {
+    std::shared_ptr<CursorStream> cursorStream(new CursorStream(std::move(writer), req->getConnectionPtr()));
+    auto resp = HttpResponse::newAsyncStreamResponse(
+        [cursorStream, dbClientPtr, query](ResponseStreamPtr responseStream) {
+            cursorStream->start(std::move(responseStream), dbClientPtr, query);
+        });
+    resp->setContentTypeCodeAndCustomString(CT_CUSTOM, contentType);
+    return resp;
+}
+
+void CursorStream::post(std::function<void(CursorStream &)> f) {
+    loop->queueInLoop([self = shared_from_this(), f = std::move(f)]() { f(*self); });
+}
+
+void CursorStream::start(ResponseStreamPtr responseStream, const DbClientPtr &dbClientPtr, const std::string &query) {
+    auto conn = connection.lock();
+    if (!conn) return;
+    loop = conn->getLoop();
+    sentAtStart = conn->bytesSent();
+    stream = std::move(responseStream);
+
+    // Waits for a connection of the pool without holding up the loop.
+    auto self = shared_from_this();
+    dbClientPtr->newTransactionAsync([self, query](const std::shared_ptr<Transaction> &transPtr) {
+        self->post([transPtr, query](CursorStream &s) { s.declare(transPtr, query); });
+    });
+}
+
+void CursorStream::declare(const std::shared_ptr<Transaction> &transPtr, const std::string &query) {
+    // The client may have gone while this waited for a connection; dropping transPtr ends it.
+    if (!stream) return;
+    trans = transPtr;
+    auto self = shared_from_this();
+    TimedQuery timed(nullptr, "export.declare_cursor");
+    trans->execSqlAsync(
+        "declare export_cursor no scroll cursor for " + query,
+        timed.onResult([self](const Result &) { self->post([](CursorStream &s) { s.fetch(); }); }),
+        timed.onError([self](const DrogonDbException &e) {
+            self->post([error = std::string(e.base().what())](CursorStream &s) { s.fail(error); });
+        }));
+}
+
+void CursorStream::fetch() {
+    if (!stream || !trans) return;
+    auto self = shared_from_this();
+    TimedQuery timed(nullptr, "export.fetch");
+    trans->execSqlAsync(
+        "fetch " + std::to_string(kBatchSize) + " from export_cursor",
+        timed.onResult([self](const Result &result) {
+            // Rendered on the database thread; only the finished chunk goes to the loop.
+            std::string chunk;
+            for (const auto &row : result) {
+                self->writer(row, chunk);
+            }
+            self->post([chunk = std::move(chunk), done = result.size() < kBatchSize](CursorStream &s) {
+                s.onBatch(chunk, done);
+            });
+        }),
+        timed.onError([self](const DrogonDbException &e) {
+            self->post([error = std::string(e.base().what())](CursorStream &s) { s.fail(error); });
+        }));
+}
+
+void CursorStream::onBatch(const std::string &chunk, bool done) {
+    if (!stream) return;
+    if (!chunk.empty()) {
+        if (!stream->send(chunk)) {
+            // the client went away
+            close();
+            return;
+        }
+        queued += chunk.size();
+    }
+    if (done) {
+        close();
+    } else {
+        pace();
+    }
+}
+
+void CursorStream::pace() {
+    auto conn = connection.lock();
+    if (!stream || !conn || conn->disconnected()) {
+        close();
+        return;
+    }
+    // Headers and chunk framing count as sent too, which errs on the side of fetching sooner.
+    auto sent = conn->bytesSent() - sentAtStart;
+    if (queued <= sent + kMaxUnsentBytes) {
+        fetch();
+    } else {
+        loop->runAfter(kDrainCheckSeconds, [self = shared_from_this()]() { self->pace(); });
+    }
+}
+
+void CursorStream::fail(const std::string &error) {
+    LOG_ERROR << "export cursor failed: " << error;
+    if (stream) stream->send("{\"error\":\"database error\"}\n");
+    close();
+}
+
+void CursorStream::close() {
+    if (stream) {
+        stream->close();
+        stream.reset();
+    }
+    // Dropping the transaction ends it, which closes the cursor and returns the connection to
+    // the export pool.
+    trans.reset();
+}
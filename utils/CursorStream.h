@@ -0,0 +1,51 @@
+#pragma once
+
+#include <drogon/HttpRequest.h>
+#include <drogon/HttpResponse.h>
+#include <drogon/orm/DbClient.h>
+#include <trantor/net/EventLoop.h>
+#include <trantor/net/TcpConnection.h>
+#include <functional>
+#include <memory>
+#include <string>
+
+// Streams the rows of a query into an HTTP response from a server-side cursor. Batches are
+// fetched inside a dedicated transaction and pushed to the connection as they arrive; the next
+// FETCH is only issued once the connection has written all but a few batches of what it was
+// given, so memory stays constant for any table size and a slow client slows the cursor down.
+// Nothing ever waits on an IO thread: all state lives on the connection's loop, and a stream
+// waiting for a free database connection or a slow socket just has nothing scheduled there.
+class CursorStream : public std::enable_shared_from_this<CursorStream> {
+ public:
+    // Appends one row, including its line terminator, to out.
+    using RowWriter = std::function<void(const drogon::orm::Row &row, std::string &out)>;
+
+    // The response to req streaming the rows of query in the given content type.
+    static auto newResponse(const drogon::HttpRequestPtr &req, const drogon::orm::DbClientPtr &dbClientPtr,
+                            const std::string &query, RowWriter writer, const std::string &contentType)
+        -> drogon::HttpResponsePtr;
+
+ private:
+    CursorStream(RowWriter writer, std::weak_ptr<trantor::TcpConnection> connection);
+
+    // Everything below runs on the connection's loop.
+    void start(drogon::ResponseStreamPtr responseStream, const drogon::orm::DbClientPtr &dbClientPtr,
+               const std::string &query);
+    void declare(const std::shared_ptr<drogon::orm::Transaction> &transPtr, const std::string &query);
+    void fetch();
+    void onBatch(const std::string &chunk, bool done);
+    void fail(const std::string &error);
+    void pace();
+    void close();
+    // Runs f on the connection's loop, keeping the stream alive until it has.
+    void post(std::function<void(CursorStream &)> f);
+
+    RowWriter writer;
+    std::weak_ptr<trantor::TcpConnection> connection;
+    trantor::EventLoop *loop = nullptr;
+    drogon::ResponseStreamPtr stream;
+    std::shared_ptr<drogon::orm::Transaction> trans;
+    // Bytes handed to the stream, and the connection's sent byte count when it started.
+    size_t queued = 0;
+    size_t sentAtStart = 0;
+};
@@ -0,0 +1,46 @@
+#include "DbConfig.h"
+#include <json/json.h>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+    std::string connInfo;
+
+    std::string quote(const std::string &value) {
+        std::string ret = "'";
+        for (auto c : value) {
+            if (c == '\'' || c == '\\') ret += '\\';
+            ret += c;
+        }
+        ret += "'";
+        return ret;
+    }
+}  // namespace
+
+void loadDbConfig(const std::string &configPath) {
+    std::ifstream in(configPath);
+    if (!in) {
+        throw std::runtime_error("cannot open config file " + configPath);
+    }
+
+    Json::Value config;
+    Json::CharReaderBuilder builder;
+    std::string errs;
+    if (!Json::parseFromStream(builder, in, &config, &errs)) {
+        throw std::runtime_error("cannot parse config file " + configPath + ": " + errs);
+    }
+
+    auto db = config["db_clients"][0];
+    connInfo = "host=" + quote(db.get("host", "127.0.0.1").asString()) +
+               " port=" + std::to_string(db.get("port", 5432).asInt()) +
+               " dbname=" + quote(db.get("dbname", "").asString()) +
+               " user=" + quote(db.get("user", "postgres").asString());
+    auto passwd = db.get("passwd", db.get("password", "")).asString();
+    if (!passwd.empty()) connInfo += " password=" + quote(passwd);
+    auto encoding = db.get("client_encoding", "").asString();
+    if (!encoding.empty()) connInfo += " client_encoding=" + quote(encoding);
+}
+
+auto pgConnInfo() -> const std::string & {
+    return connInfo;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <string>
+
+// Reads the first entry of "db_clients" from the drogon config file so code that
+// needs its own PostgreSQL connection (migrations, listeners) uses the same settings.
+void loadDbConfig(const std::string &configPath);
+
+// libpq connection string built from the loaded config.
+auto pgConnInfo() -> const std::string &;
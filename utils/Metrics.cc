@@ -0,0 +1,201 @@
+#include "Metrics.h"
+#include <trantor/utils/Logger.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+    // Seconds, from 100us to 10s.
+    const std::vector<double> kLatencyBounds = {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025,
+                                                0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+    // 1, 2, 5, 10, ... 1e8.
+    const std::vector<double> kCountBounds = [] {
+        std::vector<double> bounds;
+        for (double decade = 1; decade <= 1e8; decade *= 10) {
+            for (double step : {1, 2, 5}) {
+                if (step * decade <= 1e8) bounds.push_back(step * decade);
+            }
+        }
+        return bounds;
+    }();
+
+    void appendNumber(std::string &out, double value) {
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "%.9g", value);
+        out += buf;
+    }
+
+    void appendSample(std::string &out, const std::string &name, const std::string &labels,
+                      const std::string &extraLabel, double value) {
+        out += name;
+        if (!labels.empty() || !extraLabel.empty()) {
+            out += '{';
+            out += labels;
+            if (!labels.empty() && !extraLabel.empty()) out += ',';
+            out += extraLabel;
+            out += '}';
+        }
+        out += ' ';
+        appendNumber(out, value);
+        out += '\n';
+    }
+}  // namespace
+
+auto LatencyHistogram::bucketOf(uint64_t micros) -> int {
+    if (micros < kSubBuckets) return static_cast<int>(micros);
+    int exponent = 63 - __builtin_clzll(micros);
+    auto subBucket = static_cast<int>((micros >> (exponent - kSubBucketBits)) & (kSubBuckets - 1));
+    return (exponent - kSubBucketBits + 1) * kSubBuckets + subBucket;
+}
+
+auto LatencyHistogram::upperBoundOf(int bucket) -> uint64_t {
+    if (bucket < kSubBuckets) return static_cast<uint64_t>(bucket);
+    int exponent = bucket / kSubBuckets + kSubBucketBits - 1;
+    uint64_t subBucket = bucket % kSubBuckets;
+    uint64_t width = uint64_t(1) << (exponent - kSubBucketBits);
+    return ((kSubBuckets + subBucket) << (exponent - kSubBucketBits)) + width - 1;
+}
+
+MetricsRegistry::Shard::~Shard() {
+    for (auto &histogram : histograms) delete histogram.load();
+}
+
+auto MetricsRegistry::instance() -> MetricsRegistry & {
+    // Never destroyed: IO threads may still record while the process exits.
+    static auto *registry = new MetricsRegistry();
+    return *registry;
+}
+
+void MetricsRegistry::describe(const std::string &family, const std::string &text) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto &[name, existing] : help) {
+        if (name == family) return;
+    }
+    help.emplace_back(family, text);
+}
+
+auto MetricsRegistry::addSeries(const std::string &family, const std::string &labels, bool gauge, double scale,
+                                const std::vector<double> *bounds) -> int {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i < series.size(); ++i) {
+        if (series[i].family == family && series[i].labels == labels) return static_cast<int>(i);
+    }
+    if (series.size() >= kMaxSeries) {
+        LOG_WARN << "metrics: series limit reached, dropping " << family << "{" << labels << "}";
+        return -1;
+    }
+    series.push_back({family, labels, gauge, scale, bounds});
+    return static_cast<int>(series.size() - 1);
+}
+
+auto MetricsRegistry::latencySeries(const std::string &family, const std::string &labels) -> int {
+    return addSeries(family, labels, false, 1e6, &kLatencyBounds);
+}
+
+auto MetricsRegistry::countSeries(const std::string &family, const std::string &labels) -> int {
+    return addSeries(family, labels, false, 1, &kCountBounds);
+}
+
+auto MetricsRegistry::gaugeSeries(const std::string &family, const std::string &labels) -> int {
+    return addSeries(family, labels, true, 1, nullptr);
+}
+
+auto MetricsRegistry::localShard() -> Shard & {
+    thread_local Shard *shard = nullptr;
+    if (shard == nullptr) {
+        // Shards outlive their thread so what it recorded stays in the totals.
+        std::lock_guard<std::mutex> lock(mutex);
+        shards.push_back(std::make_unique<Shard>());
+        shard = shards.back().get();
+    }
+    return *shard;
+}
+
+void MetricsRegistry::record(int seriesId, uint64_t micros) {
+    if (seriesId < 0) return;
+    auto &slot = localShard().histograms[seriesId];
+    auto *histogram = slot.load(std::memory_order_relaxed);
+    if (histogram == nullptr) {
+        histogram = new LatencyHistogram();
+        slot.store(histogram, std::memory_order_release);
+    }
+    histogram->record(micros);
+}
+
+void MetricsRegistry::set(int gaugeId, double value) {
+    if (gaugeId < 0) return;
+    gauges[gaugeId].store(value, std::memory_order_relaxed);
+}
+
+auto MetricsRegistry::render() -> std::string {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<size_t> order(series.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+                     [this](size_t a, size_t b) { return series[a].family < series[b].family; });
+
+    std::string out;
+    std::vector<uint64_t> counts(LatencyHistogram::kBuckets);
+    const std::string *family = nullptr;
+    for (auto id : order) {
+        const auto &current = series[id];
+        if (family == nullptr || *family != current.family) {
+            family = &current.family;
+            for (const auto &[name, text] : help) {
+                if (name == current.family) out += "# HELP " + name + " " + text + "\n";
+            }
+            out += "# TYPE " + current.family + (current.gauge ? " gauge\n" : " histogram\n");
+        }
+        if (current.gauge) {
+            appendSample(out, current.family, current.labels, "", gauges[id].load(std::memory_order_relaxed));
+            continue;
+        }
+
+        std::fill(counts.begin(), counts.end(), 0);
+        uint64_t total = 0;
+        uint64_t sum = 0;
+        for (const auto &shard : shards) {
+            const auto *histogram = shard->histograms[id].load(std::memory_order_acquire);
+            if (histogram == nullptr) continue;
+            for (int bucket = 0; bucket < LatencyHistogram::kBuckets; ++bucket) {
+                auto count = histogram->counts[bucket].load(std::memory_order_relaxed);
+                counts[bucket] += count;
+                total += count;
+            }
+            sum += histogram->sum.load(std::memory_order_relaxed);
+        }
+
+        // Internal buckets come in increasing order of their upper bounds.
+        uint64_t cumulative = 0;
+        int bucket = 0;
+        for (auto bound : *current.bounds) {
+            auto limit = static_cast<uint64_t>(std::llround(bound * current.scale));
+            while (bucket < LatencyHistogram::kBuckets && LatencyHistogram::upperBoundOf(bucket) <= limit) {
+                cumulative += counts[bucket++];
+            }
+            char label[40];
+            std::snprintf(label, sizeof(label), "le=\"%.9g\"", bound);
+            appendSample(out, current.family + "_bucket", current.labels, label, static_cast<double>(cumulative));
+        }
+        appendSample(out, current.family + "_bucket", current.labels, "le=\"+Inf\"", static_cast<double>(total));
+        appendSample(out, current.family + "_sum", current.labels, "", sum / current.scale);
+        appendSample(out, current.family + "_count", current.labels, "", static_cast<double>(total));
+    }
+    return out;
+}
+
+auto metricLabel(const std::string &name, std::string_view value) -> std::string {
+    std::string out = name + "=\"";
+    for (auto c : value) {
+        if (c == '\\' || c == '"') {
+            out += '\\';
+            out += c;
+        } else if (c == '\n') {
+            out += "\\n";
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+    return out;
+}
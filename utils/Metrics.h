@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Log-linear latency histogram in microseconds: eight sub-buckets per power of two, so any
+// recorded value is known to within 12.5%. Written by a single thread, read by any.
+class LatencyHistogram {
+ public:
+    static constexpr int kSubBucketBits = 3;
+    static constexpr int kSubBuckets = 1 << kSubBucketBits;
+    static constexpr int kBuckets = (64 - kSubBucketBits) * kSubBuckets + kSubBuckets;
+
+    static auto bucketOf(uint64_t micros) -> int;
+    // Largest value that falls into the bucket.
+    static auto upperBoundOf(int bucket) -> uint64_t;
+
+    // Owner thread only; plain load/store keeps the hot path free of locked instructions.
+    void record(uint64_t micros) {
+        auto &count = counts[bucketOf(micros)];
+        count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        sum.store(sum.load(std::memory_order_relaxed) + micros, std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<uint64_t>, kBuckets> counts{};
+    std::atomic<uint64_t> sum{0};
+};
+
+// Process wide metrics in Prometheus text exposition format. Every thread records into its own
+// shard, so recording takes no lock; render() adds the shards up. Series are registered once per
+// label set (under a mutex) and then referred to by id.
+//
+// Histograms are exported with the same fixed buckets on every instance so they can be summed
+// across instances and over time windows. Each exported bucket counts the internal buckets that
+// lie entirely under its bound, so a value less than 12.5% below a bound may land in the next one.
+class MetricsRegistry {
+ public:
+    static constexpr int kMaxSeries = 4096;
+
+    static auto instance() -> MetricsRegistry &;
+
+    // HELP text of a family; call before registering its series.
+    void describe(const std::string &family, const std::string &help);
+    // Latency series rendered in seconds as a Prometheus histogram. labels is the preformatted
+    // label list, e.g. method="GET",route="/persons". Returns -1 once kMaxSeries series exist.
+    auto latencySeries(const std::string &family, const std::string &labels) -> int;
+    // Histogram of plain counts (e.g. allocations per request), rendered as recorded.
+    auto countSeries(const std::string &family, const std::string &labels) -> int;
+    auto gaugeSeries(const std::string &family, const std::string &labels) -> int;
+
+    // micros for latency series, the count itself for count series.
+    void record(int seriesId, uint64_t micros);
+    void set(int gaugeId, double value);
+
+    auto render() -> std::string;
+
+ private:
+    struct Shard {
+        std::array<std::atomic<LatencyHistogram *>, kMaxSeries> histograms{};
+        ~Shard();
+    };
+    struct Series {
+        std::string family;
+        std::string labels;
+        bool gauge;
+        // Divisor from recorded values to rendered ones.
+        double scale;
+        // Upper bounds of the exported buckets, in rendered units; null for gauges.
+        const std::vector<double> *bounds;
+    };
+
+    auto addSeries(const std::string &family, const std::string &labels, bool gauge, double scale,
+                   const std::vector<double> *bounds) -> int;
+    auto localShard() -> Shard &;
+
+    std::mutex mutex;
+    std::vector<Series> series;
+    std::vector<std::pair<std::string, std::string>> help;
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::array<std::atomic<double>, kMaxSeries> gauges{};
+};
+
+// Quotes a label value for the exposition format.
+auto metricLabel(const std::string &name, std::string_view value) -> std::string;
@@ -0,0 +1,143 @@
+#include "ModelEncoding.h"
+#include <drogon/drogon.h>
+#include "TimedQuery.h"
+#include "utils.h"
+
+using namespace drogon;
+using namespace drogon::orm;
+using namespace drogon_model::org_chart;
+
+namespace {
+    void addInt(BinaryEncoder &encoder, const std::shared_ptr<int32_t> &value) {
+        if (value) encoder.add(static_cast<int64_t>(*value));
+        else encoder.addNull();
+    }
+
+    void addString(BinaryEncoder &encoder, const std::shared_ptr<std::string> &value) {
+        if (value) encoder.add(*value);
+        else encoder.addNull();
+    }
+}  // namespace
+
+void encode(BinaryEncoder &encoder, const Person &person) {
+    encoder.beginMap(7);
+    encoder.add("id");
+    addInt(encoder, person.getId());
+    encoder.add("job_id");
+    addInt(encoder, person.getJobId());
+    encoder.add("department_id");
+    addInt(encoder, person.getDepartmentId());
+    encoder.add("manager_id");
+    addInt(encoder, person.getManagerId());
+    encoder.add("first_name");
+    addString(encoder, person.getFirstName());
+    encoder.add("last_name");
+    addString(encoder, person.getLastName());
+    encoder.add("hire_date");
+    if (person.getHireDate()) encoder.add(person.getHireDate()->toDbStringLocal());
+    else encoder.addNull();
+}
+
+void encode(BinaryEncoder &encoder, const Department &department) {
+    encoder.beginMap(2);
+    encoder.add("id");
+    addInt(encoder, department.getId());
+    encoder.add("name");
+    addString(encoder, department.getName());
+}
+
+void encode(BinaryEncoder &encoder, const Job &job) {
+    encoder.beginMap(2);
+    encoder.add("id");
+    addInt(encoder, job.getId());
+    encoder.add("title");
+    addString(encoder, job.getTitle());
+}
+
+void encodePersonDetails(BinaryEncoder &encoder, const PersonInfo &personInfo) {
+    encoder.beginMap(7);
+    encoder.add("id");
+    encoder.add(static_cast<int64_t>(personInfo.getValueOfId()));
+    encoder.add("first_name");
+    encoder.add(personInfo.getValueOfFirstName());
+    encoder.add("last_name");
+    encoder.add(personInfo.getValueOfLastName());
+    encoder.add("hire_date");
+    encoder.add(personInfo.getValueOfHireDate().toDbStringLocal());
+    encoder.add("manager");
+    encoder.beginMap(2);
+    encoder.add("id");
+    encoder.add(static_cast<int64_t>(personInfo.getValueOfManagerId()));
+    encoder.add("full_name");
+    encoder.add(personInfo.getValueOfManagerFullName());
+    encoder.add("department");
+    encoder.beginMap(2);
+    encoder.add("id");
+    encoder.add(static_cast<int64_t>(personInfo.getValueOfDepartmentId()));
+    encoder.add("name");
+    encoder.add(personInfo.getValueOfDepartmentName());
+    encoder.add("job");
+    encoder.beginMap(2);
+    encoder.add("id");
+    encoder.add(static_cast<int64_t>(personInfo.getValueOfJobId()));
+    encoder.add("title");
+    encoder.add(personInfo.getValueOfJobTitle());
+}
+
+auto varyOnAccept(std::function<void(const HttpResponsePtr &)> &&callback)
+    -> std::function<void(const HttpResponsePtr &)> {
+    return [callback = std::move(callback)](const HttpResponsePtr &resp) {
+        addVary(resp, "Accept");
+        callback(resp);
+    };
+}
+
+auto newBinaryResponse(ResponseFormat format, std::string &&body) -> HttpResponsePtr {
+    auto resp = HttpResponse::newHttpResponse();
+    resp->setContentTypeString(contentTypeOf(format));
+    resp->addHeader("Vary", "Accept");
+    resp->setBody(std::move(body));
+    return resp;
+}
+
+auto newPersonDetailsResponse(ResponseFormat format, const orm::Result &result) -> HttpResponsePtr {
+    BinaryEncoder encoder(format);
+    encoder.beginArray(result.size());
+    for (const auto &row : result) {
+        PersonInfo personInfo{row};
+        encodePersonDetails(encoder, personInfo);
+    }
+    return newBinaryResponse(format, encoder.take());
+}
+
+void respondToEmptyPage(const DbClientPtr &dbClientPtr, const std::string &table, int id, ResponseFormat format,
+                        const std::shared_ptr<std::function<void(const HttpResponsePtr &)>> &callbackPtr) {
+    TimedQuery timed(nullptr, table + ".exists");
+    *dbClientPtr << "select id from " + table + " where id = $1"
+                 << id
+                 >> timed.onResult([callbackPtr, format](const Result &result)
+                   {
+                      if (result.empty()) {
+                          auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("resource not found"));
+                          resp->setStatusCode(HttpStatusCode::k404NotFound);
+                          (*callbackPtr)(resp);
+                          return;
+                      }
+                      if (format != ResponseFormat::Json) {
+                          BinaryEncoder encoder(format);
+                          encoder.beginArray(0);
+                          (*callbackPtr)(newBinaryResponse(format, encoder.take()));
+                          return;
+                      }
+                      auto resp = HttpResponse::newHttpJsonResponse(Json::Value{Json::arrayValue});
+                      resp->setStatusCode(HttpStatusCode::k200OK);
+                      (*callbackPtr)(resp);
+                   })
+                 >> timed.onError([callbackPtr](const DrogonDbException &e)
+                   {
+                      LOG_ERROR << e.base().what();
+                      auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("database error"));
+                      resp->setStatusCode(HttpStatusCode::k500InternalServerError);
+                      (*callbackPtr)(resp);
+                   });
+}
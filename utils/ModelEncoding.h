@@ -0,0 +1,54 @@
+#pragma once
+
+#include <drogon/HttpResponse.h>
+#include <drogon/orm/DbClient.h>
+#include <drogon/orm/Result.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "BinaryEncoder.h"
+#include "../models/Department.h"
+#include "../models/Job.h"
+#include "../models/Person.h"
+#include "../models/PersonInfo.h"
+
+// Binary counterparts of the models' toJson(), written straight from the model fields.
+void encode(BinaryEncoder &encoder, const drogon_model::org_chart::Person &person);
+void encode(BinaryEncoder &encoder, const drogon_model::org_chart::Department &department);
+void encode(BinaryEncoder &encoder, const drogon_model::org_chart::Job &job);
+// Same document as PersonsController::PersonDetails::toJson.
+void encodePersonDetails(BinaryEncoder &encoder, const drogon_model::org_chart::PersonInfo &personInfo);
+
+// Callback of a handler that picks its format from Accept: every response passed on carries
+// Vary: Accept, JSON ones included, so a cache never answers a msgpack client with JSON.
+auto varyOnAccept(std::function<void(const drogon::HttpResponsePtr &)> &&callback)
+    -> std::function<void(const drogon::HttpResponsePtr &)>;
+
+auto newBinaryResponse(ResponseFormat format, std::string &&body) -> drogon::HttpResponsePtr;
+
+template <typename T>
+auto newBinaryResponse(ResponseFormat format, const T &model) -> drogon::HttpResponsePtr {
+    BinaryEncoder encoder(format);
+    encode(encoder, model);
+    return newBinaryResponse(format, encoder.take());
+}
+
+template <typename T>
+auto newBinaryResponse(ResponseFormat format, const std::vector<T> &models) -> drogon::HttpResponsePtr {
+    BinaryEncoder encoder(format);
+    encoder.beginArray(models.size());
+    for (const auto &model : models) {
+        encode(encoder, model);
+    }
+    return newBinaryResponse(format, encoder.take());
+}
+
+// Array of person details from person_details rows.
+auto newPersonDetailsResponse(ResponseFormat format, const drogon::orm::Result &result) -> drogon::HttpResponsePtr;
+
+// Finishes a page of persons of a department or job that came back empty: [] when the row id of
+// table exists (the page is past the end, or nobody is in it), otherwise 404.
+void respondToEmptyPage(const drogon::orm::DbClientPtr &dbClientPtr, const std::string &table, int id,
+                        ResponseFormat format,
+                        const std::shared_ptr<std::function<void(const drogon::HttpResponsePtr &)>> &callbackPtr);
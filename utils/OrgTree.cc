@@ -0,0 +1,178 @@
+#include "OrgTree.h"
+#include <algorithm>
+
+void OrgTree::resize(size_t ids) {
+    if (up.empty()) up.emplace_back();
+    if (ids <= manager.size()) return;
+    // Grow geometrically so persons added one at a time cost amortized O(log depth).
+    auto capacity = std::max(ids, manager.size() * 2);
+    manager.resize(capacity, 0);
+    depth.resize(capacity, -1);
+    firstReport.resize(capacity, 0);
+    nextPeer.resize(capacity, 0);
+    previousPeer.resize(capacity, 0);
+    for (auto &level : up) level.resize(capacity, 0);
+}
+
+void OrgTree::build(const std::vector<std::pair<int, int>> &managers) {
+    manager.clear();
+    depth.clear();
+    firstReport.clear();
+    nextPeer.clear();
+    previousPeer.clear();
+    up.clear();
+    count = 0;
+    int maxId = 0;
+    for (const auto &[id, managerId] : managers) maxId = std::max({maxId, id, managerId});
+    resize(static_cast<size_t>(maxId) + 1);
+    for (const auto &[id, managerId] : managers) {
+        if (id <= 0 || managerId <= 0 || manager[id] != 0) continue;
+        manager[id] = managerId;
+        link(id);
+    }
+    // Placing the roots walks every organization that reaches one.
+    for (size_t id = 1; id < manager.size(); ++id) {
+        if (manager[id] == static_cast<int>(id)) place(static_cast<int>(id));
+    }
+}
+
+void OrgTree::link(int id) {
+    auto managerId = manager[id];
+    if (managerId == id) return;
+    previousPeer[id] = 0;
+    nextPeer[id] = firstReport[managerId];
+    if (nextPeer[id] != 0) previousPeer[nextPeer[id]] = id;
+    firstReport[managerId] = id;
+}
+
+void OrgTree::unlink(int id) {
+    auto managerId = manager[id];
+    if (managerId == id) return;
+    if (previousPeer[id] != 0) {
+        nextPeer[previousPeer[id]] = nextPeer[id];
+    } else {
+        firstReport[managerId] = nextPeer[id];
+    }
+    if (nextPeer[id] != 0) previousPeer[nextPeer[id]] = previousPeer[id];
+    nextPeer[id] = 0;
+    previousPeer[id] = 0;
+}
+
+void OrgTree::place(int id) {
+    auto managerId = manager[id];
+    int base = -1;
+    if (managerId == id) {
+        base = 0;
+    } else if (depth[managerId] >= 0) {
+        // The tables still describe the tree before this write, so they tell whether the new
+        // manager is in id's own organization.
+        bool loop = depth[id] >= 0 && depth[managerId] > depth[id] && ancestorAt(managerId, depth[id]) == id;
+        if (!loop) base = depth[managerId] + 1;
+    }
+    // A detached person's organization is detached as well.
+    if (base < 0 && depth[id] < 0) return;
+
+    auto relabel = [this](int person, int personDepth) {
+        if (depth[person] >= 0 && personDepth < 0) --count;
+        if (depth[person] < 0 && personDepth >= 0) ++count;
+        depth[person] = personDepth;
+        if (personDepth < 0) return;
+        while (personDepth >= (1 << up.size())) addLevel();
+        up[0][person] = manager[person];
+        for (size_t k = 1; k < up.size(); ++k) up[k][person] = up[k - 1][up[k - 1][person]];
+    };
+    // Breadth first, so every manager's row is final before their reports' rows are computed.
+    relabel(id, base);
+    std::vector<int> order{id};
+    for (size_t i = 0; i < order.size(); ++i) {
+        auto current = order[i];
+        for (auto report = firstReport[current]; report != 0; report = nextPeer[report]) {
+            // back at the start of a loop
+            if (report == id) continue;
+            relabel(report, depth[current] < 0 ? -1 : depth[current] + 1);
+            order.push_back(report);
+        }
+    }
+}
+
+void OrgTree::addLevel() {
+    // Rows of persons not placed yet are recomputed when they are.
+    std::vector<int> level(manager.size(), 0);
+    const auto &last = up.back();
+    for (size_t id = 1; id < level.size(); ++id) level[id] = last[last[id]];
+    up.push_back(std::move(level));
+}
+
+bool OrgTree::contains(int id) const {
+    return id > 0 && static_cast<size_t>(id) < manager.size() && manager[id] != 0 && depth[id] >= 0;
+}
+
+bool OrgTree::add(int id, int managerId) {
+    if (id <= 0 || managerId <= 0) return false;
+    resize(static_cast<size_t>(std::max(id, managerId)) + 1);
+    if (manager[id] != 0) {
+        setManager(id, managerId);
+    } else {
+        manager[id] = managerId;
+        link(id);
+        // also attaches reports that were added before id
+        place(id);
+    }
+    return contains(id);
+}
+
+void OrgTree::setManager(int id, int managerId) {
+    if (id <= 0 || static_cast<size_t>(id) >= manager.size() || manager[id] == 0 || managerId <= 0) return;
+    if (manager[id] == managerId) return;
+    resize(static_cast<size_t>(managerId) + 1);
+    unlink(id);
+    manager[id] = managerId;
+    link(id);
+    place(id);
+}
+
+void OrgTree::remove(int id) {
+    if (id <= 0 || static_cast<size_t>(id) >= manager.size() || manager[id] == 0) return;
+    unlink(id);
+    manager[id] = 0;
+    if (depth[id] >= 0) --count;
+    depth[id] = -1;
+    // Only persons without reports can be deleted; any left behind wait for id to come back.
+    for (auto report = firstReport[id]; report != 0; report = nextPeer[report]) place(report);
+}
+
+auto OrgTree::ancestorAt(int id, int atDepth) const -> int {
+    for (auto k = static_cast<int>(up.size()) - 1; k >= 0; --k) {
+        if (depth[id] - (1 << k) >= atDepth) id = up[k][id];
+    }
+    return id;
+}
+
+bool OrgTree::isUnder(int id, int managerId) const {
+    if (!contains(id) || !contains(managerId) || depth[id] <= depth[managerId]) return false;
+    return ancestorAt(id, depth[managerId]) == managerId;
+}
+
+auto OrgTree::lowestCommon(int a, int b) const -> int {
+    if (depth[a] < depth[b]) std::swap(a, b);
+    a = ancestorAt(a, depth[b]);
+    if (a == b) return a;
+    for (auto k = static_cast<int>(up.size()) - 1; k >= 0; --k) {
+        if (up[k][a] != up[k][b]) {
+            a = up[k][a];
+            b = up[k][b];
+        }
+    }
+    return up[0][a] == up[0][b] ? up[0][a] : 0;
+}
+
+auto OrgTree::commonManager(const std::vector<int> &ids) const -> std::optional<int> {
+    if (ids.empty()) return std::nullopt;
+    for (auto id : ids) {
+        if (!contains(id)) return std::nullopt;
+    }
+    auto common = ids[0];
+    for (size_t i = 1; i < ids.size() && common != 0; ++i) common = lowestCommon(common, ids[i]);
+    if (common == 0) return std::nullopt;
+    return common;
+}
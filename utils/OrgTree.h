@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// The person.manager_id hierarchy in memory, with binary lifting tables (the 2^k-th manager of
+// every person) so the lowest common manager of two persons takes O(log depth). Persons who
+// are their own manager are roots. Persons whose chain loops or leads to a person not in the
+// tree are kept but detached, and join as soon as their chain reaches a root again, e.g. once
+// a manager heard about after their report is added. Ids index plain vectors, which suits the
+// dense SERIAL ids of the person table.
+//
+// Every write patches the tables, so queries never wait for a rebuild: adding a person costs
+// O(log depth) and moving one O(s log depth) for the s persons of their organization. A write
+// that makes the tree deeper than the tables reach adds a level in O(n), which happens
+// O(log depth) times over the life of the tree. Not thread safe; see OrgTreePlugin.
+class OrgTree {
+ public:
+    // (id, manager_id) of every person.
+    void build(const std::vector<std::pair<int, int>> &managers);
+
+    // True for persons whose chain reaches a root.
+    bool contains(int id) const;
+    // Adds a person, or moves one already known. Returns false when their manager is not in the
+    // tree: the person is then kept detached until the manager is added.
+    bool add(int id, int managerId);
+    void setManager(int id, int managerId);
+    void remove(int id);
+
+    // True when managerId is id's manager, their manager's manager, and so on. O(log depth).
+    bool isUnder(int id, int managerId) const;
+    // Lowest person who is, or manages, every one of ids; empty when some id is not in the tree
+    // or the ids belong to different roots.
+    auto commonManager(const std::vector<int> &ids) const -> std::optional<int>;
+
+    auto size() const -> size_t { return count; }
+
+ private:
+    void resize(size_t ids);
+    void link(int id);
+    void unlink(int id);
+    // Recomputes depth and tables of id's organization from id's manager.
+    void place(int id);
+    void addLevel();
+    auto ancestorAt(int id, int atDepth) const -> int;
+    auto lowestCommon(int a, int b) const -> int;
+
+    // manager[id] == 0: no such person.
+    std::vector<int> manager;
+    // -1 for detached persons.
+    std::vector<int> depth;
+    // Reports of every id as a doubly linked list, so a move relinks one person in O(1); 0 ends
+    // a list. Kept for ids not in the tree too, whose reports wait for them.
+    std::vector<int> firstReport;
+    std::vector<int> nextPeer;
+    std::vector<int> previousPeer;
+    // up[k][id]: the 2^k-th manager of id; roots are their own. Only valid for attached persons.
+    std::vector<std::vector<int>> up;
+    size_t count = 0;
+};
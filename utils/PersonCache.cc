@@ -0,0 +1,75 @@
+#include "PersonCache.h"
+
+namespace {
+    void unindex(std::unordered_map<int, std::unordered_set<int>> &index, int key, int personId) {
+        auto it = index.find(key);
+        if (it == index.end()) return;
+        it->second.erase(personId);
+        if (it->second.empty()) index.erase(it);
+    }
+}  // namespace
+
+auto PersonCache::get(int personId) -> std::shared_ptr<const CachedResponse> {
+    auto it = entries.find(personId);
+    if (it == entries.end()) return nullptr;
+    if (it->second.expiresAt < trantor::Date::now()) {
+        erase(it);
+        return nullptr;
+    }
+    recency.splice(recency.begin(), recency, it->second.used);
+    return it->second.response;
+}
+
+void PersonCache::put(int personId, uint64_t generation, int managerId, int departmentId, int jobId,
+                      std::string body, std::string etag) {
+    if (generation != currentGeneration || capacity == 0) return;
+    auto existing = entries.find(personId);
+    if (existing != entries.end()) {
+        erase(existing);
+    } else if (entries.size() >= capacity) {
+        erase(entries.find(recency.back()));
+    }
+
+    recency.push_front(personId);
+    entries.emplace(personId,
+                    Entry{std::make_shared<const CachedResponse>(CachedResponse{std::move(body), std::move(etag)}),
+                          managerId, departmentId, jobId, trantor::Date::now().after(ttl), recency.begin()});
+    byManager[managerId].insert(personId);
+    byDepartment[departmentId].insert(personId);
+    byJob[jobId].insert(personId);
+}
+
+void PersonCache::invalidate(const std::string &table, int id) {
+    ++currentGeneration;
+    if (table == "person") {
+        // A person's name appears in their reports' entries as manager.full_name.
+        auto it = entries.find(id);
+        if (it != entries.end()) erase(it);
+        eraseAll(byManager, id);
+    } else if (table == "department") {
+        eraseAll(byDepartment, id);
+    } else if (table == "job") {
+        eraseAll(byJob, id);
+    }
+}
+
+void PersonCache::erase(std::unordered_map<int, Entry>::iterator it) {
+    auto personId = it->first;
+    unindex(byManager, it->second.managerId, personId);
+    unindex(byDepartment, it->second.departmentId, personId);
+    unindex(byJob, it->second.jobId, personId);
+    recency.erase(it->second.used);
+    entries.erase(it);
+}
+
+void PersonCache::eraseAll(Index &index, int id) {
+    auto found = index.find(id);
+    if (found == index.end()) return;
+    // erase() unindexes as it goes, which would invalidate an iteration over the set itself
+    auto personIds = std::move(found->second);
+    index.erase(found);
+    for (auto personId : personIds) {
+        auto it = entries.find(personId);
+        if (it != entries.end()) erase(it);
+    }
+}
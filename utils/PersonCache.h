@@ -0,0 +1,61 @@
+#pragma once
+
+#include <trantor/utils/Date.h>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+// Serialized GET /persons/{id} responses, indexed by the manager, department and job each one
+// embeds, so a change drops exactly the entries showing it in time proportional to their
+// number. Beyond capacity the least recently used entry goes. Not thread safe; see
+// PersonCachePlugin.
+class PersonCache {
+ public:
+    struct CachedResponse {
+        std::string body;
+        std::string etag;
+    };
+
+    explicit PersonCache(size_t capacity = 10000, double ttl = 60.0) : capacity{capacity}, ttl{ttl} {}
+
+    // Read before querying and pass to put(); a put whose generation is stale is ignored so a
+    // response read before an invalidation never gets cached after it.
+    auto generation() const -> uint64_t { return currentGeneration; }
+
+    auto get(int personId) -> std::shared_ptr<const CachedResponse>;
+    void put(int personId, uint64_t generation, int managerId, int departmentId, int jobId,
+             std::string body, std::string etag);
+    // A change to the row id of table ("person", "department" or "job").
+    void invalidate(const std::string &table, int id);
+
+    auto size() const -> size_t { return entries.size(); }
+
+ private:
+    using Index = std::unordered_map<int, std::unordered_set<int>>;
+
+    struct Entry {
+        std::shared_ptr<const CachedResponse> response;
+        int managerId;
+        int departmentId;
+        int jobId;
+        trantor::Date expiresAt;
+        // Position in recency, most recently used first.
+        std::list<int>::iterator used;
+    };
+
+    void erase(std::unordered_map<int, Entry>::iterator it);
+    void eraseAll(Index &index, int id);
+
+    size_t capacity;
+    double ttl;
+    uint64_t currentGeneration = 0;
+    std::unordered_map<int, Entry> entries;
+    std::list<int> recency;
+    // Cached person ids by the id they embed.
+    Index byManager;
+    Index byDepartment;
+    Index byJob;
+};
@@ -0,0 +1,138 @@
+#include "PersonFields.h"
+#include <trantor/utils/Date.h>
+#include <cstring>
+#include <ctime>
+
+using namespace drogon::orm;
+
+namespace {
+    // Same conversion as PersonInfo, so hire_date renders identically to the full document.
+    std::string hireDateString(const Row &row) {
+        auto daysStr = row["hire_date"].as<std::string>();
+        struct tm stm;
+        memset(&stm, 0, sizeof(stm));
+        strptime(daysStr.c_str(), "%Y-%m-%d", &stm);
+        time_t t = mktime(&stm);
+        return trantor::Date(t * 1000000).toDbStringLocal();
+    }
+}  // namespace
+
+bool PersonFields::parse(const std::string &fields, std::string &err) {
+    mask = 0;
+    size_t pos = 0;
+    while (pos <= fields.size()) {
+        auto end = fields.find(',', pos);
+        if (end == std::string::npos) end = fields.size();
+        auto field = fields.substr(pos, end - pos);
+        auto first = field.find_first_not_of(" \t");
+        field = first == std::string::npos ? "" : field.substr(first, field.find_last_not_of(" \t") - first + 1);
+        pos = end + 1;
+
+        if (field.empty()) continue;
+        if (field == "id") mask |= kId;
+        else if (field == "first_name") mask |= kFirstName;
+        else if (field == "last_name") mask |= kLastName;
+        else if (field == "hire_date") mask |= kHireDate;
+        else if (field == "manager") mask |= kManager;
+        else if (field == "department") mask |= kDepartment;
+        else if (field == "job") mask |= kJob;
+        else {
+            err = "unknown field '" + field + "'";
+            return false;
+        }
+    }
+    if (mask == 0) {
+        err = "fields must name at least one field";
+        return false;
+    }
+    return true;
+}
+
+auto PersonFields::selectList() const -> std::string {
+    std::string ret;
+    auto add = [&ret](const char *column) {
+        if (!ret.empty()) ret += ", ";
+        ret += column;
+    };
+    if (mask & kId) add("id");
+    if (mask & kFirstName) add("first_name");
+    if (mask & kLastName) add("last_name");
+    if (mask & kHireDate) add("hire_date");
+    if (mask & kManager) add("manager_id, manager_full_name");
+    if (mask & kDepartment) add("department_id, department_name");
+    if (mask & kJob) add("job_id, job_title");
+    return ret;
+}
+
+auto PersonFields::sqlForSelecting() const -> std::string {
+    return "select " + selectList() + " from person_details";
+}
+
+auto PersonFields::count() const -> size_t {
+    return __builtin_popcount(mask);
+}
+
+auto PersonFields::toJson(const Row &row) const -> Json::Value {
+    Json::Value ret{};
+    if (mask & kId) ret["id"] = row["id"].as<int32_t>();
+    if (mask & kFirstName) ret["first_name"] = row["first_name"].as<std::string>();
+    if (mask & kLastName) ret["last_name"] = row["last_name"].as<std::string>();
+    if (mask & kHireDate) ret["hire_date"] = hireDateString(row);
+    if (mask & kManager) {
+        ret["manager"]["id"] = row["manager_id"].as<int32_t>();
+        ret["manager"]["full_name"] = row["manager_full_name"].as<std::string>();
+    }
+    if (mask & kDepartment) {
+        ret["department"]["id"] = row["department_id"].as<int32_t>();
+        ret["department"]["name"] = row["department_name"].as<std::string>();
+    }
+    if (mask & kJob) {
+        ret["job"]["id"] = row["job_id"].as<int32_t>();
+        ret["job"]["title"] = row["job_title"].as<std::string>();
+    }
+    return ret;
+}
+
+void PersonFields::encode(BinaryEncoder &encoder, const Row &row) const {
+    encoder.beginMap(count());
+    if (mask & kId) {
+        encoder.add("id");
+        encoder.add(static_cast<int64_t>(row["id"].as<int32_t>()));
+    }
+    if (mask & kFirstName) {
+        encoder.add("first_name");
+        encoder.add(row["first_name"].as<std::string>());
+    }
+    if (mask & kLastName) {
+        encoder.add("last_name");
+        encoder.add(row["last_name"].as<std::string>());
+    }
+    if (mask & kHireDate) {
+        encoder.add("hire_date");
+        encoder.add(hireDateString(row));
+    }
+    if (mask & kManager) {
+        encoder.add("manager");
+        encoder.beginMap(2);
+        encoder.add("id");
+        encoder.add(static_cast<int64_t>(row["manager_id"].as<int32_t>()));
+        encoder.add("full_name");
+        encoder.add(row["manager_full_name"].as<std::string>());
+    }
+    if (mask & kDepartment) {
+        encoder.add("department");
+        encoder.beginMap(2);
+        encoder.add("id");
+        encoder.add(static_cast<int64_t>(row["department_id"].as<int32_t>()));
+        encoder.add("name");
+        encoder.add(row["department_name"].as<std::string>());
+    }
+    if (mask & kJob) {
+        encoder.add("job");
+        encoder.beginMap(2);
+        encoder.add("id");
+        encoder.add(static_cast<int64_t>(row["job_id"].as<int32_t>()));
+        encoder.add("title");
+        encoder.add(row["job_title"].as<std::string>());
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <drogon/orm/Row.h>
+#include <json/json.h>
+#include <string>
+#include "BinaryEncoder.h"
+
+// A ?fields= selection over the person details document (id, first_name, last_name,
+// hire_date, manager, department, job). Only the person_details columns backing the
+// requested fields are selected, and only those fields are serialized.
+class PersonFields {
+ public:
+    // Parses a comma separated list, ignoring blanks around names and repeated names; returns
+    // false and sets err on an unknown field.
+    bool parse(const std::string &fields, std::string &err);
+    auto selectList() const -> std::string;
+    // "select <selectList> from person_details"; callers append where/order/limit clauses.
+    auto sqlForSelecting() const -> std::string;
+    auto toJson(const drogon::orm::Row &row) const -> Json::Value;
+    void encode(BinaryEncoder &encoder, const drogon::orm::Row &row) const;
+
+ private:
+    enum : unsigned {
+        kId = 1 << 0,
+        kFirstName = 1 << 1,
+        kLastName = 1 << 2,
+        kHireDate = 1 << 3,
+        kManager = 1 << 4,
+        kDepartment = 1 << 5,
+        kJob = 1 << 6,
+    };
+
+    auto count() const -> size_t;
+
+    unsigned mask = 0;
+};
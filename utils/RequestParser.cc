@@ -0,0 +1,288 @@
+#include "RequestParser.h"
+#include "utils.h"
+#include <charconv>
+#include <cstring>
+#include <ctime>
+
+using namespace drogon_model::org_chart;
+
+JsonObjectReader::JsonObjectReader(std::string_view input) : input{input} {}
+
+void JsonObjectReader::fail(const char *what) const {
+    throw BadRequestError(std::string("malformed json body: ") + what + " at offset " + std::to_string(pos));
+}
+
+void JsonObjectReader::skipWhitespace() {
+    while (pos < input.size() && (input[pos] == ' ' || input[pos] == '\t' || input[pos] == '\n' || input[pos] == '\r')) {
+        ++pos;
+    }
+}
+
+auto JsonObjectReader::readString(bool &escaped) -> std::string_view {
+    if (pos >= input.size() || input[pos] != '"') fail("expected string");
+    auto start = ++pos;
+    escaped = false;
+    while (pos < input.size()) {
+        auto c = input[pos];
+        if (c == '"') {
+            return input.substr(start, pos++ - start);
+        }
+        if (c == '\\') {
+            escaped = true;
+            ++pos;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            fail("control character in string");
+        }
+        ++pos;
+    }
+    fail("unterminated string");
+}
+
+void JsonObjectReader::skipComposite() {
+    int depth = 0;
+    while (pos < input.size()) {
+        auto c = input[pos];
+        if (c == '"') {
+            bool escaped;
+            readString(escaped);
+            continue;
+        }
+        ++pos;
+        if (c == '{' || c == '[') {
+            ++depth;
+        } else if (c == '}' || c == ']') {
+            if (--depth == 0) return;
+        }
+    }
+    fail("unterminated object or array");
+}
+
+void JsonObjectReader::readValue(JsonScalar &value) {
+    skipWhitespace();
+    if (pos >= input.size()) fail("expected value");
+    auto start = pos;
+    auto c = input[pos];
+    value.escaped = false;
+    if (c == '"') {
+        value.type = JsonScalar::Type::String;
+        value.raw = readString(value.escaped);
+    } else if (c == '{' || c == '[') {
+        value.type = JsonScalar::Type::Composite;
+        skipComposite();
+        value.raw = input.substr(start, pos - start);
+    } else if (input.compare(pos, 4, "true") == 0) {
+        value.type = JsonScalar::Type::True;
+        pos += 4;
+        value.raw = input.substr(start, 4);
+    } else if (input.compare(pos, 5, "false") == 0) {
+        value.type = JsonScalar::Type::False;
+        pos += 5;
+        value.raw = input.substr(start, 5);
+    } else if (input.compare(pos, 4, "null") == 0) {
+        value.type = JsonScalar::Type::Null;
+        pos += 4;
+        value.raw = input.substr(start, 4);
+    } else if (c == '-' || (c >= '0' && c <= '9')) {
+        value.type = JsonScalar::Type::Number;
+        ++pos;
+        while (pos < input.size() && std::strchr("0123456789.eE+-", input[pos]) != nullptr) ++pos;
+        value.raw = input.substr(start, pos - start);
+    } else {
+        fail("unexpected character");
+    }
+}
+
+bool JsonObjectReader::next(std::string_view &key, JsonScalar &value) {
+    if (finished) return false;
+    skipWhitespace();
+    if (!started) {
+        if (pos >= input.size() || input[pos] != '{') fail("expected object");
+        ++pos;
+        started = true;
+        skipWhitespace();
+        if (pos < input.size() && input[pos] == '}') {
+            ++pos;
+            finished = true;
+            skipWhitespace();
+            if (pos != input.size()) fail("trailing characters");
+            return false;
+        }
+    } else {
+        if (pos < input.size() && input[pos] == '}') {
+            ++pos;
+            finished = true;
+            skipWhitespace();
+            if (pos != input.size()) fail("trailing characters");
+            return false;
+        }
+        if (pos >= input.size() || input[pos] != ',') fail("expected ',' or '}'");
+        ++pos;
+        skipWhitespace();
+    }
+
+    bool escaped;
+    key = readString(escaped);
+    skipWhitespace();
+    if (pos >= input.size() || input[pos] != ':') fail("expected ':'");
+    ++pos;
+    readValue(value);
+    return true;
+}
+
+namespace {
+    void appendUtf8(std::string &out, uint32_t codePoint) {
+        if (codePoint < 0x80) {
+            out += static_cast<char>(codePoint);
+        } else if (codePoint < 0x800) {
+            out += static_cast<char>(0xc0 | (codePoint >> 6));
+            out += static_cast<char>(0x80 | (codePoint & 0x3f));
+        } else if (codePoint < 0x10000) {
+            out += static_cast<char>(0xe0 | (codePoint >> 12));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (codePoint & 0x3f));
+        } else {
+            out += static_cast<char>(0xf0 | (codePoint >> 18));
+            out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (codePoint & 0x3f));
+        }
+    }
+
+    uint32_t readHex4(std::string_view raw, size_t pos, std::string_view key) {
+        uint32_t value = 0;
+        if (pos + 4 > raw.size() ||
+            std::from_chars(raw.data() + pos, raw.data() + pos + 4, value, 16).ptr != raw.data() + pos + 4) {
+            throw BadRequestError(std::string(key) + " has an invalid \\u escape");
+        }
+        return value;
+    }
+
+    std::string toString(std::string_view key, const JsonScalar &value) {
+        if (value.type != JsonScalar::Type::String) {
+            throw BadRequestError(std::string(key) + " must be a string");
+        }
+        if (!value.escaped) return std::string(value.raw);
+
+        std::string out;
+        out.reserve(value.raw.size());
+        const auto &raw = value.raw;
+        for (size_t i = 0; i < raw.size(); ++i) {
+            if (raw[i] != '\\') {
+                out += raw[i];
+                continue;
+            }
+            switch (raw[++i]) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    auto codePoint = readHex4(raw, i + 1, key);
+                    i += 4;
+                    if (codePoint >= 0xd800 && codePoint < 0xdc00 && raw.compare(i + 1, 2, "\\u") == 0) {
+                        auto low = readHex4(raw, i + 3, key);
+                        if (low >= 0xdc00 && low < 0xe000) {
+                            codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (low - 0xdc00);
+                            i += 6;
+                        }
+                    }
+                    appendUtf8(out, codePoint);
+                    break;
+                }
+                default:
+                    throw BadRequestError(std::string(key) + " has an invalid escape sequence");
+            }
+        }
+        return out;
+    }
+
+    int32_t toInt(std::string_view key, const JsonScalar &value) {
+        int32_t ret = 0;
+        bool isText = value.type == JsonScalar::Type::String && !value.escaped;
+        if (value.type == JsonScalar::Type::Number || isText) {
+            auto end = value.raw.data() + value.raw.size();
+            auto result = std::from_chars(value.raw.data(), end, ret);
+            if (result.ec == std::errc() && result.ptr == end) return ret;
+        }
+        throw BadRequestError(std::string(key) + " must be an integer");
+    }
+
+    // Same day resolution as the generated models' Json::Value constructors.
+    trantor::Date toDate(std::string_view key, const JsonScalar &value) {
+        auto daysStr = toString(key, value);
+        struct tm stm;
+        memset(&stm, 0, sizeof(stm));
+        auto end = strptime(daysStr.c_str(), "%Y-%m-%d", &stm);
+        if (end == nullptr || *end != '\0') {
+            throw BadRequestError(std::string(key) + " must be a date formatted as YYYY-MM-DD");
+        }
+        time_t t = mktime(&stm);
+        return trantor::Date(t * 1000000);
+    }
+}  // namespace
+
+auto jsonStringValue(std::string_view key, const JsonScalar &value) -> std::string {
+    return toString(key, value);
+}
+
+auto parsePerson(std::string_view body) -> Person {
+    Person person;
+    JsonObjectReader reader(body);
+    std::string_view key;
+    JsonScalar value;
+    while (reader.next(key, value)) {
+        if (value.type == JsonScalar::Type::Null) continue;
+        if (key == "id") person.setId(toInt(key, value));
+        else if (key == "job_id") person.setJobId(toInt(key, value));
+        else if (key == "department_id") person.setDepartmentId(toInt(key, value));
+        else if (key == "manager_id") person.setManagerId(toInt(key, value));
+        else if (key == "first_name") person.setFirstName(toString(key, value));
+        else if (key == "last_name") person.setLastName(toString(key, value));
+        else if (key == "hire_date") person.setHireDate(toDate(key, value));
+    }
+    return person;
+}
+
+auto parseDepartment(std::string_view body) -> Department {
+    Department department;
+    JsonObjectReader reader(body);
+    std::string_view key;
+    JsonScalar value;
+    while (reader.next(key, value)) {
+        if (value.type == JsonScalar::Type::Null) continue;
+        if (key == "id") department.setId(toInt(key, value));
+        else if (key == "name") department.setName(toString(key, value));
+    }
+    return department;
+}
+
+auto parseJob(std::string_view body) -> Job {
+    Job job;
+    JsonObjectReader reader(body);
+    std::string_view key;
+    JsonScalar value;
+    while (reader.next(key, value)) {
+        if (value.type == JsonScalar::Type::Null) continue;
+        if (key == "id") job.setId(toInt(key, value));
+        else if (key == "title") job.setTitle(toString(key, value));
+    }
+    return job;
+}
+
+auto parseUser(std::string_view body) -> User {
+    User user;
+    JsonObjectReader reader(body);
+    std::string_view key;
+    JsonScalar value;
+    while (reader.next(key, value)) {
+        if (value.type == JsonScalar::Type::Null) continue;
+        if (key == "id") user.setId(toInt(key, value));
+        else if (key == "username") user.setUsername(toString(key, value));
+        else if (key == "password") user.setPassword(toString(key, value));
+    }
+    return user;
+}
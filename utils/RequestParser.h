@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "../models/Department.h"
+#include "../models/Job.h"
+#include "../models/Person.h"
+#include "../models/User.h"
+
+// A member value of the object being read. Strings are left escaped in the request body
+// until a model field asks for them.
+struct JsonScalar {
+    enum class Type { String, Number, True, False, Null, Composite };
+    Type type = Type::Null;
+    // String contents without the quotes, or the literal text of anything else.
+    std::string_view raw;
+    bool escaped = false;
+};
+
+// Single pass reader over a flat JSON object held in the request buffer. Nested objects and
+// arrays are skipped and reported as Composite. Throws BadRequestError on malformed input.
+class JsonObjectReader {
+ public:
+    explicit JsonObjectReader(std::string_view input);
+    // Reads the next member; returns false once the closing brace has been consumed.
+    bool next(std::string_view &key, JsonScalar &value);
+
+ private:
+    void skipWhitespace();
+    auto readString(bool &escaped) -> std::string_view;
+    void readValue(JsonScalar &value);
+    void skipComposite();
+    [[noreturn]] void fail(const char *what) const;
+
+    std::string_view input;
+    size_t pos = 0;
+    bool started = false;
+    bool finished = false;
+};
+
+// Unescaped contents of a String member. Throws BadRequestError naming key for any other type.
+auto jsonStringValue(std::string_view key, const JsonScalar &value) -> std::string;
+
+// Build models straight from request bodies, replacing Json::Value based construction.
+// Integer ids may be sent as numbers or numeric strings; null members are treated as absent.
+auto parsePerson(std::string_view body) -> drogon_model::org_chart::Person;
+auto parseDepartment(std::string_view body) -> drogon_model::org_chart::Department;
+auto parseJob(std::string_view body) -> drogon_model::org_chart::Job;
+auto parseUser(std::string_view body) -> drogon_model::org_chart::User;
@@ -0,0 +1,70 @@
+#include "TimedQuery.h"
+#include <drogon/drogon.h>
+#include <string_view>
+#include <unordered_map>
+#include "Metrics.h"
+
+using namespace drogon;
+using namespace drogon::orm;
+
+namespace {
+    auto slowQueryThreshold() -> std::chrono::microseconds {
+        static const std::chrono::microseconds threshold{
+            static_cast<int64_t>(app().getCustomConfig().get("slow_query_ms", 200.0).asDouble() * 1000)};
+        return threshold;
+    }
+
+    auto seriesOf(const std::string &statement) -> int {
+        // DB callbacks run on a few client loop threads; each keeps its own id cache.
+        thread_local std::unordered_map<std::string, int> seriesIds;
+        auto it = seriesIds.find(statement);
+        if (it == seriesIds.end()) {
+            auto &registry = MetricsRegistry::instance();
+            registry.describe("db_query_duration_seconds", "Time from sending a statement to its result callback.");
+            auto id = registry.latencySeries("db_query_duration_seconds", metricLabel("statement", statement));
+            it = seriesIds.emplace(statement, id).first;
+        }
+        return it->second;
+    }
+}  // namespace
+
+TimedQuery::TimedQuery(const HttpRequestPtr &req, std::string statement)
+    : state{std::make_shared<State>()} {
+    state->statement = std::move(statement);
+    if (req) {
+        std::string_view pattern = req->matchedPathPattern();
+        state->route = std::string(req->methodString()) + " " + std::string(pattern.empty() ? req->path() : pattern);
+        state->trace = Tracer::instance().find(req);
+        if (state->trace) state->traceStart = traceClockMicros();
+        state->allocs = allocCountersOf(req);
+    }
+    state->start = std::chrono::steady_clock::now();
+}
+
+auto TimedQuery::onResult(std::function<void(const Result &)> callback) const -> std::function<void(const Result &)> {
+    return [state = state, callback = std::move(callback)](const Result &result) {
+        state->finish();
+        AllocScope scope(state->allocs);
+        callback(result);
+    };
+}
+
+auto TimedQuery::onError(std::function<void(const DrogonDbException &)> callback) const
+    -> std::function<void(const DrogonDbException &)> {
+    return [state = state, callback = std::move(callback)](const DrogonDbException &e) {
+        state->finish();
+        AllocScope scope(state->allocs);
+        callback(e);
+    };
+}
+
+void TimedQuery::State::finish() {
+    if (finished.exchange(true)) return;
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    MetricsRegistry::instance().record(seriesOf(statement), static_cast<uint64_t>(elapsed.count()));
+    if (trace) trace->addSpan("db " + statement, traceStart, traceClockMicros());
+    if (elapsed >= slowQueryThreshold()) {
+        LOG_WARN << "slow query " << statement << ": " << elapsed.count() / 1000.0 << " ms"
+                 << (route.empty() ? "" : ", route ") << route;
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <drogon/HttpRequest.h>
+#include <drogon/orm/Exception.h>
+#include <drogon/orm/Result.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <utility>
+#include "AllocTracking.h"
+#include "Tracing.h"
+
+// Times one database statement under a logical name (e.g. "person.update"). The time from
+// construction to the first callback is recorded in db_query_duration_seconds{statement}, and
+// statements slower than custom_config.slow_query_ms are logged with the request route. When
+// the request is traced, the same interval becomes a "db <statement>" span; it includes any
+// wait for a free connection, which drogon does not report separately. Callbacks run in an
+// AllocScope of the request, so their allocations are charged to it in allocation tracking
+// builds.
+//
+//   TimedQuery timed(req, "person.get_one");
+//   *dbClientPtr << sql << personId >> timed.onResult(...) >> timed.onError(...);
+//   mp.insert(person, timed.wrap(...), timed.wrap(...));
+//   auto user = timed.get(mp.findFutureBy(criteria));
+class TimedQuery {
+ public:
+    TimedQuery(const drogon::HttpRequestPtr &req, std::string statement);
+
+    // SqlBinder's >> needs callbacks with a concrete signature.
+    auto onResult(std::function<void(const drogon::orm::Result &)> callback) const
+        -> std::function<void(const drogon::orm::Result &)>;
+    auto onError(std::function<void(const drogon::orm::DrogonDbException &)> callback) const
+        -> std::function<void(const drogon::orm::DrogonDbException &)>;
+
+    // Mapper and model helpers take std::function callbacks of various signatures.
+    template <typename F>
+    auto wrap(F &&callback) const {
+        return [state = state, callback = std::forward<F>(callback)](auto &&...args) {
+            state->finish();
+            AllocScope scope(state->allocs);
+            callback(std::forward<decltype(args)>(args)...);
+        };
+    }
+
+    // Blocking calls: waits for the future and records the time, result or exception alike.
+    template <typename T>
+    auto get(std::future<T> &&future) const -> T {
+        try {
+            auto value = future.get();
+            state->finish();
+            return value;
+        } catch (...) {
+            state->finish();
+            throw;
+        }
+    }
+
+ private:
+    struct State {
+        std::string statement;
+        std::string route;
+        std::chrono::steady_clock::time_point start;
+        std::shared_ptr<Trace> trace;
+        int64_t traceStart = 0;
+        std::shared_ptr<AllocCounters> allocs;
+        std::atomic<bool> finished{false};
+        void finish();
+    };
+
+    std::shared_ptr<State> state;
+};
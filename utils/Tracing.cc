@@ -0,0 +1,147 @@
+#include "Tracing.h"
+#include <trantor/utils/Date.h>
+#include <trantor/utils/Logger.h>
+#include <unistd.h>
+#include <random>
+
+namespace {
+    const std::string kAttribute = "trace";
+
+    void appendJsonString(std::string &out, const std::string &value) {
+        out += '"';
+        for (auto c : value) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+            } else {
+                out += c;
+            }
+        }
+        out += '"';
+    }
+}  // namespace
+
+auto traceClockMicros() -> int64_t {
+    return trantor::Date::now().microSecondsSinceEpoch();
+}
+
+void Trace::addSpan(std::string name, int64_t start, int64_t end) {
+    std::lock_guard<std::mutex> lock(mutex);
+    spans.push_back({std::move(name), start, end});
+}
+
+auto Tracer::instance() -> Tracer & {
+    // Never destroyed: IO threads may still finish requests while the process exits.
+    static auto *tracer = new Tracer();
+    return *tracer;
+}
+
+bool Tracer::open(const std::string &path, double rate) {
+    close();
+    file = std::fopen(path.c_str(), "w");
+    if (file == nullptr) return false;
+    // The closing bracket is optional in the trace event format, so events can be appended as they come.
+    std::fputs("[\n", file);
+    sampleRate = rate;
+    stopping = false;
+    writer = std::thread([this]() { write(); });
+    enabled = rate > 0;
+    return true;
+}
+
+void Tracer::close() {
+    enabled = false;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueReady.notify_all();
+    if (writer.joinable()) writer.join();
+    if (file != nullptr) {
+        std::fclose(file);
+        file = nullptr;
+    }
+}
+
+void Tracer::begin(const drogon::HttpRequestPtr &req) {
+    if (!enabled.load(std::memory_order_relaxed)) return;
+    thread_local std::mt19937_64 random{std::random_device{}()};
+    if (std::uniform_real_distribution<double>(0, 1)(random) >= sampleRate) return;
+
+    aliveCount.fetch_add(1, std::memory_order_release);
+    // Counted until its last owner lets go: the request, or the writer once it is finished. The
+    // tracer is never destroyed, so the deleter may use it.
+    std::shared_ptr<Trace> trace(new Trace(nextId++, traceClockMicros()), [this](Trace *done) {
+        delete done;
+        aliveCount.fetch_sub(1, std::memory_order_release);
+    });
+    req->attributes()->insert(kAttribute, std::move(trace));
+}
+
+auto Tracer::find(const drogon::HttpRequestPtr &req) -> std::shared_ptr<Trace> {
+    if (aliveCount.load(std::memory_order_acquire) == 0) return nullptr;
+    return req->attributes()->get<std::shared_ptr<Trace>>(kAttribute);
+}
+
+void Tracer::finish(const drogon::HttpRequestPtr &req, const std::string &name) {
+    auto trace = find(req);
+    if (!trace) return;
+    req->attributes()->erase(kAttribute);
+    trace->addSpan(name, req->creationDate().microSecondsSinceEpoch(), traceClockMicros());
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (queue.size() >= kMaxQueued) {
+            ++droppedTraces;
+            return;
+        }
+        queue.push_back(std::move(trace));
+    }
+    queueReady.notify_one();
+}
+
+void Tracer::write() {
+    auto pid = std::to_string(getpid());
+    std::vector<std::shared_ptr<Trace>> batch;
+    std::string out;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueReady.wait(lock, [this]() { return stopping || !queue.empty(); });
+            if (queue.empty()) return;
+            batch.swap(queue);
+        }
+        out.clear();
+        for (const auto &trace : batch) {
+            std::lock_guard<std::mutex> lock(trace->mutex);
+            for (const auto &span : trace->spans) {
+                out += "{\"name\":";
+                appendJsonString(out, span.name);
+                out += ",\"ph\":\"X\",\"ts\":" + std::to_string(span.start) +
+                       ",\"dur\":" + std::to_string(span.end - span.start) + ",\"pid\":" + pid +
+                       ",\"tid\":" + std::to_string(trace->id) + "},\n";
+            }
+        }
+        batch.clear();
+        if (std::fwrite(out.data(), 1, out.size(), file) != out.size()) {
+            LOG_ERROR << "tracing: write failed";
+        }
+        std::fflush(file);
+    }
+}
+
+TraceSpan::TraceSpan(const drogon::HttpRequestPtr &req, const char *name) : name{name} {
+    if (!req) return;
+    trace = Tracer::instance().find(req);
+    if (trace) start = traceClockMicros();
+}
+
+void TraceSpan::end() {
+    if (!trace) return;
+    trace->addSpan(name, start, traceClockMicros());
+    trace.reset();
+}
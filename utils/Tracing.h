@@ -0,0 +1,108 @@
+#pragma once
+
+#include <drogon/HttpRequest.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Spans of one sampled request. Times are microseconds since the epoch, like
+// HttpRequest::creationDate, so spans from any thread line up.
+class Trace {
+ public:
+    struct Span {
+        std::string name;
+        int64_t start;
+        int64_t end;
+    };
+
+    Trace(uint64_t id, int64_t begun) : id{id}, begun{begun} {}
+
+    void addSpan(std::string name, int64_t start, int64_t end);
+
+    const uint64_t id;
+    const int64_t begun;
+    // Set by TracingPlugin's routing and handling advices; 0 until reached.
+    std::atomic<int64_t> routedAt{0};
+    std::atomic<int64_t> handlingAt{0};
+
+ private:
+    friend class Tracer;
+    std::mutex mutex;
+    std::vector<Span> spans;
+};
+
+// Samples requests, attaches a trace to each sampled one and appends finished ones to a file in
+// Chrome trace event format (open it in chrome://tracing or ui.perfetto.dev); one row per request.
+// A request that is not sampled costs one random draw; looking up its trace costs one atomic load
+// while no trace is alive. A trace lives in its request's attributes, so one whose request never
+// reaches post-handling (e.g. its connection dropped) goes away with the request. Files are
+// written by a background thread; when it falls behind, finished traces are dropped rather than
+// queued without bound.
+class Tracer {
+ public:
+    static auto instance() -> Tracer &;
+
+    // Starts tracing into path at the given sample rate (0..1); false if the file cannot be opened.
+    bool open(const std::string &path, double sampleRate);
+    void close();
+
+    // Decides whether req is sampled and if so starts its trace.
+    void begin(const drogon::HttpRequestPtr &req);
+    // The trace of req, or null when it is not sampled or already finished.
+    auto find(const drogon::HttpRequestPtr &req) -> std::shared_ptr<Trace>;
+    // Adds the root span and hands the trace to the writer.
+    void finish(const drogon::HttpRequestPtr &req, const std::string &name);
+
+    auto dropped() const -> uint64_t { return droppedTraces.load(); }
+    // Traces not yet destroyed, i.e. of requests in flight or waiting for the writer.
+    auto alive() const -> size_t { return aliveCount.load(); }
+
+ private:
+    static constexpr size_t kMaxQueued = 4096;
+
+    void write();
+
+    double sampleRate = 0;
+    std::atomic<bool> enabled{false};
+    std::atomic<uint64_t> nextId{1};
+    std::atomic<uint64_t> droppedTraces{0};
+    std::atomic<size_t> aliveCount{0};
+
+    std::mutex queueMutex;
+    std::condition_variable queueReady;
+    std::vector<std::shared_ptr<Trace>> queue;
+    bool stopping = false;
+    std::FILE *file = nullptr;
+    std::thread writer;
+};
+
+// Times a block of work of a request as a span named name; does nothing for unsampled requests.
+// End it before handing the response to the framework, which finishes the trace.
+//
+//   TraceSpan span(req, "serialize");
+//   ...
+//   span.end();
+//   (*callbackPtr)(resp);
+class TraceSpan {
+ public:
+    TraceSpan(const drogon::HttpRequestPtr &req, const char *name);
+    ~TraceSpan() { end(); }
+
+    void end();
+
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+ private:
+    std::shared_ptr<Trace> trace;
+    const char *name;
+    int64_t start = 0;
+};
+
+auto traceClockMicros() -> int64_t;
@@ -0,0 +1,70 @@
+#include "Versioning.h"
+#include "TimedQuery.h"
+#include "utils.h"
+#include <charconv>
+
+using namespace drogon;
+using namespace drogon::orm;
+
+auto versionETag(int32_t version) -> std::string {
+    return "W/\"" + std::to_string(version) + "\"";
+}
+
+bool parseIfMatch(const HttpRequestPtr &req, std::optional<int32_t> &version) {
+    const auto &header = req->getHeader("if-match");
+    version.reset();
+    if (header.empty() || header == "*") return true;
+    // the version inside is all PUT compares, so a strong "N" from older clients works too
+    size_t start = header.compare(0, 2, "W/") == 0 ? 2 : 0;
+    if (header.size() < start + 3 || header[start] != '"' || header.back() != '"') return false;
+    int32_t value;
+    auto end = header.data() + header.size() - 1;
+    auto result = std::from_chars(header.data() + start + 1, end, value);
+    if (result.ec != std::errc() || result.ptr != end) return false;
+    version = value;
+    return true;
+}
+
+void respondToVersionedUpdate(const Result &result, const DbClientPtr &dbClientPtr, const std::string &table, int id,
+                              bool conditional,
+                              const std::shared_ptr<std::function<void(const HttpResponsePtr &)>> &callbackPtr) {
+    if (!result.empty()) {
+        auto resp = HttpResponse::newHttpResponse();
+        resp->setStatusCode(HttpStatusCode::k204NoContent);
+        resp->addHeader("ETag", versionETag(result[0]["version"].as<int32_t>()));
+        (*callbackPtr)(resp);
+        return;
+    }
+    auto notFound = [callbackPtr]() {
+        auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("resource not found"));
+        resp->setStatusCode(HttpStatusCode::k404NotFound);
+        (*callbackPtr)(resp);
+    };
+    // Without If-Match the update only filters on id, so no row means no such id.
+    if (!conditional) {
+        notFound();
+        return;
+    }
+
+    TimedQuery timed(nullptr, table + ".get_version");
+    *dbClientPtr << "select version from " + table + " where id = $1"
+                 << id
+                 >> timed.onResult([callbackPtr, notFound](const Result &current)
+                   {
+                      if (current.empty()) {
+                          notFound();
+                          return;
+                      }
+                      auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("version mismatch"));
+                      resp->setStatusCode(HttpStatusCode::k412PreconditionFailed);
+                      resp->addHeader("ETag", versionETag(current[0]["version"].as<int32_t>()));
+                      (*callbackPtr)(resp);
+                   })
+                 >> timed.onError([callbackPtr](const DrogonDbException &e)
+                   {
+                      LOG_ERROR << e.base().what();
+                      auto resp = HttpResponse::newHttpJsonResponse(makeErrResp("database error"));
+                      resp->setStatusCode(HttpStatusCode::k500InternalServerError);
+                      (*callbackPtr)(resp);
+                   });
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <drogon/HttpRequest.h>
+#include <drogon/HttpResponse.h>
+#include <drogon/orm/DbClient.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+
+// person, department and job rows carry a version that every update increments. It is exposed
+// as the weak ETag W/"N" of the row's resource and checked against If-Match on PUT. Weak, since
+// the bytes also depend on the negotiated format and, for a person, on the department, job and
+// manager rows embedded in the document.
+auto versionETag(int32_t version) -> std::string;
+
+// Reads If-Match. version is left empty when the header is absent or "*"; returns false when it
+// holds anything but a single ETag produced by versionETag, or the same without the W/ prefix.
+bool parseIfMatch(const drogon::HttpRequestPtr &req, std::optional<int32_t> &version);
+
+// Finishes a conditional "update ... where id = $1 and version = ... returning *": 204 with the
+// new ETag when a row came back, otherwise a second lookup tells a missing row (404) from a
+// stale If-Match (412, carrying the current ETag).
+void respondToVersionedUpdate(const drogon::orm::Result &result, const drogon::orm::DbClientPtr &dbClientPtr,
+                              const std::string &table, int id, bool conditional,
+                              const std::shared_ptr<std::function<void(const drogon::HttpResponsePtr &)>> &callbackPtr);
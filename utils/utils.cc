@@ -1,4 +1,13 @@
 #include "utils.h"
+#include "DbConfig.h"
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+
+namespace {
+    drogon::orm::DbClientPtr installedDbClient;
+    drogon::orm::DbClientPtr installedExportDbClient;
+}  // namespace
 
 void badRequest(std::function<void(const drogon::HttpResponsePtr &)> &&callback, std::string err, drogon::HttpStatusCode code)
 {
@@ -14,3 +23,56 @@ Json::Value makeErrResp(std::string err) {
     ret["error"] = err;
     return ret;
 }
+
+void respondToException(const std::exception &e, const drogon::HttpRequestPtr &req,
+                        std::function<void(const drogon::HttpResponsePtr &)> &&callback) {
+    if (dynamic_cast<const BadRequestError *>(&e)) {
+        badRequest(std::move(callback), e.what());
+        return;
+    }
+    LOG_ERROR << req->path() << ": " << e.what();
+    auto resp = drogon::HttpResponse::newHttpJsonResponse(makeErrResp("internal error"));
+    resp->setStatusCode(drogon::k500InternalServerError);
+    callback(resp);
+}
+
+void addVary(const drogon::HttpResponsePtr &resp, const std::string &field) {
+    auto vary = resp->getHeader("vary");
+    if (vary.empty()) {
+        resp->addHeader("Vary", field);
+        return;
+    }
+    auto lower = [](std::string text) {
+        std::transform(text.begin(), text.end(), text.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return text;
+    };
+    auto wanted = lower(field);
+    std::istringstream listed(lower(vary));
+    std::string name;
+    while (std::getline(listed, name, ',')) {
+        auto first = name.find_first_not_of(" \t");
+        if (first == std::string::npos) continue;
+        name = name.substr(first, name.find_last_not_of(" \t") - first + 1);
+        if (name == wanted || name == "*") return;
+    }
+    resp->addHeader("Vary", vary + ", " + field);
+}
+
+auto dbClient() -> drogon::orm::DbClientPtr {
+    return installedDbClient ? installedDbClient : drogon::app().getDbClient();
+}
+
+void setDbClient(drogon::orm::DbClientPtr client) {
+    installedDbClient = std::move(client);
+}
+
+auto exportDbClient() -> drogon::orm::DbClientPtr {
+    if (installedExportDbClient) return installedExportDbClient;
+    static auto dbClientPtr = drogon::orm::DbClient::newPgClient(pgConnInfo(), 2);
+    return dbClientPtr;
+}
+
+void setExportDbClient(drogon::orm::DbClientPtr client) {
+    installedExportDbClient = std::move(client);
+}
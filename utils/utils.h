@@ -1,6 +1,16 @@
 #pragma once
 
 #include <drogon/drogon.h>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+
+// Thrown while reading a request (e.g. from a fromRequest specialization); the exception
+// handler installed in main.cc turns it into a 400 response carrying the message.
+class BadRequestError : public std::runtime_error {
+ public:
+    using std::runtime_error::runtime_error;
+};
 
 void badRequest (
     std::function<void(const drogon::HttpResponsePtr &)> &&callback,
@@ -9,3 +19,29 @@ void badRequest (
 );
 
 Json::Value makeErrResp(std::string err);
+
+// Exception handler of the app (see main.cc): BadRequestError becomes a 400 carrying its
+// message, anything else a logged 500.
+void respondToException(const std::exception &e, const drogon::HttpRequestPtr &req,
+                        std::function<void(const drogon::HttpResponsePtr &)> &&callback);
+
+// Adds field (e.g. "Accept") to the Vary header of resp, keeping whatever is already listed
+// there; addHeader alone would replace it.
+void addVary(const drogon::HttpResponsePtr &resp, const std::string &field);
+
+// Database client of the request handlers: the app's default client, unless another one was
+// installed with setDbClient before app().run() (the in-process tests use test/FakeDbClient).
+auto dbClient() -> drogon::orm::DbClientPtr;
+void setDbClient(drogon::orm::DbClientPtr client);
+
+// Database client of the NDJSON exports, which hold a connection for as long as the client
+// keeps reading: a small pool of their own so they cannot starve the request handlers, unless
+// another client was installed with setExportDbClient before app().run().
+auto exportDbClient() -> drogon::orm::DbClientPtr;
+void setExportDbClient(drogon::orm::DbClientPtr client);
+
+// Model getters hand out shared_ptr; SQL parameters take std::optional for a value that may be null.
+template <typename T>
+auto optionalOf(const std::shared_ptr<T> &value) -> std::optional<T> {
+    return value ? std::optional<T>(*value) : std::nullopt;
+}